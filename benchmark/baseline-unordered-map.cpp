@@ -0,0 +1,60 @@
+//
+// std::unordered_map under a std::shared_mutex, the obvious C++ way to
+// write a concurrent map. Lookups share the lock, inserts own it.
+//
+#include "baseline.h"
+
+#include <cerrno>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <unordered_map>
+
+
+struct baseline_unordered_map
+{
+   std::shared_mutex                      lock;
+   std::unordered_map<intptr_t, void *>   map;
+};
+
+
+void   *baseline_unordered_map_create( uintptr_t size)
+{
+   baseline_unordered_map   *table;
+
+   table = new( std::nothrow) baseline_unordered_map;
+   if( table)
+      table->map.reserve( size);
+   return( table);
+}
+
+
+void   baseline_unordered_map_destroy( void *table)
+{
+   delete static_cast<baseline_unordered_map *>( table);
+}
+
+
+int   baseline_unordered_map_insert( void *p, intptr_t hash, void *value)
+{
+   baseline_unordered_map   *table;
+
+   table = static_cast<baseline_unordered_map *>( p);
+
+   std::unique_lock<std::shared_mutex>   guard( table->lock);
+
+   return( table->map.emplace( hash, value).second ? 0 : EEXIST);
+}
+
+
+void   *baseline_unordered_map_lookup( void *p, intptr_t hash)
+{
+   baseline_unordered_map   *table;
+
+   table = static_cast<baseline_unordered_map *>( p);
+
+   std::shared_lock<std::shared_mutex>   guard( table->lock);
+
+   auto   found = table->map.find( hash);
+   return( found == table->map.end() ? nullptr : found->second);
+}
@@ -0,0 +1,24 @@
+//
+// The baselines of benchmark/baselines.c, that are written in C++. They
+// have a C interface, so the benchmark itself can stay C.
+//
+#ifndef baseline_h__
+#define baseline_h__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// std::unordered_map under a std::shared_mutex
+void   *baseline_unordered_map_create( uintptr_t size);
+void   baseline_unordered_map_destroy( void *table);
+int    baseline_unordered_map_insert( void *table, intptr_t hash, void *value);
+void   *baseline_unordered_map_lookup( void *table, intptr_t hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,564 @@
+//
+// mulle_concurrent_hashmap against lock based tables, that do the same:
+//
+// * rwlock   : an open addressing table under a pthread rwlock
+// * striped  : 64 open addressing tables, each under its own mutex
+// * std::map : std::unordered_map under a std::shared_mutex
+//              (see baseline-unordered-map.cpp)
+//
+// Each table is preloaded with keys, then the threads do a mix of lookups
+// of existing keys and inserts of new keys. The table prints million
+// operations per second for every mix and thread count, and how much
+// faster (> 1) or slower (< 1) the hashmap was than the best baseline.
+// With -c each row is followed by the hardware counters per operation of
+// each table, if perf_event_open is allowed (see perfcounters.h).
+//
+// usage: baselines [-c] [keys] [operations] [max threads]
+//
+// The default is 1M keys, 8M operations and up to 8 threads.
+//
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include "baseline.h"
+#include "perfcounters.h"
+
+#include <mulle_aba/mulle_aba.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define MAX_THREADS  64
+#define N_STRIPES    64
+
+
+// NULL, if no counters are measured
+static struct perfcounters   *counters;
+
+
+static double   now( void)
+{
+   return( mulle_concurrent_timestamp() * 1e-9);
+}
+
+
+// xorshift, so the lookups are not predictable by the prefetcher
+static uint64_t   next_random( uint64_t *state)
+{
+   uint64_t   x;
+
+   x  = *state;
+   x ^= x << 13;
+   x ^= x >> 7;
+   x ^= x << 17;
+   *state = x;
+   return( x);
+}
+
+
+#pragma mark -
+#pragma mark open addressing table, not thread safe
+
+//
+// linear probing like the hashmap, grows when half full
+//
+struct pair
+{
+   intptr_t   hash;
+   void       *value;
+};
+
+
+struct oatable
+{
+   uintptr_t     mask;
+   uintptr_t     n;
+   struct pair   *entries;
+};
+
+
+static void   oatable_init( struct oatable *table, uintptr_t size)
+{
+   uintptr_t   n;
+
+   for( n = 4; n < size; n <<= 1);
+
+   table->mask    = n - 1;
+   table->n       = 0;
+   table->entries = calloc( n, sizeof( struct pair));
+   if( ! table->entries)
+   {
+      perror( "calloc");
+      exit( 1);
+   }
+}
+
+
+static void   oatable_done( struct oatable *table)
+{
+   free( table->entries);
+}
+
+
+static void   *oatable_lookup( struct oatable *table, intptr_t hash, unsigned int shift)
+{
+   uintptr_t   i;
+
+   for( i = (uintptr_t) hash >> shift;; i++)
+   {
+      if( table->entries[ i & table->mask].hash == hash)
+         return( table->entries[ i & table->mask].value);
+      if( ! table->entries[ i & table->mask].hash)
+         return( NULL);
+   }
+}
+
+
+static void   oatable_put( struct oatable *table, intptr_t hash, void *value, unsigned int shift)
+{
+   uintptr_t   i;
+
+   for( i = (uintptr_t) hash >> shift; table->entries[ i & table->mask].hash; i++);
+
+   table->entries[ i & table->mask].hash  = hash;
+   table->entries[ i & table->mask].value = value;
+   table->n++;
+}
+
+
+static void   oatable_grow( struct oatable *table, unsigned int shift)
+{
+   struct oatable   bigger;
+   uintptr_t        i;
+
+   oatable_init( &bigger, (table->mask + 1) * 2);
+   for( i = 0; i <= table->mask; i++)
+      if( table->entries[ i].hash)
+         oatable_put( &bigger, table->entries[ i].hash, table->entries[ i].value, shift);
+
+   oatable_done( table);
+   *table = bigger;
+}
+
+
+static int   oatable_insert( struct oatable *table, intptr_t hash, void *value, unsigned int shift)
+{
+   if( oatable_lookup( table, hash, shift))
+      return( EEXIST);
+
+   if( table->n >= (table->mask + 1) / 2)
+      oatable_grow( table, shift);
+
+   oatable_put( table, hash, value, shift);
+   return( 0);
+}
+
+
+#pragma mark -
+#pragma mark tables
+
+struct rwlock_table
+{
+   pthread_rwlock_t   lock;
+   struct oatable     table;
+};
+
+
+static void   *rwlock_create( uintptr_t size)
+{
+   struct rwlock_table   *p;
+
+   p = calloc( 1, sizeof( *p));
+   pthread_rwlock_init( &p->lock, NULL);
+   oatable_init( &p->table, size * 2);
+   return( p);
+}
+
+
+static void   rwlock_destroy( void *table)
+{
+   struct rwlock_table   *p = table;
+
+   oatable_done( &p->table);
+   pthread_rwlock_destroy( &p->lock);
+   free( p);
+}
+
+
+static int   rwlock_insert( void *table, intptr_t hash, void *value)
+{
+   struct rwlock_table   *p = table;
+   int                   rval;
+
+   pthread_rwlock_wrlock( &p->lock);
+   rval = oatable_insert( &p->table, hash, value, 0);
+   pthread_rwlock_unlock( &p->lock);
+   return( rval);
+}
+
+
+static void   *rwlock_lookup( void *table, intptr_t hash)
+{
+   struct rwlock_table   *p = table;
+   void                  *value;
+
+   pthread_rwlock_rdlock( &p->lock);
+   value = oatable_lookup( &p->table, hash, 0);
+   pthread_rwlock_unlock( &p->lock);
+   return( value);
+}
+
+
+//
+// the low bits of the hash pick the stripe, the table of the stripe
+// uses the remaining bits
+//
+struct stripe
+{
+   pthread_mutex_t   lock;
+   struct oatable    table;
+} __attribute__((aligned( 64)));
+
+
+struct striped_table
+{
+   struct stripe   stripes[ N_STRIPES];
+};
+
+
+#define STRIPE_SHIFT   6
+
+
+static void   *striped_create( uintptr_t size)
+{
+   struct striped_table   *p;
+   unsigned int           i;
+
+   if( posix_memalign( (void **) &p, 64, sizeof( *p)))
+      return( NULL);
+
+   for( i = 0; i < N_STRIPES; i++)
+   {
+      pthread_mutex_init( &p->stripes[ i].lock, NULL);
+      oatable_init( &p->stripes[ i].table, size * 2 / N_STRIPES);
+   }
+   return( p);
+}
+
+
+static void   striped_destroy( void *table)
+{
+   struct striped_table   *p = table;
+   unsigned int           i;
+
+   for( i = 0; i < N_STRIPES; i++)
+   {
+      oatable_done( &p->stripes[ i].table);
+      pthread_mutex_destroy( &p->stripes[ i].lock);
+   }
+   free( p);
+}
+
+
+static int   striped_insert( void *table, intptr_t hash, void *value)
+{
+   struct striped_table   *p = table;
+   struct stripe          *stripe;
+   int                    rval;
+
+   stripe = &p->stripes[ hash & (N_STRIPES - 1)];
+   pthread_mutex_lock( &stripe->lock);
+   rval = oatable_insert( &stripe->table, hash, value, STRIPE_SHIFT);
+   pthread_mutex_unlock( &stripe->lock);
+   return( rval);
+}
+
+
+static void   *striped_lookup( void *table, intptr_t hash)
+{
+   struct striped_table   *p = table;
+   struct stripe          *stripe;
+   void                   *value;
+
+   stripe = &p->stripes[ hash & (N_STRIPES - 1)];
+   pthread_mutex_lock( &stripe->lock);
+   value = oatable_lookup( &stripe->table, hash, STRIPE_SHIFT);
+   pthread_mutex_unlock( &stripe->lock);
+   return( value);
+}
+
+
+static void   *mulle_create( uintptr_t size)
+{
+   struct mulle_concurrent_hashmap   *p;
+   uintptr_t                         n;
+
+   p = malloc( sizeof( *p));
+   for( n = 4; n < size * 2; n <<= 1);
+   if( mulle_concurrent_hashmap_init( p, n, NULL))
+   {
+      perror( "mulle_concurrent_hashmap_init");
+      exit( 1);
+   }
+   return( p);
+}
+
+
+static void   mulle_destroy( void *table)
+{
+   mulle_concurrent_hashmap_done( table);
+   free( table);
+}
+
+
+static int   mulle_insert( void *table, intptr_t hash, void *value)
+{
+   return( mulle_concurrent_hashmap_insert( table, hash, value));
+}
+
+
+// the other tables return NULL for not found
+static void   *mulle_lookup( void *table, intptr_t hash)
+{
+   void   *value;
+
+   value = mulle_concurrent_hashmap_lookup( table, hash);
+   return( value != MULLE_CONCURRENT_NO_POINTER ? value : NULL);
+}
+
+
+struct table_class
+{
+   char    *name;
+   void    *(*create)( uintptr_t size);
+   void    (*destroy)( void *table);
+   int     (*insert)( void *table, intptr_t hash, void *value);
+   void    *(*lookup)( void *table, intptr_t hash);
+};
+
+
+// the hashmap must be first
+static struct table_class   classes[] =
+{
+   { "mulle",    mulle_create,                  mulle_destroy,                  mulle_insert,                  mulle_lookup },
+   { "rwlock",   rwlock_create,                 rwlock_destroy,                 rwlock_insert,                 rwlock_lookup },
+   { "striped",  striped_create,                striped_destroy,                striped_insert,                striped_lookup },
+   { "std::map", baseline_unordered_map_create, baseline_unordered_map_destroy, baseline_unordered_map_insert, baseline_unordered_map_lookup }
+};
+
+#define N_CLASSES   (sizeof( classes) / sizeof( classes[ 0]))
+
+
+#pragma mark -
+#pragma mark run
+
+struct info
+{
+   struct table_class   *class;
+   void                 *table;
+   uintptr_t            n_keys;
+   uintptr_t            n_ops;
+   unsigned int         read_percent;
+   unsigned int         index;
+   unsigned int         n_threads;
+   unsigned long        n_lookups;
+   unsigned long        found;
+};
+
+
+static void   worker( struct info *info)
+{
+   uint64_t    state;
+   uint64_t    r;
+   uintptr_t   i;
+   uintptr_t   fresh;
+
+   mulle_aba_register();
+
+   state = 0x9E3779B97F4A7C15ULL + info->index;
+   fresh = info->n_keys + 1 + info->index;
+   for( i = 0; i < info->n_ops; i++)
+   {
+      r = next_random( &state);
+      if( r % 100 < info->read_percent)
+      {
+         info->n_lookups++;
+         if( (*info->class->lookup)( info->table, (intptr_t) ((r >> 8) % info->n_keys) + 1))
+            info->found++;
+      }
+      else
+      {
+         (*info->class->insert)( info->table, (intptr_t) fresh, (void *) (fresh * 8));
+         fresh += info->n_threads;
+      }
+   }
+
+   mulle_aba_unregister();
+}
+
+
+//
+// the counters are only running while the threads do their operations,
+// the preload is not measured. They are stored in *measured
+//
+static double   run( struct table_class *class,
+                     uintptr_t n_keys,
+                     uintptr_t n_ops,
+                     unsigned int read_percent,
+                     unsigned int n_threads,
+                     struct perfcounters *measured)
+{
+   struct info      infos[ MAX_THREADS];
+   mulle_thread_t   threads[ MAX_THREADS];
+   void             *table;
+   uintptr_t        i;
+   unsigned int     j;
+   double           start;
+   double           elapsed;
+
+   table = (*class->create)( n_keys);
+   if( ! table)
+   {
+      perror( class->name);
+      exit( 1);
+   }
+
+   for( i = 1; i <= n_keys; i++)
+      (*class->insert)( table, (intptr_t) i, (void *) (i * 8));
+
+   for( j = 0; j < n_threads; j++)
+   {
+      infos[ j].class        = class;
+      infos[ j].table        = table;
+      infos[ j].n_keys       = n_keys;
+      infos[ j].n_ops        = n_ops / n_threads;
+      infos[ j].read_percent = read_percent;
+      infos[ j].index        = j;
+      infos[ j].n_threads    = n_threads;
+      infos[ j].n_lookups    = 0;
+      infos[ j].found        = 0;
+   }
+
+   if( counters)
+      perfcounters_start( counters);
+
+   start = now();
+   for( j = 0; j < n_threads; j++)
+      if( mulle_thread_create( (void *) worker, &infos[ j], &threads[ j]))
+      {
+         perror( "mulle_thread_create");
+         exit( 1);
+      }
+   for( j = 0; j < n_threads; j++)
+      mulle_thread_join( threads[ j]);
+   elapsed = now() - start;
+
+   if( counters)
+   {
+      perfcounters_stop( counters);
+      *measured = *counters;
+   }
+
+   // all looked up keys were preloaded
+   for( j = 0; j < n_threads; j++)
+      if( infos[ j].found != infos[ j].n_lookups)
+         abort();
+
+   (*class->destroy)( table);
+
+   return( (n_ops / n_threads * n_threads) / elapsed / 1e6);
+}
+
+
+int   main( int argc, char *argv[])
+{
+   static unsigned int          read_percents[] = { 100, 95, 80, 50, 0 };
+   static struct perfcounters   perf;
+   struct perfcounters          measured[ N_CLASSES];
+   uintptr_t                    n_keys;
+   uintptr_t                    n_ops;
+   unsigned int                 max_threads;
+   unsigned int                 n_threads;
+   unsigned int                 i;
+   unsigned int                 k;
+   unsigned int                 wins;
+   unsigned int                 rows;
+   double                       mops[ N_CLASSES];
+   double                       best;
+
+   if( argc > 1 && ! strcmp( argv[ 1], "-c"))
+   {
+      // fall back to time only
+      if( perfcounters_open( &perf))
+         counters = &perf;
+      else
+         fprintf( stderr, "no hardware counters available (see /proc/sys/kernel/perf_event_paranoid)\n");
+      argc--;
+      argv++;
+   }
+
+   n_keys      = argc > 1 ? (uintptr_t) strtoull( argv[ 1], NULL, 0) : 1024 * 1024;
+   n_ops       = argc > 2 ? (uintptr_t) strtoull( argv[ 2], NULL, 0) : 8 * 1024 * 1024;
+   max_threads = argc > 3 ? (unsigned int) strtoul( argv[ 3], NULL, 0) : 8;
+   if( max_threads > MAX_THREADS)
+      max_threads = MAX_THREADS;
+   if( ! max_threads)
+      max_threads = 1;
+   if( ! n_keys)
+      n_keys = 1;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   printf( "keys=%lu operations=%lu, million operations per second\n\n",
+           (unsigned long) n_keys,
+           (unsigned long) n_ops);
+   printf( "reads%% threads");
+   for( k = 0; k < N_CLASSES; k++)
+      printf( " %10s", classes[ k].name);
+   printf( " %10s\n", "mulle/best");
+
+   wins = 0;
+   rows = 0;
+   for( i = 0; i < sizeof( read_percents) / sizeof( read_percents[ 0]); i++)
+      for( n_threads = 1; n_threads <= max_threads; n_threads *= 2)
+      {
+         printf( "%6u %7u", read_percents[ i], n_threads);
+         fflush( stdout);
+
+         best = 0.0;
+         for( k = 0; k < N_CLASSES; k++)
+         {
+            mops[ k] = run( &classes[ k], n_keys, n_ops, read_percents[ i], n_threads, &measured[ k]);
+            if( k && mops[ k] > best)
+               best = mops[ k];
+            printf( " %10.2f", mops[ k]);
+            fflush( stdout);
+         }
+
+         printf( " %10.2f\n", mops[ 0] / best);
+         if( mops[ 0] > best)
+            ++wins;
+         ++rows;
+
+         if( counters)
+            for( k = 0; k < N_CLASSES; k++)
+            {
+               printf( "%14s %-10s ", "", classes[ k].name);
+               perfcounters_fprint( &measured[ k], stdout, n_ops / n_threads * n_threads);
+               printf( "\n");
+            }
+      }
+
+   printf( "\nmulle was fastest in %u of %u\n", wins, rows);
+
+   if( counters)
+      perfcounters_close( counters);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   return( 0);
+}
@@ -0,0 +1,219 @@
+//
+// Lookups of a few hot keys, while one thread keeps adding new keys. The
+// adds write the counter in the storage header, the lookups read the
+// fields next to it. Build once with and once without
+// -DMULLE_CONCURRENT_CACHELINE_LAYOUT=ON and compare.
+//
+// usage: false-sharing [readers] [adds]
+//
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_aba/mulle_aba.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+#define N_HOT   64
+
+
+struct info
+{
+   struct mulle_concurrent_hashmap        *map;
+   struct mulle_concurrent_pointerarray   *array;
+   mulle_atomic_pointer_t                 *done;
+   uintptr_t                              n_adds;
+   unsigned long                          n_reads;
+   double                                 elapsed;
+};
+
+
+static double   now( void)
+{
+   struct timespec   ts;
+
+   clock_gettime( CLOCK_MONOTONIC, &ts);
+   return( ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+
+static void   map_reader( struct info *info)
+{
+   unsigned long   n;
+   intptr_t        hash;
+   double          start;
+
+   mulle_aba_register();
+
+   n     = 0;
+   start = now();
+   while( ! _mulle_atomic_pointer_read( info->done))
+      for( hash = 1; hash <= N_HOT; hash++, n++)
+         mulle_concurrent_hashmap_lookup( info->map, hash);
+   info->elapsed = now() - start;
+   info->n_reads = n;
+
+   mulle_aba_unregister();
+}
+
+
+static void   map_writer( struct info *info)
+{
+   uintptr_t   i;
+   double      start;
+
+   mulle_aba_register();
+
+   start = now();
+   for( i = N_HOT + 1; i <= N_HOT + info->n_adds; i++)
+      mulle_concurrent_hashmap_insert( info->map, (intptr_t) i, (void *) (i * 8));
+   info->elapsed = now() - start;
+   _mulle_atomic_pointer_write( info->done, (void *) 1);
+
+   mulle_aba_unregister();
+}
+
+
+static void   array_reader( struct info *info)
+{
+   unsigned long   n;
+   uintptr_t       i;
+   double          start;
+
+   mulle_aba_register();
+
+   n     = 0;
+   start = now();
+   while( ! _mulle_atomic_pointer_read( info->done))
+      for( i = 0; i < N_HOT; i++, n++)
+         mulle_concurrent_pointerarray_get( info->array, i);
+   info->elapsed = now() - start;
+   info->n_reads = n;
+
+   mulle_aba_unregister();
+}
+
+
+static void   array_writer( struct info *info)
+{
+   uintptr_t   i;
+   double      start;
+
+   mulle_aba_register();
+
+   start = now();
+   for( i = N_HOT + 1; i <= N_HOT + info->n_adds; i++)
+      mulle_concurrent_pointerarray_add( info->array, (void *) (i * 8));
+   info->elapsed = now() - start;
+   _mulle_atomic_pointer_write( info->done, (void *) 1);
+
+   mulle_aba_unregister();
+}
+
+
+static void   run( char *name,
+                   void (*reader)( struct info *),
+                   void (*writer)( struct info *),
+                   struct info *proto,
+                   unsigned int n_readers)
+{
+   mulle_atomic_pointer_t   done;
+   struct info              *infos;
+   mulle_thread_t           *threads;
+   unsigned int             i;
+   unsigned long            n_reads;
+   double                   elapsed;
+
+   infos   = calloc( n_readers + 1, sizeof( *infos));
+   threads = calloc( n_readers + 1, sizeof( *threads));
+   if( ! infos || ! threads)
+   {
+      perror( "calloc");
+      exit( 1);
+   }
+
+   _mulle_atomic_pointer_nonatomic_write( &done, NULL);
+   for( i = 0; i <= n_readers; i++)
+   {
+      infos[ i]      = *proto;
+      infos[ i].done = &done;
+      if( mulle_thread_create( (void *) (i ? reader : writer), &infos[ i], &threads[ i]))
+      {
+         perror( "mulle_thread_create");
+         exit( 1);
+      }
+   }
+   for( i = 0; i <= n_readers; i++)
+      mulle_thread_join( threads[ i]);
+
+   n_reads = 0;
+   elapsed = 0.0;
+   for( i = 1; i <= n_readers; i++)
+   {
+      n_reads += infos[ i].n_reads;
+      elapsed += infos[ i].elapsed;
+   }
+
+   printf( "%-12s %-9s readers=%u read=%.2fns add=%.2fns\n",
+           name,
+#ifdef MULLE_CONCURRENT_CACHELINE_LAYOUT
+           "cacheline",
+#else
+           "packed",
+#endif
+           n_readers,
+           n_reads ? elapsed * 1e9 / n_reads : 0.0,
+           infos[ 0].elapsed * 1e9 / infos[ 0].n_adds);
+
+   free( threads);
+   free( infos);
+}
+
+
+int   main( int argc, char *argv[])
+{
+   struct mulle_concurrent_hashmap        map;
+   struct mulle_concurrent_pointerarray   array;
+   struct info                            proto;
+   unsigned int                           n_readers;
+   uintptr_t                              n_adds;
+   uintptr_t                              size;
+   uintptr_t                              i;
+
+   n_readers = argc > 1 ? (unsigned int) strtoul( argv[ 1], NULL, 0) : 3;
+   n_adds    = argc > 2 ? (uintptr_t) strtoull( argv[ 2], NULL, 0) : 1024 * 1024;
+   if( ! n_readers || ! n_adds)
+   {
+      fprintf( stderr, "usage: false-sharing [readers] [adds]\n");
+      return( 1);
+   }
+
+   // big enough, that there is no migration
+   for( size = 1024; size < (N_HOT + n_adds) * 4; size *= 2);
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   mulle_concurrent_hashmap_init( &map, size, NULL);
+   mulle_concurrent_pointerarray_init( &array, size, NULL);
+   for( i = 1; i <= N_HOT; i++)
+   {
+      mulle_concurrent_hashmap_insert( &map, (intptr_t) i, (void *) (i * 8));
+      mulle_concurrent_pointerarray_add( &array, (void *) (i * 8));
+   }
+
+   proto.map    = &map;
+   proto.array  = &array;
+   proto.n_adds = n_adds;
+
+   run( "hashmap", map_reader, map_writer, &proto, n_readers);
+   run( "pointerarray", array_reader, array_writer, &proto, n_readers);
+
+   mulle_concurrent_pointerarray_done( &array);
+   mulle_concurrent_hashmap_done( &map);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   return( 0);
+}
@@ -0,0 +1,109 @@
+//
+// Random lookup latency of a large hashmap, once with the storage from the
+// allocator and once mapped with huge pages (if available).
+//
+// usage: hugepage-lookup [slots] [lookups]
+//
+// The default is 64M slots (1 GB of storage) filled to 3/8.
+//
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_aba/mulle_aba.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+static double   now( void)
+{
+   struct timespec   ts;
+
+   clock_gettime( CLOCK_MONOTONIC, &ts);
+   return( ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+
+// xorshift, so the lookups are not predictable by the prefetcher
+static uint64_t   next_random( uint64_t *state)
+{
+   uint64_t   x;
+
+   x  = *state;
+   x ^= x << 13;
+   x ^= x >> 7;
+   x ^= x << 17;
+   *state = x;
+   return( x);
+}
+
+
+static void   run( char *name, size_t threshold, uintptr_t slots, unsigned long n_lookups)
+{
+   struct mulle_concurrent_hashmap   map;
+   uintptr_t                         n_keys;
+   uintptr_t                         i;
+   uint64_t                          state;
+   unsigned long                     j;
+   unsigned long                     found;
+   double                            start;
+   double                            fill;
+   double                            lookup;
+
+   mulle_concurrent_storagepool_set_mmap_threshold( threshold);
+
+   start = now();
+   if( mulle_concurrent_hashmap_init( &map, slots, NULL))
+   {
+      perror( "mulle_concurrent_hashmap_init");
+      exit( 1);
+   }
+
+   // stay below the load factor, so there is no migration
+   n_keys = slots / 8 * 3;
+   for( i = 1; i <= n_keys; i++)
+      mulle_concurrent_hashmap_insert( &map, (intptr_t) i, (void *) (i * 8));
+   fill = now() - start;
+
+   state = 0x9E3779B97F4A7C15ULL;
+   found = 0;
+   start = now();
+   for( j = 0; j < n_lookups; j++)
+      if( mulle_concurrent_hashmap_lookup( &map, (intptr_t) (next_random( &state) % n_keys) + 1) != MULLE_CONCURRENT_NO_POINTER)
+         ++found;
+   lookup = now() - start;
+
+   printf( "%-10s slots=%lu keys=%lu fill=%.3fs lookup=%.1fns found=%lu\n",
+           name,
+           (unsigned long) slots,
+           (unsigned long) n_keys,
+           fill,
+           lookup * 1e9 / n_lookups,
+           found);
+
+   mulle_concurrent_hashmap_done( &map);
+}
+
+
+int   main( int argc, char *argv[])
+{
+   uintptr_t       slots;
+   unsigned long   n_lookups;
+
+   slots     = argc > 1 ? (uintptr_t) strtoull( argv[ 1], NULL, 0) : 64 * 1024 * 1024;
+   n_lookups = argc > 2 ? strtoul( argv[ 2], NULL, 0) : 10 * 1000 * 1000;
+
+   // hashmap sizes must be a power of two
+   while( slots & (slots - 1))
+      slots &= slots - 1;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   run( "allocator", 0, slots, n_lookups);
+   run( "mmap", 1, slots, n_lookups);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   return( 0);
+}
@@ -0,0 +1,183 @@
+//
+// see perfcounters.h
+//
+#include "perfcounters.h"
+
+#include <string.h>
+
+#ifdef __linux__
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+
+static char   *names[ PERFCOUNTERS_N] =
+{
+   "instructions_per_op",
+   "cache_misses_per_op",
+   "llc_misses_per_op",
+   "dtlb_misses_per_op",
+   "branch_misses_per_op"
+};
+
+
+#ifdef __linux__
+
+static int   open_counter( uint32_t type, uint64_t config)
+{
+   struct perf_event_attr   attr;
+
+   memset( &attr, 0, sizeof( attr));
+   attr.size           = sizeof( attr);
+   attr.type           = type;
+   attr.config         = config;
+   attr.disabled       = 1;
+   attr.inherit        = 1;
+   // user space only, so it works with perf_event_paranoid 2
+   attr.exclude_kernel = 1;
+   attr.exclude_hv     = 1;
+
+   return( (int) syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+
+static uint64_t   cache_config( uint64_t cache)
+{
+   return( cache |
+           (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+}
+
+
+int   perfcounters_open( struct perfcounters *p)
+{
+   unsigned int   i;
+
+   memset( p, 0, sizeof( *p));
+
+   p->fds[ PERFCOUNTER_INSTRUCTIONS]  = open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+   p->fds[ PERFCOUNTER_CACHE_MISSES]  = open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+   p->fds[ PERFCOUNTER_LLC_MISSES]    = open_counter( PERF_TYPE_HW_CACHE, cache_config( PERF_COUNT_HW_CACHE_LL));
+   p->fds[ PERFCOUNTER_DTLB_MISSES]   = open_counter( PERF_TYPE_HW_CACHE, cache_config( PERF_COUNT_HW_CACHE_DTLB));
+   p->fds[ PERFCOUNTER_BRANCH_MISSES] = open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+
+   for( i = 0; i < PERFCOUNTERS_N; i++)
+      if( p->fds[ i] >= 0)
+         p->n_open++;
+   return( p->n_open);
+}
+
+
+void   perfcounters_close( struct perfcounters *p)
+{
+   unsigned int   i;
+
+   for( i = 0; i < PERFCOUNTERS_N; i++)
+      if( p->fds[ i] >= 0)
+         close( p->fds[ i]);
+   p->n_open = 0;
+}
+
+
+void   perfcounters_start( struct perfcounters *p)
+{
+   unsigned int   i;
+
+   for( i = 0; i < PERFCOUNTERS_N; i++)
+      if( p->fds[ i] >= 0)
+      {
+         ioctl( p->fds[ i], PERF_EVENT_IOC_RESET, 0);
+         ioctl( p->fds[ i], PERF_EVENT_IOC_ENABLE, 0);
+      }
+}
+
+
+void   perfcounters_stop( struct perfcounters *p)
+{
+   unsigned int   i;
+
+   for( i = 0; i < PERFCOUNTERS_N; i++)
+   {
+      p->values[ i] = 0;
+      if( p->fds[ i] < 0)
+         continue;
+
+      ioctl( p->fds[ i], PERF_EVENT_IOC_DISABLE, 0);
+      if( read( p->fds[ i], &p->values[ i], sizeof( p->values[ i])) != sizeof( p->values[ i]))
+         p->values[ i] = 0;
+   }
+}
+
+#else
+
+int   perfcounters_open( struct perfcounters *p)
+{
+   unsigned int   i;
+
+   memset( p, 0, sizeof( *p));
+   for( i = 0; i < PERFCOUNTERS_N; i++)
+      p->fds[ i] = -1;
+   return( 0);
+}
+
+
+void   perfcounters_close( struct perfcounters *p)
+{
+}
+
+
+void   perfcounters_start( struct perfcounters *p)
+{
+}
+
+
+void   perfcounters_stop( struct perfcounters *p)
+{
+}
+
+#endif
+
+
+void   perfcounters_fprint_json( struct perfcounters *p, FILE *fp, uint64_t n_ops)
+{
+   unsigned int   i;
+   char           *sep;
+
+   if( ! p || ! p->n_open || ! n_ops)
+   {
+      fprintf( fp, ", \"counters\": null");
+      return;
+   }
+
+   fprintf( fp, ", \"counters\": {");
+   sep = " ";
+   for( i = 0; i < PERFCOUNTERS_N; i++)
+   {
+      if( p->fds[ i] < 0)
+         continue;
+      fprintf( fp, "%s\"%s\": %.3f", sep, names[ i], (double) p->values[ i] / n_ops);
+      sep = ", ";
+   }
+   fprintf( fp, " }");
+}
+
+
+void   perfcounters_fprint( struct perfcounters *p, FILE *fp, uint64_t n_ops)
+{
+   unsigned int   i;
+   char           *sep;
+
+   if( ! p || ! p->n_open || ! n_ops)
+      return;
+
+   sep = "";
+   for( i = 0; i < PERFCOUNTERS_N; i++)
+   {
+      if( p->fds[ i] < 0)
+         continue;
+      fprintf( fp, "%s%s=%.3f", sep, names[ i], (double) p->values[ i] / n_ops);
+      sep = " ";
+   }
+}
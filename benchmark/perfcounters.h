@@ -0,0 +1,54 @@
+//
+// Hardware performance counters for the benchmarks, with perf_event_open
+// on Linux. If a counter can't be opened (no permission, no PMU, not Linux)
+// it's left out, if none can be opened the benchmarks only measure time.
+// The counters are inherited by threads, that are created after
+// perfcounters_start, and added up when these are joined.
+//
+#ifndef perfcounters_h__
+#define perfcounters_h__
+
+#include <stdint.h>
+#include <stdio.h>
+
+
+enum
+{
+   PERFCOUNTER_INSTRUCTIONS,
+   PERFCOUNTER_CACHE_MISSES,
+   PERFCOUNTER_LLC_MISSES,
+   PERFCOUNTER_DTLB_MISSES,
+   PERFCOUNTER_BRANCH_MISSES,
+   PERFCOUNTERS_N
+};
+
+
+struct perfcounters
+{
+   int        fds[ PERFCOUNTERS_N];
+   uint64_t   values[ PERFCOUNTERS_N];
+   int        n_open;
+};
+
+
+// returns the number of counters, that could be opened
+int    perfcounters_open( struct perfcounters *p);
+void   perfcounters_close( struct perfcounters *p);
+
+void   perfcounters_start( struct perfcounters *p);
+void   perfcounters_stop( struct perfcounters *p);
+
+//
+// prints ", \"counters\": { \"instructions_per_op\": ... }" with the
+// counters divided by n_ops, or ", \"counters\": null" if p is NULL or
+// no counter is open
+//
+void   perfcounters_fprint_json( struct perfcounters *p, FILE *fp, uint64_t n_ops);
+
+//
+// prints "instructions_per_op=... cache_misses_per_op=..." for the open
+// counters, for tables
+//
+void   perfcounters_fprint( struct perfcounters *p, FILE *fp, uint64_t n_ops);
+
+#endif
@@ -0,0 +1,412 @@
+//
+// Throughput of mulle_concurrent_pointerarray. Measures:
+//
+// * append: adds per second with 1 to max threads adding
+// * get: gets per second of readers, while one thread appends
+// * enumerate: full scans per second of a filled array
+// * find: cost of a find of the last value and of a missing value, by length
+//
+// The results are printed as JSON, so that they can be compared between
+// releases. With -c hardware counters per operation are added to each
+// result, if perf_event_open is allowed (see perfcounters.h).
+//
+// usage: pointerarray [-c] [values] [max threads]
+//
+// The default is 4M values and up to 8 threads.
+//
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include "perfcounters.h"
+
+#include <mulle_aba/mulle_aba.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define MAX_THREADS  64
+
+
+// NULL, if no counters are measured
+static struct perfcounters   *counters;
+
+
+static void   counters_start( void)
+{
+   if( counters)
+      perfcounters_start( counters);
+}
+
+
+static void   counters_stop( void)
+{
+   if( counters)
+      perfcounters_stop( counters);
+}
+
+
+static void   counters_print( uint64_t n_ops)
+{
+   perfcounters_fprint_json( counters, stdout, n_ops);
+   printf( " }");
+}
+
+
+static double   now( void)
+{
+   return( mulle_concurrent_timestamp() * 1e-9);
+}
+
+
+static void   *value_for_index( uintptr_t i)
+{
+   return( (void *) ((i + 1) * 8));
+}
+
+
+// xorshift, so the gets are not predictable by the prefetcher
+static uint64_t   next_random( uint64_t *state)
+{
+   uint64_t   x;
+
+   x  = *state;
+   x ^= x << 13;
+   x ^= x >> 7;
+   x ^= x << 17;
+   *state = x;
+   return( x);
+}
+
+
+struct info
+{
+   struct mulle_concurrent_pointerarray   *array;
+   mulle_atomic_pointer_t                 *done;
+   uintptr_t                              first;
+   uintptr_t                              n;
+   unsigned long                          n_gets;
+};
+
+
+static void   adder( struct info *info)
+{
+   uintptr_t   i;
+   uintptr_t   end;
+
+   mulle_aba_register();
+
+   end = info->first + info->n;
+   for( i = info->first; i < end; i++)
+      mulle_concurrent_pointerarray_add( info->array, value_for_index( i));
+
+   if( info->done)
+      _mulle_atomic_pointer_write( info->done, (void *) 1);
+
+   mulle_aba_unregister();
+}
+
+
+static void   getter( struct info *info)
+{
+   uint64_t        state;
+   uintptr_t       n;
+   unsigned long   j;
+
+   mulle_aba_register();
+
+   state = 0x9E3779B97F4A7C15ULL + info->first;
+   while( ! _mulle_atomic_pointer_read( info->done))
+   {
+      n = mulle_concurrent_pointerarray_get_count( info->array);
+      if( ! n)
+         continue;
+
+      for( j = 0; j < 64; j++)
+         mulle_concurrent_pointerarray_get( info->array, (uintptr_t) (next_random( &state) % n));
+      info->n_gets += j;
+   }
+
+   mulle_aba_unregister();
+}
+
+
+static void   start_threads( void (*f)( struct info *),
+                             struct info *infos,
+                             unsigned int n,
+                             mulle_thread_t *threads)
+{
+   unsigned int   i;
+
+   for( i = 0; i < n; i++)
+      if( mulle_thread_create( (void *) f, &infos[ i], &threads[ i]))
+      {
+         perror( "mulle_thread_create");
+         exit( 1);
+      }
+}
+
+
+static void   join_threads( unsigned int n, mulle_thread_t *threads)
+{
+   unsigned int   i;
+
+   for( i = 0; i < n; i++)
+      mulle_thread_join( threads[ i]);
+}
+
+
+static void   bench_append( uintptr_t n_values, unsigned int max_threads)
+{
+   struct mulle_concurrent_pointerarray   array;
+   struct info                            infos[ MAX_THREADS];
+   mulle_thread_t                         threads[ MAX_THREADS];
+   unsigned int                           n_threads;
+   unsigned int                           i;
+   double                                 start;
+   double                                 elapsed;
+
+   printf( "   \"append\": [");
+   for( n_threads = 1; n_threads <= max_threads; n_threads *= 2)
+   {
+      mulle_concurrent_pointerarray_init( &array, 0, NULL);
+
+      memset( infos, 0, sizeof( infos));
+      for( i = 0; i < n_threads; i++)
+      {
+         infos[ i].array = &array;
+         infos[ i].first = n_values / n_threads * i;
+         infos[ i].n     = n_values / n_threads;
+      }
+
+      counters_start();
+      start = now();
+      start_threads( adder, infos, n_threads, threads);
+      join_threads( n_threads, threads);
+      elapsed = now() - start;
+      counters_stop();
+
+      printf( "%s\n      { \"threads\": %u, \"values\": %lu, \"seconds\": %.6f, \"adds_per_second\": %.0f",
+              n_threads == 1 ? "" : ",",
+              n_threads,
+              (unsigned long) mulle_concurrent_pointerarray_get_count( &array),
+              elapsed,
+              mulle_concurrent_pointerarray_get_count( &array) / elapsed);
+      counters_print( mulle_concurrent_pointerarray_get_count( &array));
+
+      mulle_concurrent_pointerarray_done( &array);
+   }
+   printf( "\n   ],\n");
+}
+
+
+static void   bench_get( uintptr_t n_values, unsigned int max_threads)
+{
+   struct mulle_concurrent_pointerarray   array;
+   struct info                            infos[ MAX_THREADS + 1];
+   mulle_thread_t                         threads[ MAX_THREADS + 1];
+   mulle_atomic_pointer_t                 done;
+   unsigned long                          n_gets;
+   unsigned int                           n_readers;
+   unsigned int                           i;
+   double                                 start;
+   double                                 elapsed;
+
+   printf( "   \"get_during_growth\": [");
+   for( n_readers = 1; n_readers <= max_threads; n_readers *= 2)
+   {
+      mulle_concurrent_pointerarray_init( &array, 0, NULL);
+      _mulle_atomic_pointer_nonatomic_write( &done, NULL);
+
+      memset( infos, 0, sizeof( infos));
+      for( i = 0; i <= n_readers; i++)
+      {
+         infos[ i].array = &array;
+         infos[ i].done  = &done;
+         infos[ i].first = i;
+      }
+      infos[ 0].n = n_values;
+
+      counters_start();
+      start = now();
+      start_threads( getter, &infos[ 1], n_readers, &threads[ 1]);
+      start_threads( adder, infos, 1, threads);
+      join_threads( n_readers + 1, threads);
+      elapsed = now() - start;
+      counters_stop();
+
+      n_gets = 0;
+      for( i = 1; i <= n_readers; i++)
+         n_gets += infos[ i].n_gets;
+
+      // the counters include the adds of the writer
+      printf( "%s\n      { \"readers\": %u, \"gets\": %lu, \"seconds\": %.6f, \"gets_per_second\": %.0f, \"adds_per_second\": %.0f",
+              n_readers == 1 ? "" : ",",
+              n_readers,
+              n_gets,
+              elapsed,
+              n_gets / elapsed,
+              n_values / elapsed);
+      counters_print( n_gets + n_values);
+
+      mulle_concurrent_pointerarray_done( &array);
+   }
+   printf( "\n   ],\n");
+}
+
+
+static void   bench_enumerate( uintptr_t n_values)
+{
+   struct mulle_concurrent_pointerarray             array;
+   struct mulle_concurrent_pointerarrayenumerator   rover;
+   uintptr_t                                        i;
+   uintptr_t                                        n;
+   unsigned int                                     rounds;
+   unsigned int                                     j;
+   double                                           start;
+   double                                           elapsed;
+
+   mulle_concurrent_pointerarray_init( &array, n_values, NULL);
+   for( i = 0; i < n_values; i++)
+      mulle_concurrent_pointerarray_add( &array, value_for_index( i));
+
+   rounds = 10;
+   n      = 0;
+   counters_start();
+   start  = now();
+   for( j = 0; j < rounds; j++)
+   {
+      rover = mulle_concurrent_pointerarray_enumerate( &array);
+      while( mulle_concurrent_pointerarrayenumerator_next( &rover) != MULLE_CONCURRENT_NO_POINTER)
+         ++n;
+      mulle_concurrent_pointerarrayenumerator_done( &rover);
+   }
+   elapsed = now() - start;
+   counters_stop();
+
+   if( n != n_values * rounds)
+   {
+      fprintf( stderr, "enumerated %lu of %lu\n", (unsigned long) n, (unsigned long) n_values * rounds);
+      exit( 1);
+   }
+
+   printf( "   \"enumerate\": { \"values\": %lu, \"rounds\": %u, \"seconds\": %.6f, \"values_per_second\": %.0f, \"bytes_per_second\": %.0f",
+           (unsigned long) n_values,
+           rounds,
+           elapsed,
+           n / elapsed,
+           n * sizeof( void *) / elapsed);
+   counters_print( n);
+   printf( ",\n");
+
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+static void   bench_find( uintptr_t n_values)
+{
+   struct mulle_concurrent_pointerarray   array;
+   uintptr_t                              length;
+   uintptr_t                              i;
+   unsigned long                          rounds;
+   unsigned long                          j;
+   double                                 start;
+   double                                 hit;
+   double                                 miss;
+
+   printf( "   \"find\": [");
+
+   mulle_concurrent_pointerarray_init( &array, 0, NULL);
+   i = 0;
+   for( length = 16; length <= n_values; length *= 4)
+   {
+      for( ; i < length; i++)
+         mulle_concurrent_pointerarray_add( &array, value_for_index( i));
+
+      // keep the work per length about the same
+      rounds = (unsigned long) (n_values * 4 / length);
+      if( ! rounds)
+         rounds = 1;
+
+      counters_start();
+      start = now();
+      for( j = 0; j < rounds; j++)
+         if( ! mulle_concurrent_pointerarray_find( &array, value_for_index( length - 1)))
+            abort();
+      hit = now() - start;
+
+      start = now();
+      for( j = 0; j < rounds; j++)
+         if( mulle_concurrent_pointerarray_find( &array, value_for_index( n_values)))
+            abort();
+      miss = now() - start;
+      counters_stop();
+
+      // the counters are for both finds
+      printf( "%s\n      { \"length\": %lu, \"ns_last\": %.1f, \"ns_missing\": %.1f",
+              length == 16 ? "" : ",",
+              (unsigned long) length,
+              hit * 1e9 / rounds,
+              miss * 1e9 / rounds);
+      counters_print( rounds * 2);
+   }
+   mulle_concurrent_pointerarray_done( &array);
+
+   printf( "\n   ]\n");
+}
+
+
+int   main( int argc, char *argv[])
+{
+   static struct perfcounters   perf;
+   uintptr_t                    n_values;
+   unsigned int                 max_threads;
+
+   if( argc > 1 && ! strcmp( argv[ 1], "-c"))
+   {
+      // fall back to time only
+      if( perfcounters_open( &perf))
+         counters = &perf;
+      else
+         fprintf( stderr, "no hardware counters available (see /proc/sys/kernel/perf_event_paranoid)\n");
+      argc--;
+      argv++;
+   }
+
+   n_values    = argc > 1 ? (uintptr_t) strtoull( argv[ 1], NULL, 0) : 4 * 1024 * 1024;
+   max_threads = argc > 2 ? (unsigned int) strtoul( argv[ 2], NULL, 0) : 8;
+   if( max_threads > MAX_THREADS)
+      max_threads = MAX_THREADS;
+   if( ! max_threads)
+      max_threads = 1;
+   if( n_values < 16)
+      n_values = 16;
+
+   if( ! mulle_concurrent_timestamp())
+   {
+      fprintf( stderr, "no monotonic clock\n");
+      return( 1);
+   }
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   printf( "{\n");
+   printf( "   \"benchmark\": \"pointerarray\",\n");
+   printf( "   \"values\": %lu,\n", (unsigned long) n_values);
+   printf( "   \"pointer_size\": %u,\n", (unsigned int) sizeof( void *));
+
+   bench_append( n_values, max_threads);
+   bench_get( n_values, max_threads);
+   bench_enumerate( n_values);
+   bench_find( n_values);
+
+   printf( "}\n");
+
+   if( counters)
+      perfcounters_close( counters);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   return( 0);
+}
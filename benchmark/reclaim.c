@@ -0,0 +1,197 @@
+//
+// Cost of storage reclamation under a write heavy load. Every round the
+// threads fill a fresh hashmap, so the storage is migrated and retired
+// over and over. Compares mulle_aba with the QSBR and EBR modes of
+// mulle_concurrent_reclaim.
+//
+// usage: reclaim [threads] [keys] [rounds]
+//
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_aba/mulle_aba.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+// how often a thread passes a quiescent state (or checkpoints with aba)
+#define QUIESCENT_INTERVAL   64
+
+
+enum mode
+{
+   ABA,
+   QSBR,
+   EBR
+};
+
+
+struct info
+{
+   enum mode                         mode;
+   struct mulle_concurrent_reclaim   *reclaim;
+   struct mulle_concurrent_hashmap   *map;
+   intptr_t                          first;
+   intptr_t                          n_keys;
+};
+
+
+static double   now( void)
+{
+   struct timespec   ts;
+
+   clock_gettime( CLOCK_MONOTONIC, &ts);
+   return( ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+
+static void   worker( struct info *info)
+{
+   struct mulle_concurrent_reclaimthread   thread;
+   intptr_t                                hash;
+   intptr_t                                end;
+
+   if( info->mode == ABA)
+      mulle_aba_register();
+   else
+      mulle_concurrent_reclaim_register( info->reclaim, &thread);
+
+   end = info->first + info->n_keys;
+   for( hash = info->first; hash < end; hash++)
+   {
+      if( info->mode == EBR)
+         mulle_concurrent_reclaim_enter( info->reclaim, &thread);
+
+      mulle_concurrent_hashmap_insert( info->map, hash, (void *) (hash * 8));
+      mulle_concurrent_hashmap_lookup( info->map, hash - 1);
+
+      switch( info->mode)
+      {
+      case ABA  :
+         if( ! (hash % QUIESCENT_INTERVAL))
+            mulle_aba_checkpoint();
+         break;
+
+      case QSBR :
+         if( ! (hash % QUIESCENT_INTERVAL))
+            mulle_concurrent_reclaim_quiescent( info->reclaim, &thread);
+         break;
+
+      case EBR  :
+         mulle_concurrent_reclaim_leave( info->reclaim, &thread);
+         break;
+      }
+   }
+
+   if( info->mode == ABA)
+      mulle_aba_unregister();
+   else
+      mulle_concurrent_reclaim_unregister( info->reclaim, &thread);
+}
+
+
+static void   run( char *name,
+                   enum mode mode,
+                   unsigned int n_threads,
+                   intptr_t n_keys,
+                   unsigned int rounds)
+{
+   struct mulle_concurrent_reclaim   reclaim;
+   struct mulle_allocator            allocator;
+   struct mulle_allocator            *p;
+   struct mulle_concurrent_hashmap   map;
+   struct info                       *infos;
+   mulle_thread_t                    *threads;
+   unsigned int                      i;
+   unsigned int                      round;
+   double                            start;
+   double                            elapsed;
+
+   infos   = calloc( n_threads, sizeof( *infos));
+   threads = calloc( n_threads, sizeof( *threads));
+   if( ! infos || ! threads)
+   {
+      perror( "calloc");
+      exit( 1);
+   }
+
+   p = NULL;
+   if( mode != ABA)
+   {
+      mulle_concurrent_reclaim_init( &reclaim, NULL);
+      mulle_concurrent_reclaim_init_allocator( &reclaim, &allocator, NULL);
+      p = &allocator;
+   }
+
+   elapsed = 0.0;
+   for( round = 0; round < rounds; round++)
+   {
+      mulle_concurrent_hashmap_init( &map, 0, p);
+
+      for( i = 0; i < n_threads; i++)
+      {
+         infos[ i].mode    = mode;
+         infos[ i].reclaim = &reclaim;
+         infos[ i].map     = &map;
+         infos[ i].first   = 1 + i * n_keys;
+         infos[ i].n_keys  = n_keys;
+      }
+
+      start = now();
+      for( i = 0; i < n_threads; i++)
+         if( mulle_thread_create( (void *) worker, &infos[ i], &threads[ i]))
+         {
+            perror( "mulle_thread_create");
+            exit( 1);
+         }
+      for( i = 0; i < n_threads; i++)
+         mulle_thread_join( threads[ i]);
+      elapsed += now() - start;
+
+      mulle_concurrent_hashmap_done( &map);
+   }
+
+   if( mode != ABA)
+      mulle_concurrent_reclaim_done( &reclaim);
+
+   printf( "%-5s threads=%u keys=%lu rounds=%u %.1fns/op\n",
+           name,
+           n_threads,
+           (unsigned long) n_keys,
+           rounds,
+           elapsed * 1e9 / ((double) n_keys * n_threads * rounds));
+
+   free( threads);
+   free( infos);
+}
+
+
+int   main( int argc, char *argv[])
+{
+   unsigned int   n_threads;
+   unsigned int   rounds;
+   intptr_t       n_keys;
+
+   n_threads = argc > 1 ? (unsigned int) strtoul( argv[ 1], NULL, 0) : 4;
+   n_keys    = argc > 2 ? (intptr_t) strtol( argv[ 2], NULL, 0) : 100000;
+   rounds    = argc > 3 ? (unsigned int) strtoul( argv[ 3], NULL, 0) : 20;
+
+   if( ! n_threads || n_keys <= 0 || ! rounds)
+   {
+      fprintf( stderr, "usage: reclaim [threads] [keys] [rounds]\n");
+      return( 1);
+   }
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   run( "aba", ABA, n_threads, n_keys, rounds);
+   run( "qsbr", QSBR, n_threads, n_keys, rounds);
+   run( "ebr", EBR, n_threads, n_keys, rounds);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   return( 0);
+}
@@ -0,0 +1,312 @@
+//
+// Plays back a trace, that was recorded with mulle_concurrent_trace_start
+// by a library compiled with MULLE_CONCURRENT_TRACE. Every thread of the
+// trace gets a thread of its own, every container of the trace a fresh
+// container, which the thread drives with its operations in the recorded
+// order. Hashmap values are made up from the hash, pointerarray values are
+// the recorded pointers, which are never dereferenced.
+//
+// usage: replay [-p] <tracefile> [rounds]
+//
+// -p keeps the original pacing, otherwise the operations run at full speed.
+//
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_aba/mulle_aba.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define N_OPS   (MULLE_CONCURRENT_TRACE_POINTERARRAY_REMOVE + 1)
+
+
+struct object
+{
+   int                                    is_array;
+   struct mulle_concurrent_hashmap        map;
+   struct mulle_concurrent_pointerarray   array;
+};
+
+
+struct thread
+{
+   struct mulle_concurrent_tracerecord   *records;
+   uintptr_t                             n;
+   struct object                         *objects;
+   int                                   paced;
+   uint64_t                              start;
+   mulle_thread_t                        thread;
+};
+
+
+static char  *op_names[ N_OPS] =
+{
+   "?",
+   "hashmap_insert",
+   "hashmap_lookup",
+   "hashmap_remove",
+   "pointerarray_add",
+   "pointerarray_get",
+   "pointerarray_remove"
+};
+
+
+// never NO_POINTER nor INVALID_POINTER
+static void   *value_for_hash( uint64_t hash)
+{
+   return( (void *) (uintptr_t) ((hash << 4) | 8));
+}
+
+
+static void   replayer( struct thread *thread)
+{
+   struct mulle_concurrent_tracerecord   *record;
+   struct mulle_concurrent_tracerecord   *sentinel;
+   struct object                         *object;
+
+   mulle_aba_register();
+
+   record   = thread->records;
+   sentinel = &record[ thread->n];
+   for( ; record < sentinel; record++)
+   {
+      if( thread->paced)
+         while( mulle_concurrent_timestamp() - thread->start < record->timestamp)
+            mulle_thread_yield();
+
+      object = &thread->objects[ record->object];
+      switch( record->op)
+      {
+      case MULLE_CONCURRENT_TRACE_HASHMAP_INSERT :
+         mulle_concurrent_hashmap_insert( &object->map, (intptr_t) record->key, value_for_hash( record->key));
+         break;
+
+      case MULLE_CONCURRENT_TRACE_HASHMAP_LOOKUP :
+         mulle_concurrent_hashmap_lookup( &object->map, (intptr_t) record->key);
+         break;
+
+      case MULLE_CONCURRENT_TRACE_HASHMAP_REMOVE :
+         mulle_concurrent_hashmap_remove( &object->map, (intptr_t) record->key, value_for_hash( record->key));
+         break;
+
+      case MULLE_CONCURRENT_TRACE_POINTERARRAY_ADD :
+         mulle_concurrent_pointerarray_add( &object->array, (void *) (uintptr_t) record->key);
+         break;
+
+      case MULLE_CONCURRENT_TRACE_POINTERARRAY_GET :
+         mulle_concurrent_pointerarray_get( &object->array, (uintptr_t) record->key);
+         break;
+
+      case MULLE_CONCURRENT_TRACE_POINTERARRAY_REMOVE :
+         mulle_concurrent_pointerarray_remove( &object->array, (void *) (uintptr_t) record->key);
+         break;
+      }
+   }
+
+   mulle_aba_unregister();
+}
+
+
+static struct mulle_concurrent_tracerecord   *read_trace( char *filename, uintptr_t *p_n)
+{
+   struct mulle_concurrent_traceheader   header;
+   struct mulle_concurrent_tracerecord   *records;
+   FILE                                  *fp;
+   long                                  length;
+   uintptr_t                             n;
+
+   fp = fopen( filename, "rb");
+   if( ! fp)
+   {
+      perror( filename);
+      exit( 1);
+   }
+
+   if( fread( &header, sizeof( header), 1, fp) != 1 ||
+       memcmp( header.magic, MULLE_CONCURRENT_TRACE_MAGIC, sizeof( MULLE_CONCURRENT_TRACE_MAGIC)) ||
+       header.version != MULLE_CONCURRENT_TRACE_VERSION ||
+       header.record_size != sizeof( struct mulle_concurrent_tracerecord))
+   {
+      fprintf( stderr, "%s: not a trace of this version or architecture\n", filename);
+      exit( 1);
+   }
+
+   fseek( fp, 0, SEEK_END);
+   length = ftell( fp) - (long) sizeof( header);
+   fseek( fp, (long) sizeof( header), SEEK_SET);
+
+   n       = (uintptr_t) length / sizeof( struct mulle_concurrent_tracerecord);
+   records = malloc( (n ? n : 1) * sizeof( struct mulle_concurrent_tracerecord));
+   if( ! records || fread( records, sizeof( *records), n, fp) != n)
+   {
+      perror( filename);
+      exit( 1);
+   }
+   fclose( fp);
+
+   *p_n = n;
+   return( records);
+}
+
+
+int   main( int argc, char *argv[])
+{
+   struct mulle_concurrent_tracerecord   *records;
+   struct mulle_concurrent_tracerecord   *sorted;
+   struct object                         *objects;
+   struct thread                         *threads;
+   struct thread                         *thread;
+   unsigned long                         counts[ N_OPS];
+   uintptr_t                             n;
+   uintptr_t                             i;
+   uintptr_t                             offset;
+   unsigned int                          n_threads;
+   unsigned int                          n_objects;
+   unsigned int                          rounds;
+   unsigned int                          round;
+   unsigned int                          j;
+   int                                   paced;
+   uint64_t                              start;
+   uint64_t                              elapsed;
+   uint64_t                              best;
+
+   paced = argc > 1 && ! strcmp( argv[ 1], "-p");
+   if( paced)
+   {
+      argc--;
+      argv++;
+   }
+   if( argc < 2)
+   {
+      fprintf( stderr, "usage: replay [-p] <tracefile> [rounds]\n");
+      return( 1);
+   }
+   rounds = argc > 2 ? (unsigned int) strtoul( argv[ 2], NULL, 0) : 5;
+   if( ! rounds)
+      rounds = 1;
+
+   records = read_trace( argv[ 1], &n);
+
+   memset( counts, 0, sizeof( counts));
+   n_threads = 0;
+   n_objects = 0;
+   for( i = 0; i < n; i++)
+   {
+      if( records[ i].op >= N_OPS)
+      {
+         fprintf( stderr, "%s: unknown operation %u\n", argv[ 1], records[ i].op);
+         return( 1);
+      }
+      counts[ records[ i].op]++;
+      if( records[ i].thread >= n_threads)
+         n_threads = records[ i].thread + 1;
+      if( records[ i].object >= n_objects)
+         n_objects = records[ i].object + 1;
+   }
+
+   threads = calloc( n_threads ? n_threads : 1, sizeof( *threads));
+   objects = calloc( n_objects ? n_objects : 1, sizeof( *objects));
+   if( ! threads || ! objects)
+   {
+      perror( "calloc");
+      return( 1);
+   }
+
+   //
+   // the records of the threads are interleaved in chunks, sort them by
+   // thread keeping their order
+   //
+   sorted = malloc( (n ? n : 1) * sizeof( *sorted));
+   if( ! sorted)
+   {
+      perror( "malloc");
+      return( 1);
+   }
+
+   for( i = 0; i < n; i++)
+   {
+      threads[ records[ i].thread].n++;
+      if( records[ i].op >= MULLE_CONCURRENT_TRACE_POINTERARRAY_ADD)
+         objects[ records[ i].object].is_array = 1;
+   }
+
+   offset = 0;
+   for( j = 0; j < n_threads; j++)
+   {
+      threads[ j].records = &sorted[ offset];
+      offset             += threads[ j].n;
+      threads[ j].n       = 0;
+   }
+
+   for( i = 0; i < n; i++)
+   {
+      thread = &threads[ records[ i].thread];
+      thread->records[ thread->n++] = records[ i];
+   }
+
+   free( records);
+   records = sorted;
+
+   printf( "%s: %lu operations, %u threads, %u containers%s\n",
+           argv[ 1],
+           (unsigned long) n,
+           n_threads,
+           n_objects,
+           paced ? ", paced" : "");
+   for( j = 1; j < N_OPS; j++)
+      if( counts[ j])
+         printf( "   %-20s %lu\n", op_names[ j], counts[ j]);
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   best = 0;
+   for( round = 0; round < rounds; round++)
+   {
+      for( j = 0; j < n_objects; j++)
+         if( objects[ j].is_array)
+            mulle_concurrent_pointerarray_init( &objects[ j].array, 0, NULL);
+         else
+            mulle_concurrent_hashmap_init( &objects[ j].map, 0, NULL);
+
+      start = mulle_concurrent_timestamp();
+      for( j = 0; j < n_threads; j++)
+      {
+         threads[ j].objects = objects;
+         threads[ j].paced   = paced;
+         threads[ j].start   = start;
+         if( mulle_thread_create( (void *) replayer, &threads[ j], &threads[ j].thread))
+         {
+            perror( "mulle_thread_create");
+            return( 1);
+         }
+      }
+      for( j = 0; j < n_threads; j++)
+         mulle_thread_join( threads[ j].thread);
+      elapsed = mulle_concurrent_timestamp() - start;
+
+      if( ! round || elapsed < best)
+         best = elapsed;
+
+      for( j = 0; j < n_objects; j++)
+         if( objects[ j].is_array)
+            mulle_concurrent_pointerarray_done( &objects[ j].array);
+         else
+            mulle_concurrent_hashmap_done( &objects[ j].map);
+   }
+
+   printf( "best of %u: %.3f ms, %.0f operations per second\n",
+           rounds,
+           best / 1e6,
+           best ? n / (best / 1e9) : 0.0);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   free( objects);
+   free( threads);
+   free( records);
+
+   return( 0);
+}
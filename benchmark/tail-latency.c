@@ -0,0 +1,394 @@
+//
+// Latency of single operations, while the container grows from empty to
+// a given number of keys. Writers insert (hashmap) or add (pointerarray),
+// readers look up random keys at the same time. Every operation is timed
+// and counted in a log-linear histogram, so the inserts that run into a
+// migration show up in the tail. The migrations are observed with the
+// migration hook.
+//
+// usage: tail-latency [keys] [max threads]
+//
+// The default is 1M keys, with 1, 2, 4 and 8 threads. Half of the threads
+// (but at least one) are writers, the others readers. Each run is repeated
+// with a key count of 1/16 to see how the tail grows with the table.
+//
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_aba/mulle_aba.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//
+// A value v is counted in the bucket of its highest bit, which is split
+// into 2^SUB_BITS linear sub-buckets. So the error is at most 1/16, like
+// a HDR histogram with one significant digit.
+//
+#define SUB_BITS     4
+#define N_SUB        (1 << SUB_BITS)
+#define N_BUCKETS    (64 * N_SUB)
+
+#define MAX_THREADS  64
+
+
+struct histogram
+{
+   uint64_t   counts[ N_BUCKETS];
+   uint64_t   n;
+   uint64_t   max;
+};
+
+
+static unsigned int   histogram_index( uint64_t v)
+{
+   unsigned int   msb;
+
+   if( v < N_SUB)
+      return( (unsigned int) v);
+
+   msb = 63 - __builtin_clzll( v);
+   return( (msb - SUB_BITS + 1) * N_SUB + (unsigned int) ((v >> (msb - SUB_BITS)) & (N_SUB - 1)));
+}
+
+
+// the largest value, that falls into bucket i
+static uint64_t   histogram_value( unsigned int i)
+{
+   unsigned int   msb;
+
+   if( i < N_SUB)
+      return( i);
+
+   msb = i / N_SUB + SUB_BITS - 1;
+   return( ((uint64_t) (N_SUB + i % N_SUB) << (msb - SUB_BITS)) + ((uint64_t) 1 << (msb - SUB_BITS)) - 1);
+}
+
+
+static void   histogram_add( struct histogram *h, uint64_t v)
+{
+   h->counts[ histogram_index( v)]++;
+   h->n++;
+   if( v > h->max)
+      h->max = v;
+}
+
+
+static void   histogram_merge( struct histogram *dst, struct histogram *src)
+{
+   unsigned int   i;
+
+   for( i = 0; i < N_BUCKETS; i++)
+      dst->counts[ i] += src->counts[ i];
+   dst->n += src->n;
+   if( src->max > dst->max)
+      dst->max = src->max;
+}
+
+
+static uint64_t   histogram_percentile( struct histogram *h, double percentile)
+{
+   uint64_t       rank;
+   uint64_t       sum;
+   unsigned int   i;
+
+   if( ! h->n)
+      return( 0);
+
+   rank = (uint64_t) (h->n * percentile / 100.0);
+   if( rank >= h->n)
+      rank = h->n - 1;
+
+   sum = 0;
+   for( i = 0; i < N_BUCKETS; i++)
+   {
+      sum += h->counts[ i];
+      if( sum > rank)
+         break;
+   }
+   return( histogram_value( i) < h->max ? histogram_value( i) : h->max);
+}
+
+
+static void   histogram_print( char *name, struct histogram *h)
+{
+   if( ! h->n)
+      return;
+
+   printf( "   %-7s n=%-9lu p50=%-6lu p99=%-6lu p99.9=%-7lu max=%lu ns\n",
+           name,
+           (unsigned long) h->n,
+           (unsigned long) histogram_percentile( h, 50.0),
+           (unsigned long) histogram_percentile( h, 99.0),
+           (unsigned long) histogram_percentile( h, 99.9),
+           (unsigned long) h->max);
+}
+
+
+#pragma mark -
+#pragma mark migrations
+
+//
+// STARTED and SWAPPED of the same migration can come from different
+// threads, but there is only one migration of a container at a time.
+//
+static struct
+{
+   mulle_atomic_pointer_t   lock;
+   uint64_t                 started;
+   unsigned long            n;
+   uint64_t                 total;
+   uint64_t                 max;
+} migrations;
+
+
+static void   migrationhook( struct mulle_concurrent_migrationevent *event, void *userinfo)
+{
+   uint64_t   duration;
+
+   while( ! _mulle_atomic_pointer_compare_and_swap( &migrations.lock, (void *) 1, NULL))
+      mulle_thread_yield();
+
+   switch( event->type)
+   {
+   case MULLE_CONCURRENT_MIGRATION_STARTED :
+      migrations.started = event->start;
+      break;
+
+   case MULLE_CONCURRENT_MIGRATION_SWAPPED :
+      duration = event->timestamp - migrations.started;
+      migrations.n++;
+      migrations.total += duration;
+      if( duration > migrations.max)
+         migrations.max = duration;
+      break;
+   }
+
+   _mulle_atomic_pointer_write( &migrations.lock, NULL);
+}
+
+
+static void   migrations_reset( void)
+{
+   migrations.started = 0;
+   migrations.n       = 0;
+   migrations.total   = 0;
+   migrations.max     = 0;
+}
+
+
+#pragma mark -
+#pragma mark run
+
+enum container
+{
+   HASHMAP,
+   POINTERARRAY
+};
+
+
+struct shared
+{
+   enum container                         container;
+   struct mulle_concurrent_hashmap        map;
+   struct mulle_concurrent_pointerarray   array;
+   uintptr_t                              n_keys;
+   unsigned int                           n_writers;
+   mulle_atomic_pointer_t                 writers_done;
+};
+
+
+struct info
+{
+   struct shared      *shared;
+   unsigned int       index;
+   struct histogram   histogram;
+};
+
+
+// xorshift, so the lookups are not predictable by the prefetcher
+static uint64_t   next_random( uint64_t *state)
+{
+   uint64_t   x;
+
+   x  = *state;
+   x ^= x << 13;
+   x ^= x >> 7;
+   x ^= x << 17;
+   *state = x;
+   return( x);
+}
+
+
+static void   writer( struct info *info)
+{
+   struct shared   *shared;
+   uintptr_t       i;
+   uint64_t        start;
+   uint64_t        end;
+
+   mulle_aba_register();
+
+   shared = info->shared;
+   for( i = info->index + 1; i <= shared->n_keys; i += shared->n_writers)
+   {
+      start = mulle_concurrent_timestamp();
+      if( shared->container == HASHMAP)
+         mulle_concurrent_hashmap_insert( &shared->map, (intptr_t) i, (void *) (i * 8));
+      else
+         mulle_concurrent_pointerarray_add( &shared->array, (void *) (i * 8));
+      end = mulle_concurrent_timestamp();
+
+      histogram_add( &info->histogram, end - start);
+   }
+
+   _mulle_atomic_pointer_increment( &shared->writers_done);
+
+   mulle_aba_unregister();
+}
+
+
+static void   reader( struct info *info)
+{
+   struct shared   *shared;
+   uint64_t        state;
+   uint64_t        start;
+   uint64_t        end;
+   uintptr_t       n;
+   uintptr_t       key;
+
+   mulle_aba_register();
+
+   shared = info->shared;
+   state  = 0x9E3779B97F4A7C15ULL + info->index;
+   while( (uintptr_t) _mulle_atomic_pointer_read( &shared->writers_done) < shared->n_writers)
+   {
+      key = (uintptr_t) next_random( &state);
+
+      start = mulle_concurrent_timestamp();
+      if( shared->container == HASHMAP)
+         mulle_concurrent_hashmap_lookup( &shared->map, (intptr_t) (key % shared->n_keys) + 1);
+      else
+      {
+         n = mulle_concurrent_pointerarray_get_count( &shared->array);
+         if( n)
+            mulle_concurrent_pointerarray_get( &shared->array, key % n);
+      }
+      end = mulle_concurrent_timestamp();
+
+      histogram_add( &info->histogram, end - start);
+
+      // give the writers a chance on machines with few cores
+      if( ! (key & 0xFFF))
+         mulle_thread_yield();
+   }
+
+   mulle_aba_unregister();
+}
+
+
+static void   run( enum container container, uintptr_t n_keys, unsigned int n_threads)
+{
+   static struct info   infos[ MAX_THREADS];
+   struct shared        shared;
+   struct histogram     writes;
+   struct histogram     reads;
+   mulle_thread_t       threads[ MAX_THREADS];
+   unsigned int         n_writers;
+   unsigned int         i;
+
+   n_writers = n_threads / 2;
+   if( ! n_writers)
+      n_writers = 1;
+
+   memset( &shared, 0, sizeof( shared));
+   shared.container = container;
+   shared.n_keys    = n_keys;
+   shared.n_writers = n_writers;
+
+   if( container == HASHMAP)
+      mulle_concurrent_hashmap_init( &shared.map, 0, NULL);
+   else
+      mulle_concurrent_pointerarray_init( &shared.array, 0, NULL);
+
+   migrations_reset();
+
+   for( i = 0; i < n_threads; i++)
+   {
+      memset( &infos[ i], 0, sizeof( infos[ i]));
+      infos[ i].shared = &shared;
+      infos[ i].index  = i < n_writers ? i : i - n_writers;
+      if( mulle_thread_create( i < n_writers ? (void *) writer : (void *) reader, &infos[ i], &threads[ i]))
+      {
+         perror( "mulle_thread_create");
+         exit( 1);
+      }
+   }
+
+   for( i = 0; i < n_threads; i++)
+      mulle_thread_join( threads[ i]);
+
+   memset( &writes, 0, sizeof( writes));
+   memset( &reads, 0, sizeof( reads));
+   for( i = 0; i < n_threads; i++)
+      histogram_merge( i < n_writers ? &writes : &reads, &infos[ i].histogram);
+
+   printf( "%s keys=%lu threads=%u (writers=%u readers=%u)\n",
+           container == HASHMAP ? "hashmap" : "pointerarray",
+           (unsigned long) n_keys,
+           n_threads,
+           n_writers,
+           n_threads - n_writers);
+   histogram_print( container == HASHMAP ? "insert" : "add", &writes);
+   histogram_print( container == HASHMAP ? "lookup" : "get", &reads);
+   printf( "   migrations=%lu total=%.3f ms max=%.3f ms\n",
+           migrations.n,
+           migrations.total / 1e6,
+           migrations.max / 1e6);
+
+   if( container == HASHMAP)
+      mulle_concurrent_hashmap_done( &shared.map);
+   else
+      mulle_concurrent_pointerarray_done( &shared.array);
+}
+
+
+int   main( int argc, char *argv[])
+{
+   uintptr_t      n_keys;
+   unsigned int   max_threads;
+   unsigned int   n_threads;
+
+   n_keys      = argc > 1 ? (uintptr_t) strtoull( argv[ 1], NULL, 0) : 1024 * 1024;
+   max_threads = argc > 2 ? (unsigned int) strtoul( argv[ 2], NULL, 0) : 8;
+   if( max_threads > MAX_THREADS)
+      max_threads = MAX_THREADS;
+   if( n_keys < 16)
+      n_keys = 16;
+
+   if( ! mulle_concurrent_timestamp())
+   {
+      fprintf( stderr, "no monotonic clock\n");
+      return( 1);
+   }
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   mulle_concurrent_set_migrationhook( migrationhook, NULL);
+
+   for( n_threads = 1; n_threads <= max_threads; n_threads *= 2)
+   {
+      run( HASHMAP, n_keys / 16, n_threads);
+      run( HASHMAP, n_keys, n_threads);
+      run( POINTERARRAY, n_keys / 16, n_threads);
+      run( POINTERARRAY, n_keys, n_threads);
+   }
+
+   mulle_concurrent_set_migrationhook( NULL, NULL);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   return( 0);
+}
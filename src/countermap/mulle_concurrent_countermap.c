@@ -0,0 +1,495 @@
+//
+//  mulle_concurrent_countermap.c
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#include "mulle_concurrent_countermap.h"
+
+#include "mulle_concurrent_atomic.h"
+#include "mulle_concurrent_storagepool.h"
+#include "mulle_concurrent_types.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+//
+// The hash is CASed into an empty slot, the counter is added to afterwards.
+// The counter is kept shifted to the left by one, so that an add never
+// touches FROZEN_BIT.
+//
+struct _mulle_concurrent_hashcounterpair
+{
+   mulle_atomic_pointer_t   hash;
+   mulle_atomic_pointer_t   counter;
+};
+
+
+struct _mulle_concurrent_countermapstorage
+{
+   mulle_atomic_pointer_t   n_hashs;
+   mulle_atomic_pointer_t   n_moved;   // slots frozen and moved by the copy
+   uintptr_t                mask MULLE_CONCURRENT_CACHELINE_ALIGNED;
+
+   struct _mulle_concurrent_hashcounterpair  entries[ 1] MULLE_CONCURRENT_CACHELINE_ALIGNED;
+};
+
+
+#define FROZEN_BIT   1
+
+
+#pragma mark -
+#pragma mark _mulle_concurrent_countermapstorage
+
+// n must be a power of 2
+static struct _mulle_concurrent_countermapstorage *
+   _mulle_concurrent_alloc_countermapstorage( uintptr_t n,
+                                              struct mulle_allocator *allocator)
+{
+   struct _mulle_concurrent_countermapstorage   *p;
+   size_t                                       size;
+
+   assert( (~(n - 1) & n) == n);
+
+   if( n < 4)
+      n = 4;
+
+   size = sizeof( struct _mulle_concurrent_hashcounterpair) * (n - 1) +
+          sizeof( struct _mulle_concurrent_countermapstorage);
+
+   p = _mulle_concurrent_storagepool_calloc( size, allocator);
+   if( ! p)
+      return( NULL);
+
+   p->mask = n - 1;
+
+   if( MULLE_CONCURRENT_NO_HASH)
+   {
+      struct _mulle_concurrent_hashcounterpair   *q;
+      struct _mulle_concurrent_hashcounterpair   *sentinel;
+
+      q        = p->entries;
+      sentinel = &p->entries[ p->mask];
+      while( q <= sentinel)
+      {
+         _mulle_atomic_pointer_nonatomic_write( &q->hash, (void *) MULLE_CONCURRENT_NO_HASH);
+         ++q;
+      }
+   }
+
+   return( p);
+}
+
+
+static inline int
+   _mulle_concurrent_countermapstorage_is_full( struct _mulle_concurrent_countermapstorage *p)
+{
+   uintptr_t   size;
+
+   size = p->mask + 1;
+   return( (uintptr_t) _mulle_atomic_pointer_read( &p->n_hashs) >= size - (size >> 1));
+}
+
+
+//
+// Returns:
+//   0      : OK, *counter is set
+//   ENOENT : not found
+//   EBUSY  : ran into a migrated slot
+//
+static int   _mulle_concurrent_countermapstorage_get( struct _mulle_concurrent_countermapstorage *p,
+                                                      intptr_t hash,
+                                                      intptr_t *counter)
+{
+   struct _mulle_concurrent_hashcounterpair   *entry;
+   intptr_t                                   found;
+   intptr_t                                   value;
+   uintptr_t                                  index;
+   uintptr_t                                  sentinel;
+
+   index    = (uintptr_t) hash;
+   sentinel = index + p->mask + 1;
+
+   for(;;)
+   {
+      entry = &p->entries[ index & p->mask];
+      found = (intptr_t) _mulle_concurrent_atomic_pointer_read_acquire( &entry->hash);
+
+      if( found == hash || found == MULLE_CONCURRENT_NO_HASH)
+      {
+         value = (intptr_t) _mulle_concurrent_atomic_pointer_read_acquire( &entry->counter);
+         if( value & FROZEN_BIT)
+            return( EBUSY);
+         if( found == MULLE_CONCURRENT_NO_HASH)
+            return( ENOENT);
+
+         *counter = value >> 1;
+         return( 0);
+      }
+
+      ++index;
+      assert( index != sentinel);  // can't happen we always leave space
+   }
+}
+
+
+//
+// add:
+//
+//  0      : did add
+//  EBUSY  : this storage can't be written to
+//
+static int   _mulle_concurrent_countermapstorage_add( struct _mulle_concurrent_countermapstorage *p,
+                                                      intptr_t hash,
+                                                      intptr_t delta)
+{
+   struct _mulle_concurrent_hashcounterpair   *entry;
+   intptr_t                                   found;
+   intptr_t                                   step;
+   intptr_t                                   old;
+   uintptr_t                                  index;
+   uintptr_t                                  sentinel;
+
+   assert( hash != MULLE_CONCURRENT_NO_HASH);
+
+   index    = (uintptr_t) hash;
+   sentinel = index + p->mask + 1;
+
+   for(;;)
+   {
+      entry = &p->entries[ index & p->mask];
+      found = (intptr_t) _mulle_atomic_pointer_read( &entry->hash);
+
+      if( found == MULLE_CONCURRENT_NO_HASH)
+      {
+         found = (intptr_t) __mulle_atomic_pointer_compare_and_swap( &entry->hash,
+                                                                      (void *) hash,
+                                                                      (void *) MULLE_CONCURRENT_NO_HASH);
+         if( found == MULLE_CONCURRENT_NO_HASH)
+         {
+            _mulle_atomic_pointer_increment( &p->n_hashs);
+            found = hash;
+         }
+      }
+
+      if( found == hash)
+         break;
+
+      ++index;
+      assert( index != sentinel);  // can't happen we always leave space
+   }
+
+   // if the slot was frozen before, this add is garbage and must be redone
+   step = (intptr_t) ((uintptr_t) delta << 1);
+   old  = (intptr_t) _mulle_atomic_pointer_add( &entry->counter, step) - step;
+   return( (old & FROZEN_BIT) ? EBUSY : 0);
+}
+
+
+//
+// Every slot is frozen, also the empty ones. Only the thread, that froze a
+// slot, moves its counter into 'dst', so nothing is counted twice. Adds that
+// come after the freeze see FROZEN_BIT and are redone in the new storage.
+// 'dst' isn't the storage yet, so nothing else is added to it and it has
+// room for all hashs of 'src'. Returns the number of slots this thread
+// froze.
+//
+static uintptr_t   _mulle_concurrent_countermapstorage_copy( struct _mulle_concurrent_countermapstorage *dst,
+                                                             struct _mulle_concurrent_countermapstorage *src)
+{
+   struct _mulle_concurrent_hashcounterpair   *p;
+   struct _mulle_concurrent_hashcounterpair   *p_last;
+   intptr_t                                   hash;
+   intptr_t                                   value;
+   uintptr_t                                  n;
+
+   n      = 0;
+   p      = src->entries;
+   p_last = &src->entries[ src->mask];
+
+   for( ;p <= p_last; p++)
+   {
+      value = (intptr_t) _mulle_atomic_pointer_read( &p->counter);
+      while( ! (value & FROZEN_BIT))
+      {
+         if( _mulle_atomic_pointer_compare_and_swap( &p->counter,
+                                                     (void *) (value | FROZEN_BIT),
+                                                     (void *) value))
+         {
+            // an add only happens after the hash has been set
+            hash = (intptr_t) _mulle_atomic_pointer_read( &p->hash);
+            if( hash != MULLE_CONCURRENT_NO_HASH)
+               _mulle_concurrent_countermapstorage_add( dst, hash, value >> 1);
+            ++n;
+            break;
+         }
+         value = (intptr_t) _mulle_atomic_pointer_read( &p->counter);
+      }
+   }
+   return( n);
+}
+
+
+#pragma mark -
+#pragma mark _mulle_concurrent_countermap
+
+int  _mulle_concurrent_countermap_init( struct mulle_concurrent_countermap *map,
+                                        uintptr_t size,
+                                        struct mulle_allocator *allocator)
+{
+   struct _mulle_concurrent_countermapstorage   *storage;
+
+   if( ! allocator)
+      allocator = &mulle_default_allocator;
+
+   assert( allocator->abafree && allocator->abafree != (int (*)()) abort);
+   if( ! allocator->abafree || allocator->abafree == (int (*)()) abort)
+      return( EINVAL);
+
+   map->allocator = allocator;
+   storage        = _mulle_concurrent_alloc_countermapstorage( size, allocator);
+
+   if( ! storage)
+      return( ENOMEM);
+
+   _mulle_atomic_pointer_nonatomic_write( &map->storage.pointer, storage);
+   _mulle_atomic_pointer_nonatomic_write( &map->next_storage.pointer, storage);
+
+   return( 0);
+}
+
+
+//
+// this is called when you know, no other threads are accessing it anymore
+//
+void  _mulle_concurrent_countermap_done( struct mulle_concurrent_countermap *map)
+{
+   struct _mulle_concurrent_countermapstorage   *storage;
+   struct _mulle_concurrent_countermapstorage   *next_storage;
+
+   storage      = _mulle_atomic_pointer_nonatomic_read( &map->storage.pointer);
+   next_storage = _mulle_atomic_pointer_nonatomic_read( &map->next_storage.pointer);
+
+   _mulle_concurrent_storagepool_abafree( storage);
+   if( storage != next_storage)
+      _mulle_concurrent_storagepool_abafree( next_storage);
+}
+
+
+uintptr_t   _mulle_concurrent_countermap_get_size( struct mulle_concurrent_countermap *map)
+{
+   struct _mulle_concurrent_countermapstorage   *p;
+
+   p = _mulle_atomic_pointer_read( &map->storage.pointer);
+   return( p->mask + 1);
+}
+
+
+//
+// same as _mulle_concurrent_hashmap_migrate_storage, except that 'q' only
+// becomes the storage, when all counters have arrived in it. Otherwise a
+// get could miss a counter, that has been frozen in 'p' but not yet added
+// to 'q'. So the thread, that completes the move, switches the storage.
+//
+static int  _mulle_concurrent_countermap_migrate_storage( struct mulle_concurrent_countermap *map,
+                                                          struct _mulle_concurrent_countermapstorage *p)
+{
+   struct _mulle_concurrent_countermapstorage   *q;
+   struct _mulle_concurrent_countermapstorage   *alloced;
+   struct _mulle_concurrent_countermapstorage   *previous;
+   uintptr_t                                    n;
+
+   assert( p);
+
+   q = _mulle_atomic_pointer_read( &map->next_storage.pointer);
+   if( q == p)
+   {
+      alloced = _mulle_concurrent_alloc_countermapstorage( (p->mask + 1) * 2, map->allocator);
+      if( ! alloced)
+         return( ENOMEM);
+
+      q = __mulle_atomic_pointer_compare_and_swap( &map->next_storage.pointer, alloced, p);
+      if( q != p)
+         _mulle_concurrent_storagepool_abafree( alloced);  // ABA!!
+      else
+         q = alloced;
+   }
+
+   n = _mulle_concurrent_countermapstorage_copy( q, p);
+   if( ! n)
+      return( 0);
+   if( (uintptr_t) _mulle_atomic_pointer_add( &p->n_moved, (intptr_t) n) != p->mask + 1)
+      return( 0);
+
+   previous = __mulle_atomic_pointer_compare_and_swap( &map->storage.pointer, q, p);
+   if( previous == p)
+      _mulle_concurrent_storagepool_abafree( previous); // ABA!!
+
+   return( 0);
+}
+
+
+intptr_t   _mulle_concurrent_countermap_get( struct mulle_concurrent_countermap *map,
+                                             intptr_t hash)
+{
+   struct _mulle_concurrent_countermapstorage   *p;
+   intptr_t                                     counter;
+
+retry:
+   p = _mulle_concurrent_atomic_pointer_read_acquire( &map->storage.pointer);
+   switch( _mulle_concurrent_countermapstorage_get( p, hash, &counter))
+   {
+   case ENOENT :
+      return( 0);
+
+   case EBUSY  :
+      if( _mulle_concurrent_countermap_migrate_storage( map, p))
+         return( 0);
+      goto retry;
+   }
+   return( counter);
+}
+
+
+int   _mulle_concurrent_countermap_add( struct mulle_concurrent_countermap *map,
+                                        intptr_t hash,
+                                        intptr_t delta)
+{
+   struct _mulle_concurrent_countermapstorage   *p;
+
+   assert( hash != MULLE_CONCURRENT_NO_HASH);
+
+retry:
+   p = _mulle_atomic_pointer_read( &map->storage.pointer);
+   assert( p);
+
+   if( _mulle_concurrent_countermapstorage_is_full( p) ||
+       _mulle_concurrent_countermapstorage_add( p, hash, delta) == EBUSY)
+   {
+      if( _mulle_concurrent_countermap_migrate_storage( map, p))
+         return( ENOMEM);
+      goto retry;
+   }
+
+   return( 0);
+}
+
+
+#pragma mark -
+#pragma mark not so concurrent enumerator
+
+int  _mulle_concurrent_countermapenumerator_next( struct mulle_concurrent_countermapenumerator *rover,
+                                                  intptr_t *p_hash,
+                                                  intptr_t *p_counter)
+{
+   struct _mulle_concurrent_countermapstorage   *p;
+   struct _mulle_concurrent_hashcounterpair     *entry;
+   intptr_t                                     hash;
+   intptr_t                                     value;
+
+retry:
+   p = _mulle_concurrent_atomic_pointer_read_acquire( &rover->map->storage.pointer);
+   if( rover->mask && p->mask != rover->mask)
+      return( ECANCELED);
+
+   for(;;)
+   {
+      if( rover->index > p->mask)
+         return( 0);
+
+      entry = &p->entries[ rover->index];
+      hash  = (intptr_t) _mulle_concurrent_atomic_pointer_read_acquire( &entry->hash);
+      if( hash == MULLE_CONCURRENT_NO_HASH)
+      {
+         rover->index++;
+         continue;
+      }
+
+      value = (intptr_t) _mulle_concurrent_atomic_pointer_read_acquire( &entry->counter);
+      if( value & FROZEN_BIT)
+      {
+         if( _mulle_concurrent_countermap_migrate_storage( rover->map, p))
+            return( ENOMEM);
+         goto retry;
+      }
+
+      rover->index++;
+      break;
+   }
+
+   if( p_hash)
+      *p_hash = hash;
+   if( p_counter)
+      *p_counter = value >> 1;
+
+   if( ! rover->mask)
+      rover->mask = p->mask;
+
+   return( 1);
+}
+
+
+#pragma mark -
+#pragma mark enumerator based code
+
+//
+// obviously just a snapshot at some recent point in time
+//
+uintptr_t   mulle_concurrent_countermap_count( struct mulle_concurrent_countermap *map)
+{
+   uintptr_t                                      count;
+   int                                            rval;
+   struct mulle_concurrent_countermapenumerator   rover;
+
+retry:
+   count = 0;
+
+   rover = mulle_concurrent_countermap_enumerate( map);
+   for(;;)
+   {
+      rval = _mulle_concurrent_countermapenumerator_next( &rover, NULL, NULL);
+      if( rval == 1)
+      {
+         ++count;
+         continue;
+      }
+
+      if( ! rval)
+         break;
+
+      mulle_concurrent_countermapenumerator_done( &rover);
+      goto retry;
+   }
+
+   mulle_concurrent_countermapenumerator_done( &rover);
+   return( count);
+}
@@ -0,0 +1,232 @@
+//
+//  mulle_concurrent_countermap.h
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#ifndef mulle_concurrent_countermap_h__
+#define mulle_concurrent_countermap_h__
+
+#include <mulle_thread/mulle_thread.h>
+#include <mulle_allocator/mulle_allocator.h>
+
+#include "mulle_concurrent_types.h"
+
+
+//
+// A map of hashes to integer counters, that are stored in the slots. An add
+// is a fetch-add on the slot. The lowest bit of a slot is set, when the
+// migration has taken the counter over, so the counters have one bit less
+// than an intptr_t and wrap around at that size.
+//
+// Exactly one thread moves a counter into the new storage. Until it has, a
+// get may see the counter without the adds, that went into the old storage.
+// No add is lost.
+//
+struct _mulle_concurrent_countermapstorage;
+
+
+union mulle_concurrent_atomiccountermapstorage_t
+{
+   struct _mulle_concurrent_countermapstorage  *storage;
+   mulle_atomic_pointer_t                      pointer;
+};
+
+
+//
+// migrates like mulle_concurrent_hashmap
+//
+struct mulle_concurrent_countermap
+{
+   union mulle_concurrent_atomiccountermapstorage_t   storage MULLE_CONCURRENT_CACHELINE_ALIGNED;
+   struct mulle_allocator                             *allocator;
+   union mulle_concurrent_atomiccountermapstorage_t   next_storage MULLE_CONCURRENT_CACHELINE_ALIGNED;
+};
+
+
+#pragma mark -
+#pragma mark single-threaded
+
+
+// Returns:
+//   0      : OK
+//   EINVAL : invalid argument
+//   ENOMEM : out of memory
+//
+static inline int  mulle_concurrent_countermap_init( struct mulle_concurrent_countermap *map,
+                                                     uintptr_t size,
+                                                     struct mulle_allocator *allocator)
+{
+   int  _mulle_concurrent_countermap_init( struct mulle_concurrent_countermap *map,
+                                           uintptr_t size,
+                                           struct mulle_allocator *allocator);
+   if( ! map)
+      return( EINVAL);
+   return( _mulle_concurrent_countermap_init( map, size, allocator));
+}
+
+
+static inline void  mulle_concurrent_countermap_done( struct mulle_concurrent_countermap *map)
+{
+   void  _mulle_concurrent_countermap_done( struct mulle_concurrent_countermap *map);
+
+   if( map)
+      _mulle_concurrent_countermap_done( map);
+}
+
+
+static inline uintptr_t   mulle_concurrent_countermap_get_size( struct mulle_concurrent_countermap *map)
+{
+   uintptr_t   _mulle_concurrent_countermap_get_size( struct mulle_concurrent_countermap *map);
+
+   if( ! map)
+      return( 0);
+   return( _mulle_concurrent_countermap_get_size( map));
+}
+
+
+#pragma mark -
+#pragma mark multi-threaded
+
+// Adds delta to the counter of hash. A missing counter starts at 0.
+//
+// Return value (rval):
+//   0      : OK
+//   EINVAL : invalid argument
+//   ENOMEM : must be out of memory
+//
+// Do not use hash=0
+//
+static inline int   mulle_concurrent_countermap_add( struct mulle_concurrent_countermap *map,
+                                                     intptr_t hash,
+                                                     intptr_t delta)
+{
+   int   _mulle_concurrent_countermap_add( struct mulle_concurrent_countermap *map,
+                                           intptr_t hash,
+                                           intptr_t delta);
+
+   if( ! map || hash == MULLE_CONCURRENT_NO_HASH)
+      return( EINVAL);
+   return( _mulle_concurrent_countermap_add( map, hash, delta));
+}
+
+
+// rval is the counter of hash, 0 if there is none
+
+static inline intptr_t   mulle_concurrent_countermap_get( struct mulle_concurrent_countermap *map,
+                                                          intptr_t hash)
+{
+   intptr_t   _mulle_concurrent_countermap_get( struct mulle_concurrent_countermap *map,
+                                                intptr_t hash);
+
+   if( ! map || hash == MULLE_CONCURRENT_NO_HASH)
+      return( 0);
+   return( _mulle_concurrent_countermap_get( map, hash));
+}
+
+
+#pragma mark -
+#pragma mark limited multi-threaded
+
+struct mulle_concurrent_countermapenumerator
+{
+   struct mulle_concurrent_countermap   *map;
+   uintptr_t                            index;
+   uintptr_t                            mask;
+};
+
+
+//
+// same rules as for mulle_concurrent_hashmapenumerator
+//
+static inline struct mulle_concurrent_countermapenumerator  mulle_concurrent_countermap_enumerate( struct mulle_concurrent_countermap *map)
+{
+   struct mulle_concurrent_countermapenumerator   rover;
+
+   rover.map   = map;
+   rover.index = map ? 0 : (uintptr_t) -1;
+   rover.mask  = 0;
+
+   return( rover);
+}
+
+
+//  1         : OK
+//  0         : nothing left
+// ECANCELLED : mutation alert
+// ENOMEM     : out of memory
+// EINVAL     : wrong parameter value
+
+static inline int  mulle_concurrent_countermapenumerator_next( struct mulle_concurrent_countermapenumerator *rover,
+                                                               intptr_t *hash,
+                                                               intptr_t *counter)
+{
+   int  _mulle_concurrent_countermapenumerator_next( struct mulle_concurrent_countermapenumerator *rover,
+                                                     intptr_t *hash,
+                                                     intptr_t *counter);
+   if( ! rover)
+      return( -EINVAL);
+   return( _mulle_concurrent_countermapenumerator_next( rover, hash, counter));
+}
+
+
+static inline void  mulle_concurrent_countermapenumerator_done( struct mulle_concurrent_countermapenumerator *rover)
+{
+}
+
+
+#pragma mark -
+#pragma mark enumerator conveniences
+
+uintptr_t   mulle_concurrent_countermap_count( struct mulle_concurrent_countermap *map);
+
+
+#pragma mark -
+#pragma mark various functions, no parameter checks
+
+int  _mulle_concurrent_countermap_init( struct mulle_concurrent_countermap *map,
+                                        uintptr_t size,
+                                        struct mulle_allocator *allocator);
+void  _mulle_concurrent_countermap_done( struct mulle_concurrent_countermap *map);
+
+uintptr_t   _mulle_concurrent_countermap_get_size( struct mulle_concurrent_countermap *map);
+
+int   _mulle_concurrent_countermap_add( struct mulle_concurrent_countermap *map,
+                                        intptr_t hash,
+                                        intptr_t delta);
+
+intptr_t   _mulle_concurrent_countermap_get( struct mulle_concurrent_countermap *map,
+                                             intptr_t hash);
+
+int  _mulle_concurrent_countermapenumerator_next( struct mulle_concurrent_countermapenumerator *rover,
+                                                  intptr_t *hash,
+                                                  intptr_t *counter);
+
+#endif /* mulle_concurrent_countermap_h */
@@ -35,49 +35,121 @@
 //
 #include "mulle_concurrent_hashmap.h"
 
+#include "mulle_concurrent_atomic.h"
+#include "mulle_concurrent_migrationhook.h"
+#include "mulle_concurrent_storagepool.h"
+#include "mulle_concurrent_trace.h"
 #include "mulle_concurrent_types.h"
 #include <assert.h>
 #include <errno.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 
-struct _mulle_concurrent_hashvaluepair
-{
-   intptr_t                 hash;
-   mulle_atomic_pointer_t   value;
-};
-
-
+//
+// _mulle_concurrent_hashvaluepair is defined in the header, because of
+// the inline storage. Keep _mulle_concurrent_hashmapinlinestorage in sync
+// with this
+//
 struct _mulle_concurrent_hashmapstorage
 {
    mulle_atomic_pointer_t   n_hashs;  // with possibly empty values
-   uintptr_t                mask;     // easier to read from debugger if void * size
+   uintptr_t                mask MULLE_CONCURRENT_CACHELINE_ALIGNED;  // easier to read from debugger if void * size
    
-   struct _mulle_concurrent_hashvaluepair  entries[ 1];
+   struct _mulle_concurrent_hashvaluepair  entries[ 1] MULLE_CONCURRENT_CACHELINE_ALIGNED;
 };
 
 
 #define REDIRECT_VALUE     MULLE_CONCURRENT_INVALID_POINTER
 
+
+//
+// In larger storages new hashes are not counted in n_hashs directly, but
+// in one of N_STRIPES counters, picked by thread. A stripe is added to
+// n_hashs, when it reaches the quota of the storage. So n_hashs lags behind
+// by less than N_STRIPES * quota, which is subtracted from the maximum to
+// stay on the safe side. The quota is chosen so that this is at most 1/8 of
+// the maximum. Small storages have a quota of 1 and no stripes. The stripes
+// live behind the entries, each on a cache line of its own.
+//
+#define N_STRIPES      16
+#define STRIPE_SHIFT   4
+
+#ifdef MULLE_CONCURRENT_CACHELINE_SIZE
+# define STRIPE_SIZE   MULLE_CONCURRENT_CACHELINE_SIZE
+#else
+# define STRIPE_SIZE   64
+#endif
+
+
 #pragma mark -
 #pragma mark _mulle_concurrent_hashmapstorage
 
 
+static inline uintptr_t   _mulle_concurrent_hashmapstorage_quota_for_size( uintptr_t size)
+{
+   uintptr_t   quota;
+
+   quota = (size - (size >> 1)) / (N_STRIPES * 8);
+   return( quota ? quota : 1);
+}
+
+
+static inline uintptr_t
+   _mulle_concurrent_hashmapstorage_get_quota( struct _mulle_concurrent_hashmapstorage *p)
+{
+   return( _mulle_concurrent_hashmapstorage_quota_for_size( p->mask + 1));
+}
+
+
+static inline mulle_atomic_pointer_t  *
+   _mulle_concurrent_hashmapstorage_get_stripe( struct _mulle_concurrent_hashmapstorage *p)
+{
+   uintptr_t   stripes;
+   uintptr_t   i;
+
+   stripes = ((uintptr_t) &p->entries[ p->mask + 1] + STRIPE_SIZE - 1) & ~(uintptr_t) (STRIPE_SIZE - 1);
+
+   // fibonacci hashing of the thread, the top bits are the best
+   i = (uintptr_t) mulle_thread_self() * (uintptr_t) 0x9E3779B97F4A7C15ULL;
+   i >>= sizeof( uintptr_t) * 8 - STRIPE_SHIFT;
+
+   return( (mulle_atomic_pointer_t *) (stripes + i * STRIPE_SIZE));
+}
+
+
+static size_t   _mulle_concurrent_hashmapstorage_bytes_for_size( uintptr_t n)
+{
+   size_t   size;
+
+   size = sizeof( struct _mulle_concurrent_hashvaluepair) * (n - 1) +
+          sizeof( struct _mulle_concurrent_hashmapstorage);
+   if( _mulle_concurrent_hashmapstorage_quota_for_size( n) > 1)
+      size += (N_STRIPES + 1) * STRIPE_SIZE;
+   return( size);
+}
+
+
 // n must be a power of 2
 static struct _mulle_concurrent_hashmapstorage *
-   _mulle_concurrent_alloc_hashmapstorage( unsigned int n,
+   _mulle_concurrent_alloc_hashmapstorage( uintptr_t n,
                                            struct mulle_allocator *allocator)
 {
    struct _mulle_concurrent_hashmapstorage  *p;
+   size_t                                   size;
    
    assert( (~(n - 1) & n) == n);
    
    if( n < 4)
       n = 4;
    
-   p = _mulle_allocator_calloc( allocator, 1, sizeof( struct _mulle_concurrent_hashvaluepair) * (n - 1) +
-                             sizeof( struct _mulle_concurrent_hashmapstorage));
+   size = _mulle_concurrent_hashmapstorage_bytes_for_size( n);
+
+   p = _mulle_concurrent_storagepool_calloc( size, allocator);
+   if( ! p)
+      return( NULL);
    
    p->mask = n - 1;
    
@@ -91,7 +163,7 @@ static struct _mulle_concurrent_hashmapstorage *
       struct _mulle_concurrent_hashvaluepair   *sentinel;
       
       q        = p->entries;
-      sentinel = &p->entries[ (unsigned int) p->mask];
+      sentinel = &p->entries[ p->mask];
       while( q <= sentinel)
       {
          q->hash  = MULLE_CONCURRENT_NO_HASH;
@@ -104,63 +176,114 @@ static struct _mulle_concurrent_hashmapstorage *
 }
 
 
-static unsigned int
+//
+// the hash of an entry is written after its value has been CASed in, so
+// another thread that lost the CAS may have to wait a little for it
+//
+static intptr_t   _mulle_concurrent_hashvaluepair_wait_hash( struct _mulle_concurrent_hashvaluepair *entry)
+{
+   intptr_t   hash;
+
+   while( (hash = _mulle_concurrent_atomic_hash_read( &entry->hash)) == MULLE_CONCURRENT_NO_HASH)
+      mulle_thread_yield();
+   return( hash);
+}
+
+
+static uintptr_t
    _mulle_concurrent_hashmapstorage_get_max_n_hashs( struct _mulle_concurrent_hashmapstorage *p)
 {
-   unsigned int   size;
-   unsigned int   max;
+   uintptr_t   size;
+   uintptr_t   max;
    
-   size = (unsigned int) p->mask + 1;
+   size = p->mask + 1;
    max  = size - (size >> 1);
+   max -= N_STRIPES * (_mulle_concurrent_hashmapstorage_get_quota( p) - 1);
    return( max);
 }
 
 
+static void   _mulle_concurrent_hashmapstorage_count_hash( struct _mulle_concurrent_hashmapstorage *p)
+{
+   mulle_atomic_pointer_t   *stripe;
+   uintptr_t                quota;
+   uintptr_t                n;
+
+   quota = _mulle_concurrent_hashmapstorage_get_quota( p);
+   if( quota == 1)
+   {
+      _mulle_atomic_pointer_increment( &p->n_hashs);
+      return;
+   }
+
+   stripe = _mulle_concurrent_hashmapstorage_get_stripe( p);
+   for(;;)
+   {
+      n = (uintptr_t) _mulle_atomic_pointer_read( stripe);
+      if( n + 1 < quota)
+      {
+         if( _mulle_atomic_pointer_compare_and_swap( stripe, (void *) (n + 1), (void *) n))
+            return;
+         continue;
+      }
+
+      if( _mulle_atomic_pointer_compare_and_swap( stripe, NULL, (void *) n))
+      {
+         _mulle_atomic_pointer_add( &p->n_hashs, (intptr_t) quota);
+         return;
+      }
+   }
+}
+
+
 static void   *_mulle_concurrent_hashmapstorage_lookup( struct _mulle_concurrent_hashmapstorage *p,
                                                         intptr_t hash)
 {
    struct _mulle_concurrent_hashvaluepair   *entry;
-   unsigned int                             index;
-   unsigned int                             sentinel;
+   intptr_t                                 found;
+   uintptr_t                                index;
+   uintptr_t                                sentinel;
    
-   index    = (unsigned int) hash;
-   sentinel = index + (unsigned int) p->mask + 1;
+   index    = (uintptr_t) hash;
+   sentinel = index + p->mask + 1;
 
    for(;;)
    {
-      entry = &p->entries[ index & (unsigned int) p->mask];
+      entry = &p->entries[ index & p->mask];
+      found = _mulle_concurrent_atomic_hash_read( &entry->hash);
 
-      if( entry->hash == MULLE_CONCURRENT_NO_HASH)
+      if( found == MULLE_CONCURRENT_NO_HASH)
          return( MULLE_CONCURRENT_NO_POINTER);
       
-      if( entry->hash == hash)
-         return( _mulle_atomic_pointer_read( &entry->value));
+      if( found == hash)
+         return( _mulle_concurrent_atomic_pointer_read_acquire( &entry->value));
       
       ++index;
       assert( index != sentinel);  // can't happen we always leave space
+      MULLE_CONCURRENT_STATS_COUNT( HASHMAP, PROBE_STEPS);
    }
 }
 
 
 static struct _mulle_concurrent_hashvaluepair  *
     _mulle_concurrent_hashmapstorage_next_pair( struct _mulle_concurrent_hashmapstorage *p,
-                                                unsigned int *index)
+                                                uintptr_t *index)
 {
    struct _mulle_concurrent_hashvaluepair   *entry;
    struct _mulle_concurrent_hashvaluepair   *sentinel;
    
    entry    = &p->entries[ *index];
-   sentinel = &p->entries[ (unsigned int) p->mask + 1];
+   sentinel = &p->entries[ p->mask + 1];
 
    while( entry < sentinel)
    {
-      if( entry->hash == MULLE_CONCURRENT_NO_HASH)
+      if( _mulle_concurrent_atomic_hash_read( &entry->hash) == MULLE_CONCURRENT_NO_HASH)
       {
          ++entry;
          continue;
       }
       
-      *index = (unsigned int) (entry - p->entries) + 1;
+      *index = (uintptr_t) (entry - p->entries) + 1;
       return( entry);
    }
    return( NULL);
@@ -179,41 +302,46 @@ static int   _mulle_concurrent_hashmapstorage_insert( struct _mulle_concurrent_h
                                                       void *value)
 {
    struct _mulle_concurrent_hashvaluepair   *entry;
-   void                               *found;
-   unsigned int                       index;
-   unsigned int                       sentinel;
+   intptr_t                                 other;
+   void                                     *found;
+   uintptr_t                                index;
+   uintptr_t                                sentinel;
    
    assert( hash != MULLE_CONCURRENT_NO_HASH);
    assert( value != MULLE_CONCURRENT_NO_POINTER && value != MULLE_CONCURRENT_INVALID_POINTER);
 
-   index    = (unsigned int) hash;
-   sentinel = (unsigned int) (index + (unsigned int) p->mask + 1);
+   index    = (uintptr_t) hash;
+   sentinel = index + p->mask + 1;
    
    for(;;)
    {
-      entry = &p->entries[ index & (unsigned int) p->mask];
+      entry = &p->entries[ index & p->mask];
+      other = _mulle_concurrent_atomic_hash_read( &entry->hash);
 
-      if( entry->hash == MULLE_CONCURRENT_NO_HASH || entry->hash == hash)
+      if( other == MULLE_CONCURRENT_NO_HASH || other == hash)
       {
          found = __mulle_atomic_pointer_compare_and_swap( &entry->value, value, MULLE_CONCURRENT_NO_POINTER);
-         if( found != MULLE_CONCURRENT_NO_POINTER)
+         if( found == MULLE_CONCURRENT_NO_POINTER)
          {
-            if( found == REDIRECT_VALUE)
-               return( EBUSY);
-            return( EEXIST);
+            if( _mulle_concurrent_atomic_hash_read( &entry->hash) == MULLE_CONCURRENT_NO_HASH)
+            {
+               _mulle_concurrent_hashmapstorage_count_hash( p);
+               _mulle_concurrent_atomic_hash_write( &entry->hash, hash);
+            }
+            return( 0);
          }
 
-         if( ! entry->hash)
-         {
-            _mulle_atomic_pointer_increment( &p->n_hashs);
-            entry->hash = hash;
-         }
-         
-         return( 0);
+         if( found == REDIRECT_VALUE)
+            return( EBUSY);
+
+         // someone else got the slot, but possibly for another hash
+         if( _mulle_concurrent_hashvaluepair_wait_hash( entry) == hash)
+            return( EEXIST);
       }
       
       ++index;
       assert( index != sentinel);  // can't happen we always leave space
+      MULLE_CONCURRENT_STATS_COUNT( HASHMAP, PROBE_STEPS);
    }
 }
 
@@ -223,21 +351,23 @@ static int   _mulle_concurrent_hashmapstorage_put( struct _mulle_concurrent_hash
                                                    void *value)
 {
    struct _mulle_concurrent_hashvaluepair   *entry;
+   intptr_t                                 other;
    void                                     *found;
    void                                     *expect;
-   unsigned int                             index;
-   unsigned int                             sentinel;
+   uintptr_t                                index;
+   uintptr_t                                sentinel;
    
-   assert( value);
+   assert( value != MULLE_CONCURRENT_NO_POINTER && value != MULLE_CONCURRENT_INVALID_POINTER);
 
-   index    = (unsigned int) hash;
-   sentinel = (unsigned int) (index + (unsigned int) p->mask + 1);
+   index    = (uintptr_t) hash;
+   sentinel = index + p->mask + 1;
    
    for(;;)
    {
-      entry = &p->entries[ index & (unsigned int) p->mask];
+      entry = &p->entries[ index & p->mask];
+      other = _mulle_concurrent_atomic_hash_read( &entry->hash);
 
-      if( entry->hash == hash)
+      if( other == hash)
       {
          expect = MULLE_CONCURRENT_NO_POINTER;
          for(;;)
@@ -251,87 +381,115 @@ static int   _mulle_concurrent_hashmapstorage_put( struct _mulle_concurrent_hash
          }
       }
       
-      if( entry->hash == MULLE_CONCURRENT_NO_HASH)
+      if( other == MULLE_CONCURRENT_NO_HASH)
       {
          found = __mulle_atomic_pointer_compare_and_swap( &entry->value, value, MULLE_CONCURRENT_NO_POINTER);
-         if( found != MULLE_CONCURRENT_NO_POINTER)
+         if( found == MULLE_CONCURRENT_NO_POINTER)
          {
-            if( found == REDIRECT_VALUE)
-               return( EBUSY);
-            return( EEXIST);
+            _mulle_concurrent_hashmapstorage_count_hash( p);
+            _mulle_concurrent_atomic_hash_write( &entry->hash, hash);
+            return( 0);
          }
 
-         _mulle_atomic_pointer_increment( &p->n_hashs);
-         entry->hash = hash;
-         
-         return( 0);
+         if( found == REDIRECT_VALUE)
+            return( EBUSY);
+
+         // someone else got the slot, look at it again with its hash
+         _mulle_concurrent_hashvaluepair_wait_hash( entry);
+         continue;
       }
    
       ++index;
       assert( index != sentinel);  // can't happen we always leave space
+      MULLE_CONCURRENT_STATS_COUNT( HASHMAP, PROBE_STEPS);
    }
 }
 
 
-static int   _mulle_concurrent_hashmapstorage_remove( struct _mulle_concurrent_hashmapstorage *p,
-                                                      intptr_t hash,
-                                                      void *value)
+//
+// replaces the value of 'hash' with 'value', if it is still 'expect'.
+// With MULLE_CONCURRENT_NO_POINTER as 'value', this is a remove.
+//
+static int   _mulle_concurrent_hashmapstorage_replace( struct _mulle_concurrent_hashmapstorage *p,
+                                                       intptr_t hash,
+                                                       void *value,
+                                                       void *expect)
 {
    struct _mulle_concurrent_hashvaluepair   *entry;
+   intptr_t                                 other;
    void                                     *found;
-   unsigned int                             index;
-   unsigned int                             sentinel;
+   uintptr_t                                index;
+   uintptr_t                                sentinel;
    
-   index    = (unsigned int) hash;
-   sentinel = index + (unsigned int) p->mask + 1;
+   index    = (uintptr_t) hash;
+   sentinel = index + p->mask + 1;
    for(;;)
    {
-      entry  = &p->entries[ index & (unsigned int) p->mask];
+      entry = &p->entries[ index & p->mask];
+      other = _mulle_concurrent_atomic_hash_read( &entry->hash);
 
-      if( entry->hash == hash)
+      if( other == hash)
       {
-         found = __mulle_atomic_pointer_compare_and_swap( &entry->value, MULLE_CONCURRENT_NO_POINTER, value);
+         found = __mulle_atomic_pointer_compare_and_swap( &entry->value, value, expect);
          if( found == REDIRECT_VALUE)
             return( EBUSY);
-         return( found == value ? 0 : ENOENT);
+         return( found == expect ? 0 : ENOENT);
       }
       
-      if( entry->hash == MULLE_CONCURRENT_NO_HASH)
+      if( other == MULLE_CONCURRENT_NO_HASH)
          return( ENOENT);
       
       ++index;
       assert( index != sentinel);  // can't happen we always leave space
+      MULLE_CONCURRENT_STATS_COUNT( HASHMAP, PROBE_STEPS);
    }
 }
 
 
-static void   _mulle_concurrent_hashmapstorage_copy( struct _mulle_concurrent_hashmapstorage *dst,
-                                                     struct _mulle_concurrent_hashmapstorage *src)
+static inline int   _mulle_concurrent_hashmapstorage_remove( struct _mulle_concurrent_hashmapstorage *p,
+                                                             intptr_t hash,
+                                                             void *value)
+{
+   return( _mulle_concurrent_hashmapstorage_replace( p, hash, MULLE_CONCURRENT_NO_POINTER, value));
+}
+
+
+// returns the number of entries, that this thread copied
+static uintptr_t   _mulle_concurrent_hashmapstorage_copy( struct _mulle_concurrent_hashmapstorage *dst,
+                                                          struct _mulle_concurrent_hashmapstorage *src)
 {
    struct _mulle_concurrent_hashvaluepair   *p;
    struct _mulle_concurrent_hashvaluepair   *p_last;
    void                                     *actual;
    void                                     *value;
+   uintptr_t                                n;
    
+   n      = 0;
    p      = src->entries;
    p_last = &src->entries[ src->mask];
 
+   //
+   // empty entries and removed entries are redirected as well, otherwise
+   // an insert could still succeed in 'src' after it has been copied
+   //
    for( ;p <= p_last; p++)
    {
-      if( ! p->hash)
-         continue;
-
       value = _mulle_atomic_pointer_read( &p->value);
       for(;;)
       {
-         if( value == MULLE_CONCURRENT_NO_POINTER)
-            break;
          if( value == REDIRECT_VALUE)
             break;
          
          // it's important that we copy over first so
          // No One Gets Left Behind
-         _mulle_concurrent_hashmapstorage_put( dst, p->hash, value);
+         if( value != MULLE_CONCURRENT_NO_POINTER)
+         {
+            _mulle_concurrent_hashmapstorage_put( dst,
+                                                  _mulle_concurrent_hashvaluepair_wait_hash( p),
+                                                  value);
+            MULLE_CONCURRENT_STATS_COUNT( HASHMAP, ENTRIES_COPIED);
+            ++n;
+         }
          
          actual = __mulle_atomic_pointer_compare_and_swap( &p->value, REDIRECT_VALUE, value);
          if( actual == value)
@@ -340,6 +498,7 @@ static void   _mulle_concurrent_hashmapstorage_copy( struct _mulle_concurrent_ha
          value = actual;
       }
    }
+   return( n);
 }
 
 
@@ -347,7 +506,7 @@ static void   _mulle_concurrent_hashmapstorage_copy( struct _mulle_concurrent_ha
 #pragma mark _mulle_concurrent_hashmap
 
 int  _mulle_concurrent_hashmap_init( struct mulle_concurrent_hashmap *map,
-                                     unsigned int size,
+                                     uintptr_t size,
                                      struct mulle_allocator *allocator)
 {
    struct _mulle_concurrent_hashmapstorage   *storage;
@@ -372,6 +531,45 @@ int  _mulle_concurrent_hashmap_init( struct mulle_concurrent_hashmap *map,
 }
 
 
+//
+// the inline storage is preceeded by a NULL pointer, so the storagepool won't
+// free it, when the map migrates to a heap storage or is done
+//
+int  _mulle_concurrent_inlinehashmap_init( struct mulle_concurrent_inlinehashmap *map,
+                                           struct mulle_allocator *allocator)
+{
+   struct _mulle_concurrent_hashmapinlinestorage   *p;
+   struct _mulle_concurrent_hashmapstorage         *storage;
+   unsigned int                                    i;
+
+   if( ! allocator)
+      allocator = &mulle_default_allocator;
+
+   assert( allocator->abafree && allocator->abafree != (int (*)()) abort);
+   if( ! allocator->abafree || allocator->abafree == (int (*)()) abort)
+      return( EINVAL);
+
+   p            = &map->storage;
+   p->allocator = NULL;
+   p->mask      = MULLE_CONCURRENT_HASHMAP_INLINE_SIZE - 1;
+   _mulle_atomic_pointer_nonatomic_write( &p->n_hashs, 0);
+   for( i = 0; i < MULLE_CONCURRENT_HASHMAP_INLINE_SIZE; i++)
+   {
+      p->entries[ i].hash = MULLE_CONCURRENT_NO_HASH;
+      _mulle_atomic_pointer_nonatomic_write( &p->entries[ i].value, MULLE_CONCURRENT_NO_POINTER);
+   }
+
+   storage = (struct _mulle_concurrent_hashmapstorage *) &p->n_hashs;
+   assert( (void *) &storage->entries[ 0] == (void *) &p->entries[ 0]);
+
+   map->map.allocator = allocator;
+   _mulle_atomic_pointer_nonatomic_write( &map->map.storage.pointer, storage);
+   _mulle_atomic_pointer_nonatomic_write( &map->map.next_storage.pointer, storage);
+
+   return( 0);
+}
+
+
 //
 // this is called when you know, no other threads are accessing it anymore
 //
@@ -384,18 +582,18 @@ void  _mulle_concurrent_hashmap_done( struct mulle_concurrent_hashmap *map)
    storage      = _mulle_atomic_pointer_nonatomic_read( &map->storage.pointer);
    next_storage = _mulle_atomic_pointer_nonatomic_read( &map->next_storage.pointer);
 
-   _mulle_allocator_abafree( map->allocator, storage);
+   _mulle_concurrent_storagepool_abafree( storage);
    if( storage != next_storage)
-      _mulle_allocator_abafree( map->allocator, next_storage);
+      _mulle_concurrent_storagepool_abafree( next_storage);
 }
 
 
-unsigned int  _mulle_concurrent_hashmap_get_size( struct mulle_concurrent_hashmap *map)
+uintptr_t     _mulle_concurrent_hashmap_get_size( struct mulle_concurrent_hashmap *map)
 {
    struct _mulle_concurrent_hashmapstorage   *p;
    
    p = _mulle_atomic_pointer_read( &map->storage.pointer);
-   return( (unsigned int) p->mask + 1);
+   return( p->mask + 1);
 }
 
 
@@ -406,16 +604,23 @@ static int  _mulle_concurrent_hashmap_migrate_storage( struct mulle_concurrent_h
    struct _mulle_concurrent_hashmapstorage   *q;
    struct _mulle_concurrent_hashmapstorage   *alloced;
    struct _mulle_concurrent_hashmapstorage   *previous;
+   struct mulle_concurrent_migrationevent    event;
+   uintptr_t                                 n;
+   int                                       hooked;
 
    assert( p);
 
+   hooked = _mulle_concurrent_migrationhook_is_set();
+   if( hooked)
+      event.start = mulle_concurrent_timestamp();
+
    // check if we have a chance to succeed
    alloced = NULL;
    q       = _mulle_atomic_pointer_read( &map->next_storage.pointer);
    if( q == p)
    {
       // acquire new storage
-      alloced = _mulle_concurrent_alloc_hashmapstorage( ((unsigned int) p->mask + 1) * 2, map->allocator);
+      alloced = _mulle_concurrent_alloc_hashmapstorage( (p->mask + 1) * 2, map->allocator);
       if( ! alloced)
          return( ENOMEM);
       
@@ -424,15 +629,36 @@ static int  _mulle_concurrent_hashmap_migrate_storage( struct mulle_concurrent_h
       if( q != p)
       {
          // someone else produced a next world, use that and get rid of 'alloced'
-         _mulle_allocator_abafree( map->allocator, alloced);  // ABA!!
+         _mulle_concurrent_storagepool_abafree( alloced);  // ABA!!
          alloced = NULL;
       }
       else
          q = alloced;
    }
+
+   if( alloced)
+      MULLE_CONCURRENT_STATS_COUNT( HASHMAP, MIGRATIONS_STARTED);
+   else
+      MULLE_CONCURRENT_STATS_COUNT( HASHMAP, MIGRATIONS_JOINED);
+
+   if( hooked)
+   {
+      event.container = MULLE_CONCURRENT_STATS_HASHMAP;
+      event.object    = map;
+      event.old_size  = p->mask + 1;
+      event.new_size  = q->mask + 1;
+      event.n_copied  = 0;
+      if( alloced)
+         _mulle_concurrent_migrationhook_call( &event, MULLE_CONCURRENT_MIGRATION_STARTED);
+   }
    
    // this thread can partake in copying
-   _mulle_concurrent_hashmapstorage_copy( q, p);
+   n = _mulle_concurrent_hashmapstorage_copy( q, p);
+   if( hooked)
+   {
+      event.n_copied = n;
+      _mulle_concurrent_migrationhook_call( &event, MULLE_CONCURRENT_MIGRATION_COPIED);
+   }
    
    // now update world, giving it the same value as 'next_world'
    previous = __mulle_atomic_pointer_compare_and_swap( &map->storage.pointer, q, p);
@@ -440,7 +666,11 @@ static int  _mulle_concurrent_hashmap_migrate_storage( struct mulle_concurrent_h
    // ok, if we succeed free old, if we fail alloced is
    // already gone. this must be an ABA free 
    if( previous == p)
-      _mulle_allocator_abafree( map->allocator, previous); // ABA!!
+   {
+      if( hooked)
+         _mulle_concurrent_migrationhook_call( &event, MULLE_CONCURRENT_MIGRATION_SWAPPED);
+      _mulle_concurrent_storagepool_abafree( previous); // ABA!!
+   }
    
    return( 0);
 }
@@ -452,12 +682,16 @@ void  *_mulle_concurrent_hashmap_lookup( struct mulle_concurrent_hashmap *map,
    struct _mulle_concurrent_hashmapstorage   *p;
    void                                      *value;
    
+   MULLE_CONCURRENT_STATS_COUNT( HASHMAP, LOOKUPS);
+   MULLE_CONCURRENT_TRACE_RECORD( HASHMAP_LOOKUP, map, hash);
+
    // won't find invalid hash anyway
 retry:
-   p     = _mulle_atomic_pointer_read( &map->storage.pointer);
+   p     = _mulle_concurrent_atomic_pointer_read_acquire( &map->storage.pointer);
    value = _mulle_concurrent_hashmapstorage_lookup( p, hash);
    if( value == REDIRECT_VALUE)
    {
+      MULLE_CONCURRENT_STATS_COUNT( HASHMAP, RETRIES);
       if( _mulle_concurrent_hashmap_migrate_storage( map, p))
          return( (void *) MULLE_CONCURRENT_NO_POINTER);
       goto retry;
@@ -467,8 +701,8 @@ retry:
 
 
 static int   _mulle_concurrent_hashmap_search_next( struct mulle_concurrent_hashmap *map,
-                                                    unsigned int  *expect_mask,
-                                                    unsigned int  *index,
+                                                    uintptr_t     *expect_mask,
+                                                    uintptr_t     *index,
                                                     intptr_t *p_hash,
                                                     void **p_value)
 {
@@ -477,8 +711,8 @@ static int   _mulle_concurrent_hashmap_search_next( struct mulle_concurrent_hash
    void                                      *value;
    
 retry:
-   p = _mulle_atomic_pointer_read( &map->storage.pointer);
-   if( *expect_mask && (unsigned int) p->mask != *expect_mask)
+   p = _mulle_concurrent_atomic_pointer_read_acquire( &map->storage.pointer);
+   if( *expect_mask && p->mask != *expect_mask)
       return( ECANCELED);
    
    for(;;)
@@ -487,9 +721,10 @@ retry:
       if( ! entry)
          return( 0);
       
-      value = _mulle_atomic_pointer_read( &entry->value);
+      value = _mulle_concurrent_atomic_pointer_read_acquire( &entry->value);
       if( value == REDIRECT_VALUE)
       {
+         MULLE_CONCURRENT_STATS_COUNT( HASHMAP, RETRIES);
          if( _mulle_concurrent_hashmap_migrate_storage( map, p))
             return( ENOMEM);
          goto retry;
@@ -500,12 +735,12 @@ retry:
    }
    
    if( p_hash)
-      *p_hash = entry->hash;
+      *p_hash = _mulle_concurrent_atomic_hash_read( &entry->hash);
    if( p_value)
       *p_value = value;
    
    if( ! *expect_mask)
-      *expect_mask = (unsigned int) p->mask;
+      *expect_mask = p->mask;
    
    return( 1);
 }
@@ -524,17 +759,19 @@ int  _mulle_concurrent_hashmap_insert( struct mulle_concurrent_hashmap *map,
                                        void *value)
 {
    struct _mulle_concurrent_hashmapstorage   *p;
-   unsigned int                              n;
-   unsigned int                              max;
+   uintptr_t                                 n;
+   uintptr_t                                 max;
 
    assert_hash_value( hash, value);
+   MULLE_CONCURRENT_STATS_COUNT( HASHMAP, INSERTS);
+   MULLE_CONCURRENT_TRACE_RECORD( HASHMAP_INSERT, map, hash);
    
 retry:
    p = _mulle_atomic_pointer_read( &map->storage.pointer);
    assert( p);
 
    max = _mulle_concurrent_hashmapstorage_get_max_n_hashs( p);
-   n   = (unsigned int) (uintptr_t) _mulle_atomic_pointer_read( &p->n_hashs);
+   n   = (uintptr_t) _mulle_atomic_pointer_read( &p->n_hashs);
    
    if( n >= max)
    {
@@ -546,9 +783,11 @@ retry:
    switch( _mulle_concurrent_hashmapstorage_insert( p, hash, value))
    {
    case EEXIST :
+      MULLE_CONCURRENT_STATS_COUNT( HASHMAP, EEXISTS);
       return( EEXIST);
 
    case EBUSY  :
+      MULLE_CONCURRENT_STATS_COUNT( HASHMAP, RETRIES);
       if( _mulle_concurrent_hashmap_migrate_storage( map, p))
          return( ENOMEM);
       goto retry;
@@ -581,6 +820,7 @@ int  _mulle_concurrent_hashmap_remove( struct mulle_concurrent_hashmap *map,
    struct _mulle_concurrent_hashmapstorage   *p;
    
    assert_hash_value( hash, value);
+   MULLE_CONCURRENT_TRACE_RECORD( HASHMAP_REMOVE, map, hash);
    
 retry:
    p = _mulle_atomic_pointer_read( &map->storage.pointer);
@@ -590,6 +830,34 @@ retry:
      return( ENOENT);
          
    case EBUSY  :
+      MULLE_CONCURRENT_STATS_COUNT( HASHMAP, RETRIES);
+      if( _mulle_concurrent_hashmap_migrate_storage( map, p))
+         return( ENOMEM);
+      goto retry;
+   }
+   return( 0);
+}
+
+
+int  _mulle_concurrent_hashmap_replace( struct mulle_concurrent_hashmap *map,
+                                        intptr_t hash,
+                                        void *value,
+                                        void *expect)
+{
+   struct _mulle_concurrent_hashmapstorage   *p;
+   
+   assert_hash_value( hash, value);
+   assert_hash_value( hash, expect);
+   
+retry:
+   p = _mulle_atomic_pointer_read( &map->storage.pointer);
+   switch( _mulle_concurrent_hashmapstorage_replace( p, hash, value, expect))
+   {
+   case ENOENT :
+     return( ENOENT);
+         
+   case EBUSY  :
+      MULLE_CONCURRENT_STATS_COUNT( HASHMAP, RETRIES);
       if( _mulle_concurrent_hashmap_migrate_storage( map, p))
          return( ENOMEM);
       goto retry;
@@ -638,15 +906,183 @@ int  _mulle_concurrent_hashmapenumerator_next( struct mulle_concurrent_hashmapen
 }
 
 
+#pragma mark -
+#pragma mark analysis
+
+static void   _mulle_concurrent_hashmapstorage_analyze( struct _mulle_concurrent_hashmapstorage *p,
+                                                        unsigned char *homes,
+                                                        struct mulle_concurrent_hashmapanalysis *analysis)
+{
+   struct _mulle_concurrent_hashvaluepair   *entry;
+   intptr_t                                 hash;
+   void                                     *value;
+   uintptr_t                                size;
+   uintptr_t                                start;
+   uintptr_t                                home;
+   uintptr_t                                distance;
+   uintptr_t                                cluster;
+   uintptr_t                                i;
+   uintptr_t                                j;
+
+   size = p->mask + 1;
+
+   // start behind a free slot, so that no cluster wraps around
+   for( start = 0; start < size; start++)
+      if( _mulle_concurrent_atomic_hash_read( &p->entries[ start].hash) == MULLE_CONCURRENT_NO_HASH)
+         break;
+
+   cluster = 0;
+   for( j = 1; j <= size; j++)
+   {
+      i     = (start + j) & p->mask;
+      entry = &p->entries[ i];
+      hash  = _mulle_concurrent_atomic_hash_read( &entry->hash);
+      if( hash == MULLE_CONCURRENT_NO_HASH)
+      {
+         cluster = 0;
+         continue;
+      }
+
+      if( ++cluster > analysis->longest_cluster)
+         analysis->longest_cluster = cluster;
+
+      value = _mulle_concurrent_atomic_pointer_read_acquire( &entry->value);
+      if( value == REDIRECT_VALUE)
+      {
+         analysis->n_redirects++;
+         continue;
+      }
+      if( value == MULLE_CONCURRENT_NO_POINTER)
+      {
+         analysis->n_tombstones++;
+         continue;
+      }
+
+      analysis->n_entries++;
+
+      home     = (uintptr_t) hash & p->mask;
+      distance = (i - home) & p->mask;
+      if( distance > analysis->max_distance)
+         analysis->max_distance = distance;
+      if( distance >= MULLE_CONCURRENT_HASHMAP_ANALYSIS_N_DISTANCES)
+         distance = MULLE_CONCURRENT_HASHMAP_ANALYSIS_N_DISTANCES - 1;
+      analysis->distances[ distance]++;
+
+      if( ! (homes[ home >> 3] & (1 << (home & 7))))
+      {
+         homes[ home >> 3] |= 1 << (home & 7);
+         analysis->n_homes++;
+      }
+   }
+}
+
+
+int  _mulle_concurrent_hashmap_analyze( struct mulle_concurrent_hashmap *map,
+                                        struct mulle_concurrent_hashmapanalysis *analysis)
+{
+   struct _mulle_concurrent_hashmapstorage   *p;
+   struct _mulle_concurrent_hashmapstorage   *q;
+   unsigned char                             *homes;
+   uintptr_t                                 size;
+
+   memset( analysis, 0, sizeof( *analysis));
+
+   p    = _mulle_concurrent_atomic_pointer_read_acquire( &map->storage.pointer);
+   q    = _mulle_concurrent_atomic_pointer_read_acquire( &map->next_storage.pointer);
+   size = p->mask + 1;
+
+   // a bit per slot, to count the distinct home slots
+   homes = _mulle_allocator_calloc( map->allocator, (size + 7) / 8, 1);
+   if( ! homes)
+      return( ENOMEM);
+
+   analysis->size   = size;
+   analysis->memory = _mulle_concurrent_hashmapstorage_bytes_for_size( size);
+   if( q != p)
+   {
+      analysis->migrating = 1;
+      analysis->memory   += _mulle_concurrent_hashmapstorage_bytes_for_size( q->mask + 1);
+   }
+
+   _mulle_concurrent_hashmapstorage_analyze( p, homes, analysis);
+
+   _mulle_allocator_free( map->allocator, homes);
+   return( 0);
+}
+
+
+void   mulle_concurrent_hashmapanalysis_fprint( struct mulle_concurrent_hashmapanalysis *analysis,
+                                                FILE *fp)
+{
+   unsigned int   i;
+   unsigned int   n;
+
+   if( ! analysis || ! fp)
+      return;
+
+   fprintf( fp, "size            : %lu\n", (unsigned long) analysis->size);
+   fprintf( fp, "entries         : %lu\n", (unsigned long) analysis->n_entries);
+   fprintf( fp, "tombstones      : %lu\n", (unsigned long) analysis->n_tombstones);
+   fprintf( fp, "redirects       : %lu\n", (unsigned long) analysis->n_redirects);
+   fprintf( fp, "home slots      : %lu\n", (unsigned long) analysis->n_homes);
+   fprintf( fp, "longest cluster : %lu\n", (unsigned long) analysis->longest_cluster);
+   fprintf( fp, "max distance    : %lu\n", (unsigned long) analysis->max_distance);
+   fprintf( fp, "memory          : %lu\n", (unsigned long) analysis->memory);
+   fprintf( fp, "migrating       : %s\n", analysis->migrating ? "yes" : "no");
+
+   n = MULLE_CONCURRENT_HASHMAP_ANALYSIS_N_DISTANCES;
+   while( n > 1 && ! analysis->distances[ n - 1])
+      --n;
+
+   fprintf( fp, "distance        : entries\n");
+   for( i = 0; i < n; i++)
+      fprintf( fp, "%15u%s: %lu\n",
+                   i,
+                   i == MULLE_CONCURRENT_HASHMAP_ANALYSIS_N_DISTANCES - 1 ? "+" : " ",
+                   (unsigned long) analysis->distances[ i]);
+}
+
+
+void   mulle_concurrent_hashmapanalysis_fprint_json( struct mulle_concurrent_hashmapanalysis *analysis,
+                                                     FILE *fp)
+{
+   unsigned int   i;
+   unsigned int   n;
+
+   if( ! analysis || ! fp)
+      return;
+
+   fprintf( fp, "{ \"size\": %lu, ", (unsigned long) analysis->size);
+   fprintf( fp, "\"entries\": %lu, ", (unsigned long) analysis->n_entries);
+   fprintf( fp, "\"tombstones\": %lu, ", (unsigned long) analysis->n_tombstones);
+   fprintf( fp, "\"redirects\": %lu, ", (unsigned long) analysis->n_redirects);
+   fprintf( fp, "\"home_slots\": %lu, ", (unsigned long) analysis->n_homes);
+   fprintf( fp, "\"longest_cluster\": %lu, ", (unsigned long) analysis->longest_cluster);
+   fprintf( fp, "\"max_distance\": %lu, ", (unsigned long) analysis->max_distance);
+   fprintf( fp, "\"memory\": %lu, ", (unsigned long) analysis->memory);
+   fprintf( fp, "\"migrating\": %s, ", analysis->migrating ? "true" : "false");
+
+   // the last element collects all longer distances
+   n = MULLE_CONCURRENT_HASHMAP_ANALYSIS_N_DISTANCES;
+   while( n > 1 && ! analysis->distances[ n - 1])
+      --n;
+
+   fprintf( fp, "\"distances\": [");
+   for( i = 0; i < n; i++)
+      fprintf( fp, "%s%lu", i ? ", " : " ", (unsigned long) analysis->distances[ i]);
+   fprintf( fp, " ] }\n");
+}
+
+
 #pragma mark -
 #pragma mark enumerator based code
 
 //
 // obviously just a snapshot at some recent point in time
 //
-unsigned int  mulle_concurrent_hashmap_count( struct mulle_concurrent_hashmap *map)
+uintptr_t     mulle_concurrent_hashmap_count( struct mulle_concurrent_hashmap *map)
 {
-   unsigned int                                count;
+   uintptr_t                                   count;
    int                                         rval;
    struct mulle_concurrent_hashmapenumerator   rover;
    
@@ -680,7 +1116,10 @@ void  *mulle_concurrent_hashmap_lookup_any( struct mulle_concurrent_hashmap *map
    struct mulle_concurrent_hashmapenumerator  rover;
    void  *any;
    
-   any   = NULL;
+   // with MULLE_CONCURRENT_STORE_ZERO NULL is a value
+   any   = MULLE_CONCURRENT_NO_POINTER;
+   if( ! map)
+      return( any);
    
    rover = mulle_concurrent_hashmap_enumerate( map);
    _mulle_concurrent_hashmapenumerator_next( &rover, NULL, &any);
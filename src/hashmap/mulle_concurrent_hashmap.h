@@ -39,10 +39,22 @@
 #include <mulle_thread/mulle_thread.h>
 #include <mulle_allocator/mulle_allocator.h>
 
+#include "mulle_concurrent_types.h"
+#include "mulle_concurrent_stats.h"
+
+#include <stdio.h>
+
 
 struct _mulle_concurrent_hashmapstorage;
 
 
+struct _mulle_concurrent_hashvaluepair
+{
+   intptr_t                 hash;
+   mulle_atomic_pointer_t   value;
+};
+
+
 union mulle_concurrent_atomichashmapstorage_t
 {
    struct _mulle_concurrent_hashmapstorage  *storage;
@@ -53,13 +65,53 @@ union mulle_concurrent_atomichashmapstorage_t
 // basically does: http://preshing.com/20160222/a-resizable-concurrent-map/
 // but is wait-free
 //
+// next_storage is written, when a migration starts. With
+// MULLE_CONCURRENT_CACHELINE_LAYOUT it's kept off the line of storage,
+// which every operation reads.
+//
 struct mulle_concurrent_hashmap
 {
-   union mulle_concurrent_atomichashmapstorage_t   storage;
-   union mulle_concurrent_atomichashmapstorage_t   next_storage;
+   union mulle_concurrent_atomichashmapstorage_t   storage MULLE_CONCURRENT_CACHELINE_ALIGNED;
    struct mulle_allocator                          *allocator;
+   union mulle_concurrent_atomichashmapstorage_t   next_storage MULLE_CONCURRENT_CACHELINE_ALIGNED;
 };
 
+
+//
+// A map with a small storage inside itself, so that it needs no allocation
+// until it outgrows it. With the default size of 8, it can hold 4 entries.
+// It then migrates to a heap storage, like a normal map does when it grows.
+// Use the hashmap functions on `map`, except for init and done. An
+// inlinehashmap must not be moved or copied after init.
+//
+#ifndef MULLE_CONCURRENT_HASHMAP_INLINE_SIZE
+# define MULLE_CONCURRENT_HASHMAP_INLINE_SIZE   8   // power of 2
+#endif
+
+//
+// must be layout compatible with _mulle_concurrent_hashmapstorage, which
+// starts at n_hashs. allocator is always NULL, which marks this storage as
+// not owned by the storagepool
+//
+struct _mulle_concurrent_hashmapinlinestorage
+{
+#ifdef MULLE_CONCURRENT_CACHELINE_LAYOUT
+   char                                     _pad[ MULLE_CONCURRENT_CACHELINE_SIZE - sizeof( void *)] MULLE_CONCURRENT_CACHELINE_ALIGNED;
+#endif
+   struct mulle_allocator                   *allocator;
+   mulle_atomic_pointer_t                   n_hashs;
+   uintptr_t                                mask MULLE_CONCURRENT_CACHELINE_ALIGNED;
+   struct _mulle_concurrent_hashvaluepair   entries[ MULLE_CONCURRENT_HASHMAP_INLINE_SIZE] MULLE_CONCURRENT_CACHELINE_ALIGNED;
+};
+
+
+struct mulle_concurrent_inlinehashmap
+{
+   struct mulle_concurrent_hashmap                 map;
+   struct _mulle_concurrent_hashmapinlinestorage   storage;
+};
+
+
 #pragma mark -
 #pragma mark single-threaded
 
@@ -70,11 +122,11 @@ struct mulle_concurrent_hashmap
 //   ENOMEM : out of memory
 //
 static inline int  mulle_concurrent_hashmap_init( struct mulle_concurrent_hashmap *map,
-                                                  unsigned int size,
+                                                  uintptr_t size,
                                                   struct mulle_allocator *allocator)
 {
    int  _mulle_concurrent_hashmap_init( struct mulle_concurrent_hashmap *map,
-                                       unsigned int size,
+                                       uintptr_t size,
                                        struct mulle_allocator *allocator);
    if( ! map)
       return( EINVAL);
@@ -91,9 +143,29 @@ static inline void  mulle_concurrent_hashmap_done( struct mulle_concurrent_hashm
 }
 
 
-static inline unsigned int  mulle_concurrent_hashmap_get_size( struct mulle_concurrent_hashmap *map)
+static inline int  mulle_concurrent_inlinehashmap_init( struct mulle_concurrent_inlinehashmap *map,
+                                                        struct mulle_allocator *allocator)
+{
+   int  _mulle_concurrent_inlinehashmap_init( struct mulle_concurrent_inlinehashmap *map,
+                                             struct mulle_allocator *allocator);
+   if( ! map)
+      return( EINVAL);
+   return( _mulle_concurrent_inlinehashmap_init( map, allocator));
+}
+
+
+static inline void  mulle_concurrent_inlinehashmap_done( struct mulle_concurrent_inlinehashmap *map)
+{
+   void  _mulle_concurrent_hashmap_done( struct mulle_concurrent_hashmap *map);
+
+   if( map)
+      _mulle_concurrent_hashmap_done( &map->map);
+}
+
+
+static inline uintptr_t     mulle_concurrent_hashmap_get_size( struct mulle_concurrent_hashmap *map)
 {
-   unsigned int  _mulle_concurrent_hashmap_get_size( struct mulle_concurrent_hashmap *map);
+   uintptr_t     _mulle_concurrent_hashmap_get_size( struct mulle_concurrent_hashmap *map);
    
    if( ! map)
       return( 0);
@@ -110,15 +182,16 @@ static inline unsigned int  mulle_concurrent_hashmap_get_size( struct mulle_conc
 //   EINVAL : invalid argument
 //   ENOMEM : must be out of memory
 //
-// Do not use hash=0
-// Do not use value=0 or value=INTPTR_MIN
+// Do not use hash=MULLE_CONCURRENT_NO_HASH (0)
+// Do not use value=MULLE_CONCURRENT_NO_POINTER (0) or
+// value=MULLE_CONCURRENT_INVALID_POINTER (INTPTR_MIN)
 //
 int   mulle_concurrent_hashmap_insert( struct mulle_concurrent_hashmap *map,
                                        intptr_t hash,
                                        void *value);
 
 
-// if rval == NULL, not found
+// if rval == MULLE_CONCURRENT_NO_POINTER, not found
 
 static inline void  *mulle_concurrent_hashmap_lookup( struct mulle_concurrent_hashmap *map,
                                                      intptr_t hash)
@@ -127,7 +200,7 @@ static inline void  *mulle_concurrent_hashmap_lookup( struct mulle_concurrent_ha
                                            intptr_t hash);
 
    if( ! map)
-      return( NULL);
+      return( MULLE_CONCURRENT_NO_POINTER);
    return( _mulle_concurrent_hashmap_lookup( map, hash));
 }
 
@@ -151,8 +224,8 @@ int   mulle_concurrent_hashmap_remove( struct mulle_concurrent_hashmap *map,
 struct mulle_concurrent_hashmapenumerator
 {
    struct mulle_concurrent_hashmap   *map;
-   unsigned int                      index;
-   unsigned int                      mask;
+   uintptr_t                         index;
+   uintptr_t                         mask;
 };
 
 
@@ -166,7 +239,7 @@ static inline struct mulle_concurrent_hashmapenumerator  mulle_concurrent_hashma
    struct mulle_concurrent_hashmapenumerator   rover;
    
    rover.map   = map;
-   rover.index = map ? 0 : (unsigned int) -1;
+   rover.index = map ? 0 : (uintptr_t) -1;
    rover.mask  = 0;
    
    return( rover);
@@ -201,18 +274,97 @@ static inline void  mulle_concurrent_hashmapenumerator_done( struct mulle_concur
 #pragma mark enumerator conveniences
 
 void           *mulle_concurrent_hashmap_lookup_any( struct mulle_concurrent_hashmap *map);
-unsigned int   mulle_concurrent_hashmap_count( struct mulle_concurrent_hashmap *map);
+uintptr_t      mulle_concurrent_hashmap_count( struct mulle_concurrent_hashmap *map);
+
+
+#pragma mark -
+#pragma mark stats
+
+//
+// the counters of all hashmaps, if compiled with MULLE_CONCURRENT_STATS
+//
+// Returns:
+//   0      : OK
+//   EINVAL : invalid argument
+//   ENOSYS : compiled without MULLE_CONCURRENT_STATS, stats is zeroed
+//
+static inline int   mulle_concurrent_hashmap_get_stats( struct mulle_concurrent_stats *stats)
+{
+   if( ! stats)
+      return( EINVAL);
+   return( _mulle_concurrent_stats_get( MULLE_CONCURRENT_STATS_HASHMAP, stats));
+}
+
+
+#pragma mark -
+#pragma mark analysis
+
+//
+// The probe distance of an entry is the number of slots it sits behind its
+// home slot (hash & mask). Distances of
+// MULLE_CONCURRENT_HASHMAP_ANALYSIS_N_DISTANCES - 1 and more are collected
+// in the last bucket. A cluster is a run of slots with a hash, including
+// tombstones, which a lookup for a missing key has to walk through.
+//
+#define MULLE_CONCURRENT_HASHMAP_ANALYSIS_N_DISTANCES   32
+
+struct mulle_concurrent_hashmapanalysis
+{
+   uintptr_t   size;             // slots in the storage
+   uintptr_t   n_entries;        // live hash/value pairs
+   uintptr_t   n_tombstones;     // hash set, value removed
+   uintptr_t   n_redirects;      // slots already migrated
+   uintptr_t   n_homes;          // slots, that are home to a live entry
+   uintptr_t   longest_cluster;
+   uintptr_t   max_distance;
+   uintptr_t   distances[ MULLE_CONCURRENT_HASHMAP_ANALYSIS_N_DISTANCES];
+   size_t      memory;           // bytes of the storage(s)
+   int         migrating;
+};
+
+
+//
+// Walks the current storage. With other threads writing, this is a
+// snapshot of something that may never have existed as a whole.
+//
+// Returns:
+//   0      : OK
+//   EINVAL : invalid argument
+//   ENOMEM : out of memory
+//
+static inline int  mulle_concurrent_hashmap_analyze( struct mulle_concurrent_hashmap *map,
+                                                     struct mulle_concurrent_hashmapanalysis *analysis)
+{
+   int  _mulle_concurrent_hashmap_analyze( struct mulle_concurrent_hashmap *map,
+                                           struct mulle_concurrent_hashmapanalysis *analysis);
+
+   if( ! map || ! analysis)
+      return( EINVAL);
+   return( _mulle_concurrent_hashmap_analyze( map, analysis));
+}
+
+
+void   mulle_concurrent_hashmapanalysis_fprint( struct mulle_concurrent_hashmapanalysis *analysis,
+                                                FILE *fp);
+void   mulle_concurrent_hashmapanalysis_fprint_json( struct mulle_concurrent_hashmapanalysis *analysis,
+                                                     FILE *fp);
 
 
 #pragma mark -
 #pragma mark various functions, no parameter checks
 
 int  _mulle_concurrent_hashmap_init( struct mulle_concurrent_hashmap *map,
-                                     unsigned int size,
+                                     uintptr_t size,
                                      struct mulle_allocator *allocator);
 void  _mulle_concurrent_hashmap_done( struct mulle_concurrent_hashmap *map);
 
-unsigned int  _mulle_concurrent_hashmap_get_size( struct mulle_concurrent_hashmap *map);
+int  _mulle_concurrent_inlinehashmap_init( struct mulle_concurrent_inlinehashmap *map,
+                                           struct mulle_allocator *allocator);
+
+uintptr_t     _mulle_concurrent_hashmap_get_size( struct mulle_concurrent_hashmap *map);
+
+int  _mulle_concurrent_hashmap_analyze( struct mulle_concurrent_hashmap *map,
+                                        struct mulle_concurrent_hashmapanalysis *analysis);
 
 
 int  _mulle_concurrent_hashmap_insert( struct mulle_concurrent_hashmap *map,
@@ -226,6 +378,12 @@ int  _mulle_concurrent_hashmap_remove( struct mulle_concurrent_hashmap *map,
                                        intptr_t hash,
                                        void *value);
 
+// replaces the value of hash, if it is still expect. Returns like remove
+int  _mulle_concurrent_hashmap_replace( struct mulle_concurrent_hashmap *map,
+                                        intptr_t hash,
+                                        void *value,
+                                        void *expect);
+
 
 int  _mulle_concurrent_hashmapenumerator_next( struct mulle_concurrent_hashmapenumerator *rover,
                                                intptr_t *hash,
@@ -0,0 +1,508 @@
+//
+//  mulle_concurrent_hashset.c
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#include "mulle_concurrent_hashset.h"
+
+#include "mulle_concurrent_atomic.h"
+#include "mulle_concurrent_storagepool.h"
+#include "mulle_concurrent_types.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+struct _mulle_concurrent_hashsetstorage
+{
+   mulle_atomic_pointer_t   n_hashs;  // including removed ones
+   uintptr_t                mask MULLE_CONCURRENT_CACHELINE_ALIGNED;
+
+   mulle_atomic_pointer_t   hashs[ 1] MULLE_CONCURRENT_CACHELINE_ALIGNED;
+};
+
+
+#define NO_HASH          ((void *) MULLE_CONCURRENT_NO_HASH)
+#define REDIRECT_HASH    ((void *) MULLE_CONCURRENT_HASHSET_REDIRECT_HASH)
+#define TOMBSTONE_HASH   ((void *) MULLE_CONCURRENT_HASHSET_TOMBSTONE_HASH)
+
+
+#pragma mark -
+#pragma mark _mulle_concurrent_hashsetstorage
+
+// n must be a power of 2
+static struct _mulle_concurrent_hashsetstorage *
+   _mulle_concurrent_alloc_hashsetstorage( uintptr_t n,
+                                           struct mulle_allocator *allocator)
+{
+   struct _mulle_concurrent_hashsetstorage   *p;
+   size_t                                    size;
+
+   assert( (~(n - 1) & n) == n);
+
+   if( n < 4)
+      n = 4;
+
+   size = sizeof( mulle_atomic_pointer_t) * (n - 1) +
+          sizeof( struct _mulle_concurrent_hashsetstorage);
+
+   p = _mulle_concurrent_storagepool_calloc( size, allocator);
+   if( ! p)
+      return( NULL);
+
+   p->mask = n - 1;
+
+   if( MULLE_CONCURRENT_NO_HASH)
+   {
+      mulle_atomic_pointer_t   *q;
+      mulle_atomic_pointer_t   *sentinel;
+
+      q        = p->hashs;
+      sentinel = &p->hashs[ p->mask];
+      while( q <= sentinel)
+         _mulle_atomic_pointer_nonatomic_write( q++, NO_HASH);
+   }
+
+   return( p);
+}
+
+
+static inline uintptr_t
+   _mulle_concurrent_hashsetstorage_get_max_n_hashs( struct _mulle_concurrent_hashsetstorage *p)
+{
+   uintptr_t   size;
+
+   size = p->mask + 1;
+   return( size - (size >> 1));
+}
+
+
+//
+// Returns:
+//   1     : found
+//   0     : not found
+//   EBUSY : ran into a migrated slot
+//
+static int   _mulle_concurrent_hashsetstorage_contains( struct _mulle_concurrent_hashsetstorage *p,
+                                                       intptr_t hash)
+{
+   void        *found;
+   uintptr_t   index;
+   uintptr_t   sentinel;
+
+   index    = (uintptr_t) hash;
+   sentinel = index + p->mask + 1;
+
+   for(;;)
+   {
+      found = _mulle_concurrent_atomic_pointer_read_acquire( &p->hashs[ index & p->mask]);
+
+      if( found == (void *) hash)
+         return( 1);
+      if( found == NO_HASH)
+         return( 0);
+      if( found == REDIRECT_HASH)
+         return( EBUSY);
+
+      ++index;
+      assert( index != sentinel);  // can't happen we always leave space
+   }
+}
+
+
+//
+// insert:
+//
+//  0      : did insert
+//  EEXIST : hash already exists
+//  EBUSY  : this storage can't be written to
+//
+static int   _mulle_concurrent_hashsetstorage_insert( struct _mulle_concurrent_hashsetstorage *p,
+                                                      intptr_t hash)
+{
+   mulle_atomic_pointer_t   *entry;
+   void                     *found;
+   uintptr_t                index;
+   uintptr_t                sentinel;
+
+   index    = (uintptr_t) hash;
+   sentinel = index + p->mask + 1;
+
+   for(;;)
+   {
+      entry = &p->hashs[ index & p->mask];
+      found = _mulle_atomic_pointer_read( entry);
+
+      if( found == NO_HASH)
+      {
+         found = __mulle_atomic_pointer_compare_and_swap( entry, (void *) hash, NO_HASH);
+         if( found == NO_HASH)
+         {
+            _mulle_atomic_pointer_increment( &p->n_hashs);
+            return( 0);
+         }
+         // someone else got the slot, look at what's in it now
+      }
+
+      if( found == (void *) hash)
+         return( EEXIST);
+      if( found == REDIRECT_HASH)
+         return( EBUSY);
+
+      ++index;
+      assert( index != sentinel);  // can't happen we always leave space
+   }
+}
+
+
+static int   _mulle_concurrent_hashsetstorage_remove( struct _mulle_concurrent_hashsetstorage *p,
+                                                      intptr_t hash)
+{
+   mulle_atomic_pointer_t   *entry;
+   void                     *found;
+   uintptr_t                index;
+   uintptr_t                sentinel;
+
+   index    = (uintptr_t) hash;
+   sentinel = index + p->mask + 1;
+
+   for(;;)
+   {
+      entry = &p->hashs[ index & p->mask];
+      found = _mulle_atomic_pointer_read( entry);
+
+      if( found == (void *) hash)
+      {
+         found = __mulle_atomic_pointer_compare_and_swap( entry, TOMBSTONE_HASH, (void *) hash);
+         if( found == (void *) hash)
+            return( 0);
+         if( found == REDIRECT_HASH)
+            return( EBUSY);
+         return( ENOENT);  // someone else removed it
+      }
+
+      if( found == NO_HASH)
+         return( ENOENT);
+      if( found == REDIRECT_HASH)
+         return( EBUSY);
+
+      ++index;
+      assert( index != sentinel);  // can't happen we always leave space
+   }
+}
+
+
+//
+// every slot is replaced by a redirect, the hashs are copied over before.
+// Removed slots are not copied.
+//
+static void   _mulle_concurrent_hashsetstorage_copy( struct _mulle_concurrent_hashsetstorage *dst,
+                                                     struct _mulle_concurrent_hashsetstorage *src)
+{
+   mulle_atomic_pointer_t   *p;
+   mulle_atomic_pointer_t   *p_last;
+   void                     *actual;
+   void                     *hash;
+
+   p      = src->hashs;
+   p_last = &src->hashs[ src->mask];
+
+   for( ;p <= p_last; p++)
+   {
+      hash = _mulle_atomic_pointer_read( p);
+      for(;;)
+      {
+         if( hash == REDIRECT_HASH)
+            break;
+
+         // EEXIST is fine, another thread copied it already
+         if( hash != NO_HASH && hash != TOMBSTONE_HASH)
+            _mulle_concurrent_hashsetstorage_insert( dst, (intptr_t) hash);
+
+         actual = __mulle_atomic_pointer_compare_and_swap( p, REDIRECT_HASH, hash);
+         if( actual == hash)
+            break;
+
+         hash = actual;
+      }
+   }
+}
+
+
+#pragma mark -
+#pragma mark _mulle_concurrent_hashset
+
+int  _mulle_concurrent_hashset_init( struct mulle_concurrent_hashset *set,
+                                     uintptr_t size,
+                                     struct mulle_allocator *allocator)
+{
+   struct _mulle_concurrent_hashsetstorage   *storage;
+
+   if( ! allocator)
+      allocator = &mulle_default_allocator;
+
+   assert( allocator->abafree && allocator->abafree != (int (*)()) abort);
+   if( ! allocator->abafree || allocator->abafree == (int (*)()) abort)
+      return( EINVAL);
+
+   set->allocator = allocator;
+   storage        = _mulle_concurrent_alloc_hashsetstorage( size, allocator);
+
+   if( ! storage)
+      return( ENOMEM);
+
+   _mulle_atomic_pointer_nonatomic_write( &set->storage.pointer, storage);
+   _mulle_atomic_pointer_nonatomic_write( &set->next_storage.pointer, storage);
+
+   return( 0);
+}
+
+
+//
+// this is called when you know, no other threads are accessing it anymore
+//
+void  _mulle_concurrent_hashset_done( struct mulle_concurrent_hashset *set)
+{
+   struct _mulle_concurrent_hashsetstorage   *storage;
+   struct _mulle_concurrent_hashsetstorage   *next_storage;
+
+   storage      = _mulle_atomic_pointer_nonatomic_read( &set->storage.pointer);
+   next_storage = _mulle_atomic_pointer_nonatomic_read( &set->next_storage.pointer);
+
+   _mulle_concurrent_storagepool_abafree( storage);
+   if( storage != next_storage)
+      _mulle_concurrent_storagepool_abafree( next_storage);
+}
+
+
+uintptr_t   _mulle_concurrent_hashset_get_size( struct mulle_concurrent_hashset *set)
+{
+   struct _mulle_concurrent_hashsetstorage   *p;
+
+   p = _mulle_atomic_pointer_read( &set->storage.pointer);
+   return( p->mask + 1);
+}
+
+
+//
+// same as _mulle_concurrent_hashmap_migrate_storage
+//
+static int  _mulle_concurrent_hashset_migrate_storage( struct mulle_concurrent_hashset *set,
+                                                       struct _mulle_concurrent_hashsetstorage *p)
+{
+   struct _mulle_concurrent_hashsetstorage   *q;
+   struct _mulle_concurrent_hashsetstorage   *alloced;
+   struct _mulle_concurrent_hashsetstorage   *previous;
+
+   assert( p);
+
+   q = _mulle_atomic_pointer_read( &set->next_storage.pointer);
+   if( q == p)
+   {
+      alloced = _mulle_concurrent_alloc_hashsetstorage( (p->mask + 1) * 2, set->allocator);
+      if( ! alloced)
+         return( ENOMEM);
+
+      q = __mulle_atomic_pointer_compare_and_swap( &set->next_storage.pointer, alloced, p);
+      if( q != p)
+         _mulle_concurrent_storagepool_abafree( alloced);  // ABA!!
+      else
+         q = alloced;
+   }
+
+   _mulle_concurrent_hashsetstorage_copy( q, p);
+
+   previous = __mulle_atomic_pointer_compare_and_swap( &set->storage.pointer, q, p);
+   if( previous == p)
+      _mulle_concurrent_storagepool_abafree( previous); // ABA!!
+
+   return( 0);
+}
+
+
+int   _mulle_concurrent_hashset_contains( struct mulle_concurrent_hashset *set,
+                                          intptr_t hash)
+{
+   struct _mulle_concurrent_hashsetstorage   *p;
+   int                                       rval;
+
+retry:
+   p    = _mulle_concurrent_atomic_pointer_read_acquire( &set->storage.pointer);
+   rval = _mulle_concurrent_hashsetstorage_contains( p, hash);
+   if( rval == EBUSY)
+   {
+      if( _mulle_concurrent_hashset_migrate_storage( set, p))
+         return( 0);
+      goto retry;
+   }
+   return( rval);
+}
+
+
+int   _mulle_concurrent_hashset_insert( struct mulle_concurrent_hashset *set,
+                                        intptr_t hash)
+{
+   struct _mulle_concurrent_hashsetstorage   *p;
+   uintptr_t                                 n;
+   uintptr_t                                 max;
+
+   assert( mulle_concurrent_hashset_is_valid_hash( hash));
+
+retry:
+   p = _mulle_atomic_pointer_read( &set->storage.pointer);
+   assert( p);
+
+   max = _mulle_concurrent_hashsetstorage_get_max_n_hashs( p);
+   n   = (uintptr_t) _mulle_atomic_pointer_read( &p->n_hashs);
+
+   if( n >= max)
+   {
+      if( _mulle_concurrent_hashset_migrate_storage( set, p))
+         return( ENOMEM);
+      goto retry;
+   }
+
+   switch( _mulle_concurrent_hashsetstorage_insert( p, hash))
+   {
+   case EEXIST :
+      return( EEXIST);
+
+   case EBUSY  :
+      if( _mulle_concurrent_hashset_migrate_storage( set, p))
+         return( ENOMEM);
+      goto retry;
+   }
+
+   return( 0);
+}
+
+
+int   _mulle_concurrent_hashset_remove( struct mulle_concurrent_hashset *set,
+                                        intptr_t hash)
+{
+   struct _mulle_concurrent_hashsetstorage   *p;
+
+   assert( mulle_concurrent_hashset_is_valid_hash( hash));
+
+retry:
+   p = _mulle_atomic_pointer_read( &set->storage.pointer);
+   switch( _mulle_concurrent_hashsetstorage_remove( p, hash))
+   {
+   case ENOENT :
+      return( ENOENT);
+
+   case EBUSY  :
+      if( _mulle_concurrent_hashset_migrate_storage( set, p))
+         return( ENOMEM);
+      goto retry;
+   }
+   return( 0);
+}
+
+
+#pragma mark -
+#pragma mark not so concurrent enumerator
+
+int  _mulle_concurrent_hashsetenumerator_next( struct mulle_concurrent_hashsetenumerator *rover,
+                                               intptr_t *p_hash)
+{
+   struct _mulle_concurrent_hashsetstorage   *p;
+   void                                      *hash;
+
+retry:
+   p = _mulle_concurrent_atomic_pointer_read_acquire( &rover->set->storage.pointer);
+   if( rover->mask && p->mask != rover->mask)
+      return( ECANCELED);
+
+   for(;;)
+   {
+      if( rover->index > p->mask)
+         return( 0);
+
+      hash = _mulle_concurrent_atomic_pointer_read_acquire( &p->hashs[ rover->index]);
+      if( hash == REDIRECT_HASH)
+      {
+         if( _mulle_concurrent_hashset_migrate_storage( rover->set, p))
+            return( ENOMEM);
+         goto retry;
+      }
+
+      rover->index++;
+      if( hash != NO_HASH && hash != TOMBSTONE_HASH)
+         break;
+   }
+
+   if( p_hash)
+      *p_hash = (intptr_t) hash;
+
+   if( ! rover->mask)
+      rover->mask = p->mask;
+
+   return( 1);
+}
+
+
+#pragma mark -
+#pragma mark enumerator based code
+
+//
+// obviously just a snapshot at some recent point in time
+//
+uintptr_t   mulle_concurrent_hashset_count( struct mulle_concurrent_hashset *set)
+{
+   uintptr_t                                   count;
+   int                                         rval;
+   struct mulle_concurrent_hashsetenumerator   rover;
+
+retry:
+   count = 0;
+
+   rover = mulle_concurrent_hashset_enumerate( set);
+   for(;;)
+   {
+      rval = _mulle_concurrent_hashsetenumerator_next( &rover, NULL);
+      if( rval == 1)
+      {
+         ++count;
+         continue;
+      }
+
+      if( ! rval)
+         break;
+
+      mulle_concurrent_hashsetenumerator_done( &rover);
+      goto retry;
+   }
+
+   mulle_concurrent_hashsetenumerator_done( &rover);
+   return( count);
+}
@@ -0,0 +1,267 @@
+//
+//  mulle_concurrent_hashset.h
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#ifndef mulle_concurrent_hashset_h__
+#define mulle_concurrent_hashset_h__
+
+#include <mulle_thread/mulle_thread.h>
+#include <mulle_allocator/mulle_allocator.h>
+
+#include "mulle_concurrent_types.h"
+
+
+//
+// A set of hashes. A slot is just the hash, so a hashset needs half the
+// memory of a mulle_concurrent_hashmap. The hash doubles as the state of
+// the slot, therefore some hashes are reserved:
+//
+//   MULLE_CONCURRENT_NO_HASH                : empty
+//   MULLE_CONCURRENT_HASHSET_TOMBSTONE_HASH : removed
+//   MULLE_CONCURRENT_HASHSET_REDIRECT_HASH  : migrated
+//
+// A removed slot can't be reused, because another thread may still be
+// looking past it for the same hash. The slots of removed hashes are
+// reclaimed, when the set migrates.
+//
+#define MULLE_CONCURRENT_HASHSET_REDIRECT_HASH    INTPTR_MIN
+#define MULLE_CONCURRENT_HASHSET_TOMBSTONE_HASH   (INTPTR_MIN + 1)
+
+#if MULLE_CONCURRENT_NO_HASH == MULLE_CONCURRENT_HASHSET_REDIRECT_HASH || \
+    MULLE_CONCURRENT_NO_HASH == MULLE_CONCURRENT_HASHSET_TOMBSTONE_HASH
+# error "MULLE_CONCURRENT_NO_HASH clashes with the reserved hashes of mulle_concurrent_hashset"
+#endif
+
+
+struct _mulle_concurrent_hashsetstorage;
+
+
+union mulle_concurrent_atomichashsetstorage_t
+{
+   struct _mulle_concurrent_hashsetstorage  *storage;
+   mulle_atomic_pointer_t                   pointer;
+};
+
+
+//
+// migrates like mulle_concurrent_hashmap
+//
+struct mulle_concurrent_hashset
+{
+   union mulle_concurrent_atomichashsetstorage_t   storage MULLE_CONCURRENT_CACHELINE_ALIGNED;
+   struct mulle_allocator                          *allocator;
+   union mulle_concurrent_atomichashsetstorage_t   next_storage MULLE_CONCURRENT_CACHELINE_ALIGNED;
+};
+
+
+static inline int   mulle_concurrent_hashset_is_valid_hash( intptr_t hash)
+{
+   return( hash != MULLE_CONCURRENT_NO_HASH &&
+           hash != MULLE_CONCURRENT_HASHSET_REDIRECT_HASH &&
+           hash != MULLE_CONCURRENT_HASHSET_TOMBSTONE_HASH);
+}
+
+
+#pragma mark -
+#pragma mark single-threaded
+
+
+// Returns:
+//   0      : OK
+//   EINVAL : invalid argument
+//   ENOMEM : out of memory
+//
+static inline int  mulle_concurrent_hashset_init( struct mulle_concurrent_hashset *set,
+                                                  uintptr_t size,
+                                                  struct mulle_allocator *allocator)
+{
+   int  _mulle_concurrent_hashset_init( struct mulle_concurrent_hashset *set,
+                                        uintptr_t size,
+                                        struct mulle_allocator *allocator);
+   if( ! set)
+      return( EINVAL);
+   return( _mulle_concurrent_hashset_init( set, size, allocator));
+}
+
+
+static inline void  mulle_concurrent_hashset_done( struct mulle_concurrent_hashset *set)
+{
+   void  _mulle_concurrent_hashset_done( struct mulle_concurrent_hashset *set);
+
+   if( set)
+      _mulle_concurrent_hashset_done( set);
+}
+
+
+static inline uintptr_t   mulle_concurrent_hashset_get_size( struct mulle_concurrent_hashset *set)
+{
+   uintptr_t   _mulle_concurrent_hashset_get_size( struct mulle_concurrent_hashset *set);
+
+   if( ! set)
+      return( 0);
+   return( _mulle_concurrent_hashset_get_size( set));
+}
+
+
+#pragma mark -
+#pragma mark multi-threaded
+
+// Return value (rval):
+//   0      : OK, inserted
+//   EEXIST : detected duplicate
+//   EINVAL : invalid argument
+//   ENOMEM : must be out of memory
+//
+// Do not use hash=0, MULLE_CONCURRENT_HASHSET_REDIRECT_HASH or
+// MULLE_CONCURRENT_HASHSET_TOMBSTONE_HASH
+//
+static inline int   mulle_concurrent_hashset_insert( struct mulle_concurrent_hashset *set,
+                                                     intptr_t hash)
+{
+   int   _mulle_concurrent_hashset_insert( struct mulle_concurrent_hashset *set,
+                                           intptr_t hash);
+
+   if( ! set || ! mulle_concurrent_hashset_is_valid_hash( hash))
+      return( EINVAL);
+   return( _mulle_concurrent_hashset_insert( set, hash));
+}
+
+
+// rval == 1, hash is in the set
+// rval == 0, not found or invalid argument
+
+static inline int   mulle_concurrent_hashset_contains( struct mulle_concurrent_hashset *set,
+                                                       intptr_t hash)
+{
+   int   _mulle_concurrent_hashset_contains( struct mulle_concurrent_hashset *set,
+                                             intptr_t hash);
+
+   if( ! set || ! mulle_concurrent_hashset_is_valid_hash( hash))
+      return( 0);
+   return( _mulle_concurrent_hashset_contains( set, hash));
+}
+
+
+// if rval == 0, removed
+// rval == ENOENT, not found (hash does not exist (anymore))
+// rval == EINVAL, parameter has invalid value
+// rval == ENOMEM, must be out of memory
+
+static inline int   mulle_concurrent_hashset_remove( struct mulle_concurrent_hashset *set,
+                                                     intptr_t hash)
+{
+   int   _mulle_concurrent_hashset_remove( struct mulle_concurrent_hashset *set,
+                                           intptr_t hash);
+
+   if( ! set || ! mulle_concurrent_hashset_is_valid_hash( hash))
+      return( EINVAL);
+   return( _mulle_concurrent_hashset_remove( set, hash));
+}
+
+
+#pragma mark -
+#pragma mark limited multi-threaded
+
+struct mulle_concurrent_hashsetenumerator
+{
+   struct mulle_concurrent_hashset   *set;
+   uintptr_t                         index;
+   uintptr_t                         mask;
+};
+
+
+//
+// same rules as for mulle_concurrent_hashmapenumerator
+//
+static inline struct mulle_concurrent_hashsetenumerator  mulle_concurrent_hashset_enumerate( struct mulle_concurrent_hashset *set)
+{
+   struct mulle_concurrent_hashsetenumerator   rover;
+
+   rover.set   = set;
+   rover.index = set ? 0 : (uintptr_t) -1;
+   rover.mask  = 0;
+
+   return( rover);
+}
+
+
+//  1         : OK
+//  0         : nothing left
+// ECANCELLED : mutation alert
+// ENOMEM     : out of memory
+// EINVAL     : wrong parameter value
+
+static inline int  mulle_concurrent_hashsetenumerator_next( struct mulle_concurrent_hashsetenumerator *rover,
+                                                            intptr_t *hash)
+{
+   int  _mulle_concurrent_hashsetenumerator_next( struct mulle_concurrent_hashsetenumerator *rover,
+                                                  intptr_t *hash);
+   if( ! rover)
+      return( -EINVAL);
+   return( _mulle_concurrent_hashsetenumerator_next( rover, hash));
+}
+
+
+static inline void  mulle_concurrent_hashsetenumerator_done( struct mulle_concurrent_hashsetenumerator *rover)
+{
+}
+
+
+#pragma mark -
+#pragma mark enumerator conveniences
+
+uintptr_t   mulle_concurrent_hashset_count( struct mulle_concurrent_hashset *set);
+
+
+#pragma mark -
+#pragma mark various functions, no parameter checks
+
+int  _mulle_concurrent_hashset_init( struct mulle_concurrent_hashset *set,
+                                     uintptr_t size,
+                                     struct mulle_allocator *allocator);
+void  _mulle_concurrent_hashset_done( struct mulle_concurrent_hashset *set);
+
+uintptr_t   _mulle_concurrent_hashset_get_size( struct mulle_concurrent_hashset *set);
+
+int   _mulle_concurrent_hashset_insert( struct mulle_concurrent_hashset *set,
+                                        intptr_t hash);
+
+int   _mulle_concurrent_hashset_contains( struct mulle_concurrent_hashset *set,
+                                          intptr_t hash);
+
+int   _mulle_concurrent_hashset_remove( struct mulle_concurrent_hashset *set,
+                                        intptr_t hash);
+
+int  _mulle_concurrent_hashsetenumerator_next( struct mulle_concurrent_hashsetenumerator *rover,
+                                               intptr_t *hash);
+
+#endif /* mulle_concurrent_hashset_h */
@@ -0,0 +1,279 @@
+//
+//  mulle_concurrent_interntable.c
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#include "mulle_concurrent_interntable.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+struct _mulle_concurrent_internchunk
+{
+   struct _mulle_concurrent_internchunk   *next;
+   mulle_atomic_pointer_t                 used;
+   uintptr_t                              size;
+   char                                   bytes[ 1];  // pointer aligned
+};
+
+
+#pragma mark -
+#pragma mark keys
+
+// FNV-1a
+static intptr_t   intern_hash( struct mulle_concurrent_keymapcallback *callback,
+                               void *key)
+{
+   struct _mulle_concurrent_internkey   *p = key;
+   unsigned char                        *s;
+   unsigned char                        *sentinel;
+   uintptr_t                            hash;
+
+   hash     = sizeof( uintptr_t) == 8 ? (uintptr_t) 0xCBF29CE484222325ULL : 0x811C9DC5;
+   s        = (unsigned char *) p->bytes;
+   sentinel = &s[ p->length];
+   while( s < sentinel)
+   {
+      hash ^= *s++;
+      hash *= sizeof( uintptr_t) == 8 ? (uintptr_t) 0x100000001B3ULL : 0x01000193;
+   }
+   return( (intptr_t) hash);
+}
+
+
+static int   intern_is_equal( struct mulle_concurrent_keymapcallback *callback,
+                              void *key,
+                              void *other)
+{
+   struct _mulle_concurrent_internkey   *a = key;
+   struct _mulle_concurrent_internkey   *b = other;
+
+   return( a->length == b->length && ! memcmp( a->bytes, b->bytes, a->length));
+}
+
+
+static struct mulle_concurrent_keymapcallback   intern_callback =
+{
+   intern_hash,
+   intern_is_equal,
+   NULL
+};
+
+
+#pragma mark -
+#pragma mark chunks
+
+static struct _mulle_concurrent_internchunk  *
+   _mulle_concurrent_interntable_alloc_chunk( struct mulle_concurrent_interntable *table,
+                                              uintptr_t size)
+{
+   struct _mulle_concurrent_internchunk   *chunk;
+
+   chunk = _mulle_allocator_malloc( table->map.allocator,
+                                    offsetof( struct _mulle_concurrent_internchunk, bytes) + size);
+   if( ! chunk)
+      return( NULL);
+
+   chunk->next = NULL;
+   chunk->size = size;
+   _mulle_atomic_pointer_nonatomic_write( &chunk->used, 0);
+   return( chunk);
+}
+
+
+static void   _mulle_concurrent_internchunk_push( struct _mulle_concurrent_internchunk *chunk,
+                                                  mulle_atomic_pointer_t *list)
+{
+   struct _mulle_concurrent_internchunk   *next;
+
+   do
+   {
+      next        = _mulle_atomic_pointer_read( list);
+      chunk->next = next;
+   }
+   while( ! _mulle_atomic_pointer_compare_and_swap( list, chunk, next));
+}
+
+
+//
+// size must be a multiple of the pointer size. Many threads bump the used
+// offset of the current chunk. When it's full, the first thread that gets
+// its new chunk in front, makes it the current one.
+//
+static void   *_mulle_concurrent_interntable_alloc( struct mulle_concurrent_interntable *table,
+                                                    uintptr_t size)
+{
+   struct _mulle_concurrent_internchunk   *chunk;
+   struct _mulle_concurrent_internchunk   *alloced;
+   uintptr_t                              used;
+
+   if( size > table->chunk_size / 4)
+   {
+      chunk = _mulle_concurrent_interntable_alloc_chunk( table, size);
+      if( ! chunk)
+         return( NULL);
+      _mulle_atomic_pointer_nonatomic_write( &chunk->used, (void *) size);
+      _mulle_concurrent_internchunk_push( chunk, &table->oversized);
+      return( chunk->bytes);
+   }
+
+   for(;;)
+   {
+      chunk = _mulle_atomic_pointer_read( &table->chunks);
+      if( chunk)
+      {
+         used = (uintptr_t) _mulle_atomic_pointer_read( &chunk->used);
+         if( used + size <= chunk->size)
+         {
+            if( _mulle_atomic_pointer_compare_and_swap( &chunk->used, (void *) (used + size), (void *) used))
+               return( &chunk->bytes[ used]);
+            continue;
+         }
+      }
+
+      alloced = _mulle_concurrent_interntable_alloc_chunk( table, table->chunk_size);
+      if( ! alloced)
+         return( NULL);
+
+      alloced->next = chunk;
+      if( ! _mulle_atomic_pointer_compare_and_swap( &table->chunks, alloced, chunk))
+         _mulle_allocator_free( table->map.allocator, alloced);
+   }
+}
+
+
+static void   _mulle_concurrent_internchunks_free( mulle_atomic_pointer_t *list,
+                                                   struct mulle_allocator *allocator)
+{
+   struct _mulle_concurrent_internchunk   *chunk;
+   struct _mulle_concurrent_internchunk   *next;
+
+   for( chunk = _mulle_atomic_pointer_nonatomic_read( list); chunk; chunk = next)
+   {
+      next = chunk->next;
+      _mulle_allocator_free( allocator, chunk);
+   }
+}
+
+
+#pragma mark -
+#pragma mark _mulle_concurrent_interntable
+
+int   _mulle_concurrent_interntable_init( struct mulle_concurrent_interntable *table,
+                                          uintptr_t chunk_size,
+                                          struct mulle_allocator *allocator)
+{
+   if( ! chunk_size)
+      chunk_size = MULLE_CONCURRENT_INTERNTABLE_CHUNK_SIZE;
+   table->chunk_size = (chunk_size + sizeof( void *) - 1) & ~(sizeof( void *) - 1);
+
+   _mulle_atomic_pointer_nonatomic_write( &table->chunks, NULL);
+   _mulle_atomic_pointer_nonatomic_write( &table->oversized, NULL);
+
+   return( _mulle_concurrent_keymap_init( &table->map, 0, &intern_callback, allocator));
+}
+
+
+void  _mulle_concurrent_interntable_done( struct mulle_concurrent_interntable *table)
+{
+   _mulle_concurrent_keymap_done( &table->map);
+
+   _mulle_concurrent_internchunks_free( &table->chunks, table->map.allocator);
+   _mulle_concurrent_internchunks_free( &table->oversized, table->map.allocator);
+}
+
+
+char  *_mulle_concurrent_interntable_lookup( struct mulle_concurrent_interntable *table,
+                                             void *bytes,
+                                             size_t len)
+{
+   struct _mulle_concurrent_internkey   probe;
+   struct _mulle_concurrent_internkey   *key;
+
+   probe.length = len;
+   probe.bytes  = bytes;
+
+   key = _mulle_concurrent_keymap_lookup( &table->map, &probe);
+   return( key != MULLE_CONCURRENT_NO_POINTER ? key->bytes : NULL);
+}
+
+
+//
+// the key is the value as well. If another thread interned the same
+// string at the same time, its copy wins and ours stays unused in the chunk
+//
+char  *_mulle_concurrent_intern( struct mulle_concurrent_interntable *table,
+                                 void *bytes,
+                                 size_t len)
+{
+   struct _mulle_concurrent_internkey   *key;
+   char                                 *s;
+   uintptr_t                            size;
+
+   s = _mulle_concurrent_interntable_lookup( table, bytes, len);
+   if( s)
+      return( s);
+
+   size = sizeof( struct _mulle_concurrent_internkey) + len + 1;
+   size = (size + sizeof( void *) - 1) & ~(sizeof( void *) - 1);
+
+   key = _mulle_concurrent_interntable_alloc( table, size);
+   if( ! key)
+      return( NULL);
+
+   key->length = len;
+   key->bytes  = (char *) &key[ 1];
+   if( len)
+      memcpy( key->bytes, bytes, len);
+   key->bytes[ len] = 0;
+
+   switch( _mulle_concurrent_keymap_insert( &table->map, key, key))
+   {
+   case 0 :
+      return( key->bytes);
+
+   //
+   // the keymap makes the other entry visible, before it says EEXIST, and
+   // interned strings are never removed. NULL would mean out of memory, so
+   // don't return it, even if the lookup should miss
+   //
+   case EEXIST :
+      while( ! (s = _mulle_concurrent_interntable_lookup( table, bytes, len)))
+         mulle_thread_yield();
+      return( s);
+   }
+   return( NULL);
+}
@@ -0,0 +1,188 @@
+//
+//  mulle_concurrent_interntable.h
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#ifndef mulle_concurrent_interntable_h__
+#define mulle_concurrent_interntable_h__
+
+#include "mulle_concurrent_keymap.h"
+
+#include <string.h>
+
+
+//
+// Interns byte strings, so that equal strings get the same pointer. The
+// strings are copied into chunks of chunk_size bytes, which are only freed
+// when the table is done. Longer strings get a chunk of their own. A string
+// that is already interned costs no allocation.
+//
+// The canonical strings are NUL terminated, but may contain NUL bytes.
+//
+// The table is a mulle_concurrent_keymap of the copies, so strings with the
+// same hash don't collide. An interntable must not be moved or copied after
+// init.
+//
+#define MULLE_CONCURRENT_INTERNTABLE_CHUNK_SIZE   (64 * 1024)
+
+
+//
+// the key of the keymap, the copy of the string follows it. A lookup uses
+// a key on the stack, that points to the bytes to look for
+//
+struct _mulle_concurrent_internkey
+{
+   uintptr_t   length;
+   char        *bytes;
+};
+
+
+struct mulle_concurrent_interntable
+{
+   struct mulle_concurrent_keymap   map;
+   mulle_atomic_pointer_t           chunks;     // current chunk first
+   mulle_atomic_pointer_t           oversized;  // a chunk per long string
+   uintptr_t                        chunk_size;
+};
+
+
+#pragma mark -
+#pragma mark single-threaded
+
+// chunk_size 0 is MULLE_CONCURRENT_INTERNTABLE_CHUNK_SIZE
+//
+// Returns:
+//   0      : OK
+//   EINVAL : invalid argument
+//   ENOMEM : out of memory
+//
+static inline int  mulle_concurrent_interntable_init( struct mulle_concurrent_interntable *table,
+                                                      uintptr_t chunk_size,
+                                                      struct mulle_allocator *allocator)
+{
+   int  _mulle_concurrent_interntable_init( struct mulle_concurrent_interntable *table,
+                                            uintptr_t chunk_size,
+                                            struct mulle_allocator *allocator);
+   if( ! table)
+      return( EINVAL);
+   return( _mulle_concurrent_interntable_init( table, chunk_size, allocator));
+}
+
+
+// frees all interned strings
+static inline void  mulle_concurrent_interntable_done( struct mulle_concurrent_interntable *table)
+{
+   void  _mulle_concurrent_interntable_done( struct mulle_concurrent_interntable *table);
+
+   if( table)
+      _mulle_concurrent_interntable_done( table);
+}
+
+
+#pragma mark -
+#pragma mark multi-threaded
+
+//
+// Returns the canonical copy of the len bytes, or NULL if out of memory
+// or an argument is invalid
+//
+static inline char  *mulle_concurrent_intern( struct mulle_concurrent_interntable *table,
+                                              void *bytes,
+                                              size_t len)
+{
+   char  *_mulle_concurrent_intern( struct mulle_concurrent_interntable *table,
+                                    void *bytes,
+                                    size_t len);
+
+   if( ! table || (! bytes && len))
+      return( NULL);
+   return( _mulle_concurrent_intern( table, bytes, len));
+}
+
+
+static inline char  *mulle_concurrent_intern_cstring( struct mulle_concurrent_interntable *table,
+                                                      char *s)
+{
+   if( ! s)
+      return( NULL);
+   return( mulle_concurrent_intern( table, s, strlen( s)));
+}
+
+
+// if rval == NULL, not interned (yet)
+
+static inline char  *mulle_concurrent_interntable_lookup( struct mulle_concurrent_interntable *table,
+                                                          void *bytes,
+                                                          size_t len)
+{
+   char  *_mulle_concurrent_interntable_lookup( struct mulle_concurrent_interntable *table,
+                                                void *bytes,
+                                                size_t len);
+
+   if( ! table || (! bytes && len))
+      return( NULL);
+   return( _mulle_concurrent_interntable_lookup( table, bytes, len));
+}
+
+
+// the length of a string returned by mulle_concurrent_intern
+static inline size_t   mulle_concurrent_interntable_length_of( char *s)
+{
+   return( s ? ((struct _mulle_concurrent_internkey *) s)[ -1].length : 0);
+}
+
+
+#pragma mark -
+#pragma mark enumerator conveniences
+
+static inline uintptr_t   mulle_concurrent_interntable_count( struct mulle_concurrent_interntable *table)
+{
+   return( table ? mulle_concurrent_keymap_count( &table->map) : 0);
+}
+
+
+#pragma mark -
+#pragma mark various functions, no parameter checks
+
+int   _mulle_concurrent_interntable_init( struct mulle_concurrent_interntable *table,
+                                          uintptr_t chunk_size,
+                                          struct mulle_allocator *allocator);
+void  _mulle_concurrent_interntable_done( struct mulle_concurrent_interntable *table);
+
+char  *_mulle_concurrent_intern( struct mulle_concurrent_interntable *table,
+                                 void *bytes,
+                                 size_t len);
+
+char  *_mulle_concurrent_interntable_lookup( struct mulle_concurrent_interntable *table,
+                                             void *bytes,
+                                             size_t len);
+
+#endif /* mulle_concurrent_interntable_h */
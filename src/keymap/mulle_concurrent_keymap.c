@@ -0,0 +1,706 @@
+//
+//  mulle_concurrent_keymap.c
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#include "mulle_concurrent_keymap.h"
+
+#include "mulle_concurrent_atomic.h"
+#include "mulle_concurrent_storagepool.h"
+#include "mulle_concurrent_types.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//
+// An entry is owned by the key, that is CASed into it first. The hash is
+// written afterwards, so another thread that sees the key may have to wait
+// a little for it. The value is CASed in last, which is what makes the
+// entry visible to lookups and to the migration.
+//
+struct _mulle_concurrent_keyvaluetriple
+{
+   intptr_t                 hash;
+   mulle_atomic_pointer_t   key;
+   mulle_atomic_pointer_t   value;
+};
+
+
+struct _mulle_concurrent_keymapstorage
+{
+   mulle_atomic_pointer_t   n_keys;  // with possibly empty values
+   uintptr_t                mask MULLE_CONCURRENT_CACHELINE_ALIGNED;
+
+   struct _mulle_concurrent_keyvaluetriple  entries[ 1] MULLE_CONCURRENT_CACHELINE_ALIGNED;
+};
+
+
+#define REDIRECT_VALUE     MULLE_CONCURRENT_INVALID_POINTER
+
+
+#pragma mark -
+#pragma mark keys
+
+// FNV-1a
+static intptr_t   _mulle_concurrent_keymap_cstring_hash( char *s)
+{
+   uintptr_t   hash;
+
+   hash = sizeof( uintptr_t) == 8 ? (uintptr_t) 0xCBF29CE484222325ULL : 0x811C9DC5;
+   while( *s)
+   {
+      hash ^= (unsigned char) *s++;
+      hash *= sizeof( uintptr_t) == 8 ? (uintptr_t) 0x100000001B3ULL : 0x01000193;
+   }
+   return( (intptr_t) hash);
+}
+
+
+//
+// any hash is fine, because the keys are compared anyway. Only
+// MULLE_CONCURRENT_NO_HASH marks an entry, whose hash is not written yet
+//
+static inline intptr_t   _mulle_concurrent_keymap_hash( struct mulle_concurrent_keymap *map,
+                                                        void *key)
+{
+   intptr_t   hash;
+
+   if( ! map->callback)
+      hash = _mulle_concurrent_keymap_cstring_hash( key);
+   else
+      hash = (*map->callback->hash)( map->callback, key);
+
+   return( hash == MULLE_CONCURRENT_NO_HASH ? ~MULLE_CONCURRENT_NO_HASH : hash);
+}
+
+
+static inline int   _mulle_concurrent_keymap_is_equal( struct mulle_concurrent_keymapcallback *callback,
+                                                       void *key,
+                                                       void *other)
+{
+   if( key == other)
+      return( 1);
+   if( ! callback)
+      return( ! strcmp( key, other));
+   return( (*callback->is_equal)( callback, key, other));
+}
+
+
+#pragma mark -
+#pragma mark _mulle_concurrent_keymapstorage
+
+static size_t   _mulle_concurrent_keymapstorage_bytes_for_size( uintptr_t n)
+{
+   return( sizeof( struct _mulle_concurrent_keyvaluetriple) * (n - 1) +
+           sizeof( struct _mulle_concurrent_keymapstorage));
+}
+
+
+// n must be a power of 2
+static struct _mulle_concurrent_keymapstorage *
+   _mulle_concurrent_alloc_keymapstorage( uintptr_t n,
+                                          struct mulle_allocator *allocator)
+{
+   struct _mulle_concurrent_keymapstorage   *p;
+
+   assert( (~(n - 1) & n) == n);
+
+   if( n < 4)
+      n = 4;
+
+   p = _mulle_concurrent_storagepool_calloc( _mulle_concurrent_keymapstorage_bytes_for_size( n),
+                                             allocator);
+   if( ! p)
+      return( NULL);
+
+   p->mask = n - 1;
+
+   if( MULLE_CONCURRENT_NO_HASH || MULLE_CONCURRENT_NO_POINTER)
+   {
+      struct _mulle_concurrent_keyvaluetriple   *q;
+      struct _mulle_concurrent_keyvaluetriple   *sentinel;
+
+      q        = p->entries;
+      sentinel = &p->entries[ p->mask];
+      while( q <= sentinel)
+      {
+         q->hash  = MULLE_CONCURRENT_NO_HASH;
+         _mulle_atomic_pointer_nonatomic_write( &q->value, MULLE_CONCURRENT_NO_POINTER);
+         ++q;
+      }
+   }
+
+   return( p);
+}
+
+
+static intptr_t   _mulle_concurrent_keyvaluetriple_wait_hash( struct _mulle_concurrent_keyvaluetriple *entry)
+{
+   intptr_t   hash;
+
+   while( (hash = _mulle_concurrent_atomic_hash_read( &entry->hash)) == MULLE_CONCURRENT_NO_HASH)
+      mulle_thread_yield();
+   return( hash);
+}
+
+
+static inline uintptr_t
+   _mulle_concurrent_keymapstorage_get_max_n_keys( struct _mulle_concurrent_keymapstorage *p)
+{
+   uintptr_t   size;
+
+   size = p->mask + 1;
+   return( size - (size >> 1));
+}
+
+
+//
+// Returns the entry of key or NULL. If key is not present, but an empty
+// entry is reached, the entry is claimed for key, if claim is set.
+//
+// An entry, whose key is set but whose hash isn't yet, is being inserted.
+// Lookups and removes just skip it, the insert hasn't happened for them.
+// A claim must not pass over its own key though, so it waits for the hash.
+// Otherwise it could set the value of an entry, that lookups still skip,
+// and an insert, that returned 0 or EEXIST, wouldn't be found.
+//
+static struct _mulle_concurrent_keyvaluetriple  *
+   _mulle_concurrent_keymapstorage_find( struct _mulle_concurrent_keymapstorage *p,
+                                         intptr_t hash,
+                                         void *key,
+                                         struct mulle_concurrent_keymapcallback *callback,
+                                         int claim)
+{
+   struct _mulle_concurrent_keyvaluetriple   *entry;
+   void                                      *other;
+   intptr_t                                  other_hash;
+   uintptr_t                                 index;
+   uintptr_t                                 sentinel;
+
+   index    = (uintptr_t) hash;
+   sentinel = index + p->mask + 1;
+
+   for(;;)
+   {
+      entry = &p->entries[ index & p->mask];
+      other = _mulle_concurrent_atomic_pointer_read_acquire( &entry->key);
+
+      if( ! other)
+      {
+         if( ! claim)
+            return( NULL);
+
+         other = __mulle_atomic_pointer_compare_and_swap( &entry->key, key, NULL);
+         if( ! other)
+         {
+            _mulle_atomic_pointer_increment( &p->n_keys);
+            _mulle_concurrent_atomic_hash_write( &entry->hash, hash);
+            return( entry);
+         }
+         // someone else got the entry, possibly for the same key
+      }
+
+      // filter with the hash first
+      other_hash = _mulle_concurrent_atomic_hash_read( &entry->hash);
+      if( claim && other_hash == MULLE_CONCURRENT_NO_HASH)
+         other_hash = _mulle_concurrent_keyvaluetriple_wait_hash( entry);
+      if( other_hash == hash)
+         if( _mulle_concurrent_keymap_is_equal( callback, key, other))
+            return( entry);
+
+      ++index;
+      assert( index != sentinel);  // can't happen we always leave space
+   }
+}
+
+
+static void   *_mulle_concurrent_keymapstorage_lookup( struct _mulle_concurrent_keymapstorage *p,
+                                                       intptr_t hash,
+                                                       void *key,
+                                                       struct mulle_concurrent_keymapcallback *callback)
+{
+   struct _mulle_concurrent_keyvaluetriple   *entry;
+
+   entry = _mulle_concurrent_keymapstorage_find( p, hash, key, callback, 0);
+   if( ! entry)
+      return( MULLE_CONCURRENT_NO_POINTER);
+   return( _mulle_concurrent_atomic_pointer_read_acquire( &entry->value));
+}
+
+
+static struct _mulle_concurrent_keyvaluetriple  *
+    _mulle_concurrent_keymapstorage_next_triple( struct _mulle_concurrent_keymapstorage *p,
+                                                 uintptr_t *index)
+{
+   struct _mulle_concurrent_keyvaluetriple   *entry;
+   struct _mulle_concurrent_keyvaluetriple   *sentinel;
+
+   entry    = &p->entries[ *index];
+   sentinel = &p->entries[ p->mask + 1];
+
+   while( entry < sentinel)
+   {
+      if( ! _mulle_concurrent_atomic_pointer_read_acquire( &entry->key))
+      {
+         ++entry;
+         continue;
+      }
+
+      *index = (uintptr_t) (entry - p->entries) + 1;
+      return( entry);
+   }
+   return( NULL);
+}
+
+
+//
+// insert:
+//
+//  0      : did insert
+//  EEXIST : key already exists (can't replace currently)
+//  EBUSY  : this storage can't be written to
+//
+static int   _mulle_concurrent_keymapstorage_insert( struct _mulle_concurrent_keymapstorage *p,
+                                                     intptr_t hash,
+                                                     void *key,
+                                                     void *value,
+                                                     struct mulle_concurrent_keymapcallback *callback)
+{
+   struct _mulle_concurrent_keyvaluetriple   *entry;
+   void                                      *found;
+
+   assert( hash != MULLE_CONCURRENT_NO_HASH);
+   assert( value != MULLE_CONCURRENT_NO_POINTER && value != MULLE_CONCURRENT_INVALID_POINTER);
+
+   entry = _mulle_concurrent_keymapstorage_find( p, hash, key, callback, 1);
+   found = __mulle_atomic_pointer_compare_and_swap( &entry->value, value, MULLE_CONCURRENT_NO_POINTER);
+   if( found == MULLE_CONCURRENT_NO_POINTER)
+      return( 0);
+   if( found == REDIRECT_VALUE)
+      return( EBUSY);
+   return( EEXIST);
+}
+
+
+static int   _mulle_concurrent_keymapstorage_put( struct _mulle_concurrent_keymapstorage *p,
+                                                  intptr_t hash,
+                                                  void *key,
+                                                  void *value,
+                                                  struct mulle_concurrent_keymapcallback *callback)
+{
+   struct _mulle_concurrent_keyvaluetriple   *entry;
+   void                                      *found;
+   void                                      *expect;
+
+   assert( value != MULLE_CONCURRENT_NO_POINTER && value != MULLE_CONCURRENT_INVALID_POINTER);
+
+   entry  = _mulle_concurrent_keymapstorage_find( p, hash, key, callback, 1);
+   expect = MULLE_CONCURRENT_NO_POINTER;
+   for(;;)
+   {
+      found = __mulle_atomic_pointer_compare_and_swap( &entry->value, value, expect);
+      if( found == expect)
+         return( 0);
+      if( found == REDIRECT_VALUE)
+         return( EBUSY);
+      expect = found;
+   }
+}
+
+
+static int   _mulle_concurrent_keymapstorage_remove( struct _mulle_concurrent_keymapstorage *p,
+                                                     intptr_t hash,
+                                                     void *key,
+                                                     void *value,
+                                                     struct mulle_concurrent_keymapcallback *callback)
+{
+   struct _mulle_concurrent_keyvaluetriple   *entry;
+   void                                      *found;
+
+   entry = _mulle_concurrent_keymapstorage_find( p, hash, key, callback, 0);
+   if( ! entry)
+      return( ENOENT);
+
+   found = __mulle_atomic_pointer_compare_and_swap( &entry->value, MULLE_CONCURRENT_NO_POINTER, value);
+   if( found == REDIRECT_VALUE)
+      return( EBUSY);
+   return( found == value ? 0 : ENOENT);
+}
+
+
+//
+// removed entries are not copied, so their keys are gone from the new
+// storage
+//
+static void   _mulle_concurrent_keymapstorage_copy( struct _mulle_concurrent_keymapstorage *dst,
+                                                    struct _mulle_concurrent_keymapstorage *src,
+                                                    struct mulle_concurrent_keymapcallback *callback)
+{
+   struct _mulle_concurrent_keyvaluetriple   *p;
+   struct _mulle_concurrent_keyvaluetriple   *p_last;
+   void                                      *actual;
+   void                                      *value;
+
+   p      = src->entries;
+   p_last = &src->entries[ src->mask];
+
+   for( ;p <= p_last; p++)
+   {
+      value = _mulle_atomic_pointer_read( &p->value);
+      for(;;)
+      {
+         if( value == REDIRECT_VALUE)
+            break;
+
+         // a value is only set, after the key has been set
+         if( value != MULLE_CONCURRENT_NO_POINTER)
+            _mulle_concurrent_keymapstorage_put( dst,
+                                                 _mulle_concurrent_keyvaluetriple_wait_hash( p),
+                                                 _mulle_atomic_pointer_read( &p->key),
+                                                 value,
+                                                 callback);
+
+         actual = __mulle_atomic_pointer_compare_and_swap( &p->value, REDIRECT_VALUE, value);
+         if( actual == value)
+            break;
+
+         value = actual;
+      }
+   }
+}
+
+
+#pragma mark -
+#pragma mark _mulle_concurrent_keymap
+
+int  _mulle_concurrent_keymap_init( struct mulle_concurrent_keymap *map,
+                                    uintptr_t size,
+                                    struct mulle_concurrent_keymapcallback *callback,
+                                    struct mulle_allocator *allocator)
+{
+   struct _mulle_concurrent_keymapstorage   *storage;
+
+   if( ! allocator)
+      allocator = &mulle_default_allocator;
+
+   assert( allocator->abafree && allocator->abafree != (int (*)()) abort);
+   if( ! allocator->abafree || allocator->abafree == (int (*)()) abort)
+      return( EINVAL);
+
+   map->allocator = allocator;
+   map->callback  = callback;
+   storage        = _mulle_concurrent_alloc_keymapstorage( size, allocator);
+
+   if( ! storage)
+      return( ENOMEM);
+
+   _mulle_atomic_pointer_nonatomic_write( &map->storage.pointer, storage);
+   _mulle_atomic_pointer_nonatomic_write( &map->next_storage.pointer, storage);
+
+   return( 0);
+}
+
+
+//
+// this is called when you know, no other threads are accessing it anymore
+//
+void  _mulle_concurrent_keymap_done( struct mulle_concurrent_keymap *map)
+{
+   struct _mulle_concurrent_keymapstorage   *storage;
+   struct _mulle_concurrent_keymapstorage   *next_storage;
+
+   storage      = _mulle_atomic_pointer_nonatomic_read( &map->storage.pointer);
+   next_storage = _mulle_atomic_pointer_nonatomic_read( &map->next_storage.pointer);
+
+   _mulle_concurrent_storagepool_abafree( storage);
+   if( storage != next_storage)
+      _mulle_concurrent_storagepool_abafree( next_storage);
+}
+
+
+uintptr_t   _mulle_concurrent_keymap_get_size( struct mulle_concurrent_keymap *map)
+{
+   struct _mulle_concurrent_keymapstorage   *p;
+
+   p = _mulle_atomic_pointer_read( &map->storage.pointer);
+   return( p->mask + 1);
+}
+
+
+//
+// same as _mulle_concurrent_hashmap_migrate_storage
+//
+static int  _mulle_concurrent_keymap_migrate_storage( struct mulle_concurrent_keymap *map,
+                                                      struct _mulle_concurrent_keymapstorage *p)
+{
+   struct _mulle_concurrent_keymapstorage   *q;
+   struct _mulle_concurrent_keymapstorage   *alloced;
+   struct _mulle_concurrent_keymapstorage   *previous;
+
+   assert( p);
+
+   q = _mulle_atomic_pointer_read( &map->next_storage.pointer);
+   if( q == p)
+   {
+      alloced = _mulle_concurrent_alloc_keymapstorage( (p->mask + 1) * 2, map->allocator);
+      if( ! alloced)
+         return( ENOMEM);
+
+      q = __mulle_atomic_pointer_compare_and_swap( &map->next_storage.pointer, alloced, p);
+      if( q != p)
+         _mulle_concurrent_storagepool_abafree( alloced);  // ABA!!
+      else
+         q = alloced;
+   }
+
+   _mulle_concurrent_keymapstorage_copy( q, p, map->callback);
+
+   previous = __mulle_atomic_pointer_compare_and_swap( &map->storage.pointer, q, p);
+   if( previous == p)
+      _mulle_concurrent_storagepool_abafree( previous); // ABA!!
+
+   return( 0);
+}
+
+
+void  *_mulle_concurrent_keymap_lookup( struct mulle_concurrent_keymap *map,
+                                        void *key)
+{
+   struct _mulle_concurrent_keymapstorage   *p;
+   void                                     *value;
+   intptr_t                                 hash;
+
+   hash = _mulle_concurrent_keymap_hash( map, key);
+
+retry:
+   p     = _mulle_concurrent_atomic_pointer_read_acquire( &map->storage.pointer);
+   value = _mulle_concurrent_keymapstorage_lookup( p, hash, key, map->callback);
+   if( value == REDIRECT_VALUE)
+   {
+      if( _mulle_concurrent_keymap_migrate_storage( map, p))
+         return( (void *) MULLE_CONCURRENT_NO_POINTER);
+      goto retry;
+   }
+   return( value);
+}
+
+
+static int   _mulle_concurrent_keymap_search_next( struct mulle_concurrent_keymap *map,
+                                                   uintptr_t *expect_mask,
+                                                   uintptr_t *index,
+                                                   void **p_key,
+                                                   void **p_value)
+{
+   struct _mulle_concurrent_keymapstorage    *p;
+   struct _mulle_concurrent_keyvaluetriple   *entry;
+   void                                      *value;
+
+retry:
+   p = _mulle_concurrent_atomic_pointer_read_acquire( &map->storage.pointer);
+   if( *expect_mask && p->mask != *expect_mask)
+      return( ECANCELED);
+
+   for(;;)
+   {
+      entry = _mulle_concurrent_keymapstorage_next_triple( p, index);
+      if( ! entry)
+         return( 0);
+
+      value = _mulle_concurrent_atomic_pointer_read_acquire( &entry->value);
+      if( value == REDIRECT_VALUE)
+      {
+         if( _mulle_concurrent_keymap_migrate_storage( map, p))
+            return( ENOMEM);
+         goto retry;
+      }
+
+      if( value != MULLE_CONCURRENT_NO_POINTER)
+         break;
+   }
+
+   if( p_key)
+      *p_key = _mulle_atomic_pointer_read( &entry->key);
+   if( p_value)
+      *p_value = value;
+
+   if( ! *expect_mask)
+      *expect_mask = p->mask;
+
+   return( 1);
+}
+
+
+int  _mulle_concurrent_keymap_insert( struct mulle_concurrent_keymap *map,
+                                      void *key,
+                                      void *value)
+{
+   struct _mulle_concurrent_keymapstorage   *p;
+   intptr_t                                 hash;
+   uintptr_t                                n;
+   uintptr_t                                max;
+
+   assert( key);
+   assert( value != MULLE_CONCURRENT_NO_POINTER && value != MULLE_CONCURRENT_INVALID_POINTER);
+
+   hash = _mulle_concurrent_keymap_hash( map, key);
+
+retry:
+   p = _mulle_atomic_pointer_read( &map->storage.pointer);
+   assert( p);
+
+   max = _mulle_concurrent_keymapstorage_get_max_n_keys( p);
+   n   = (uintptr_t) _mulle_atomic_pointer_read( &p->n_keys);
+
+   if( n >= max)
+   {
+      if( _mulle_concurrent_keymap_migrate_storage( map, p))
+         return( ENOMEM);
+      goto retry;
+   }
+
+   switch( _mulle_concurrent_keymapstorage_insert( p, hash, key, value, map->callback))
+   {
+   case EEXIST :
+      return( EEXIST);
+
+   case EBUSY  :
+      if( _mulle_concurrent_keymap_migrate_storage( map, p))
+         return( ENOMEM);
+      goto retry;
+   }
+
+   return( 0);
+}
+
+
+int  mulle_concurrent_keymap_insert( struct mulle_concurrent_keymap *map,
+                                     void *key,
+                                     void *value)
+{
+   if( ! map || ! key)
+      return( EINVAL);
+   if( value == MULLE_CONCURRENT_NO_POINTER || value == MULLE_CONCURRENT_INVALID_POINTER)
+      return( EINVAL);
+
+   return( _mulle_concurrent_keymap_insert( map, key, value));
+}
+
+
+int  _mulle_concurrent_keymap_remove( struct mulle_concurrent_keymap *map,
+                                      void *key,
+                                      void *value)
+{
+   struct _mulle_concurrent_keymapstorage   *p;
+   intptr_t                                 hash;
+
+   assert( key);
+   assert( value != MULLE_CONCURRENT_NO_POINTER && value != MULLE_CONCURRENT_INVALID_POINTER);
+
+   hash = _mulle_concurrent_keymap_hash( map, key);
+
+retry:
+   p = _mulle_atomic_pointer_read( &map->storage.pointer);
+   switch( _mulle_concurrent_keymapstorage_remove( p, hash, key, value, map->callback))
+   {
+   case ENOENT :
+      return( ENOENT);
+
+   case EBUSY  :
+      if( _mulle_concurrent_keymap_migrate_storage( map, p))
+         return( ENOMEM);
+      goto retry;
+   }
+   return( 0);
+}
+
+
+int  mulle_concurrent_keymap_remove( struct mulle_concurrent_keymap *map,
+                                     void *key,
+                                     void *value)
+{
+   if( ! map || ! key)
+      return( EINVAL);
+   if( value == MULLE_CONCURRENT_NO_POINTER || value == MULLE_CONCURRENT_INVALID_POINTER)
+      return( EINVAL);
+
+   return( _mulle_concurrent_keymap_remove( map, key, value));
+}
+
+
+#pragma mark -
+#pragma mark not so concurrent enumerator
+
+int  _mulle_concurrent_keymapenumerator_next( struct mulle_concurrent_keymapenumerator *rover,
+                                              void **p_key,
+                                              void **p_value)
+{
+   return( _mulle_concurrent_keymap_search_next( rover->map, &rover->mask, &rover->index, p_key, p_value));
+}
+
+
+#pragma mark -
+#pragma mark enumerator based code
+
+//
+// obviously just a snapshot at some recent point in time
+//
+uintptr_t   mulle_concurrent_keymap_count( struct mulle_concurrent_keymap *map)
+{
+   uintptr_t                                  count;
+   int                                        rval;
+   struct mulle_concurrent_keymapenumerator   rover;
+
+retry:
+   count = 0;
+
+   rover = mulle_concurrent_keymap_enumerate( map);
+   for(;;)
+   {
+      rval = _mulle_concurrent_keymapenumerator_next( &rover, NULL, NULL);
+      if( rval == 1)
+      {
+         ++count;
+         continue;
+      }
+
+      if( ! rval)
+         break;
+
+      mulle_concurrent_keymapenumerator_done( &rover);
+      goto retry;
+   }
+
+   mulle_concurrent_keymapenumerator_done( &rover);
+   return( count);
+}
@@ -0,0 +1,259 @@
+//
+//  mulle_concurrent_keymap.h
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#ifndef mulle_concurrent_keymap_h__
+#define mulle_concurrent_keymap_h__
+
+#include <mulle_thread/mulle_thread.h>
+#include <mulle_allocator/mulle_allocator.h>
+
+#include "mulle_concurrent_types.h"
+
+
+//
+// A mulle_concurrent_keymap maps keys to values, like a
+// mulle_concurrent_hashmap maps hashes to values. The hash of a key is only
+// used to find and to filter the entries, two keys are the same if the
+// callback says they are equal. So keys with the same hash do not collide.
+//
+// The keys are not copied or retained. A key must stay valid until the map
+// is done, even after its entry has been removed, because a removed entry
+// keeps its key until the next migration and other threads may still
+// compare against it.
+//
+// With a NULL callback the keys are C strings.
+//
+struct mulle_concurrent_keymapcallback
+{
+   intptr_t   (*hash)( struct mulle_concurrent_keymapcallback *callback,
+                       void *key);
+   int        (*is_equal)( struct mulle_concurrent_keymapcallback *callback,
+                           void *key,
+                           void *other);
+   void       *userinfo;
+};
+
+
+struct _mulle_concurrent_keymapstorage;
+
+
+union mulle_concurrent_atomickeymapstorage_t
+{
+   struct _mulle_concurrent_keymapstorage  *storage;
+   mulle_atomic_pointer_t                  pointer;
+};
+
+
+//
+// migrates like mulle_concurrent_hashmap
+//
+struct mulle_concurrent_keymap
+{
+   union mulle_concurrent_atomickeymapstorage_t   storage MULLE_CONCURRENT_CACHELINE_ALIGNED;
+   struct mulle_allocator                         *allocator;
+   struct mulle_concurrent_keymapcallback         *callback;
+   union mulle_concurrent_atomickeymapstorage_t   next_storage MULLE_CONCURRENT_CACHELINE_ALIGNED;
+};
+
+
+#pragma mark -
+#pragma mark single-threaded
+
+
+// Returns:
+//   0      : OK
+//   EINVAL : invalid argument
+//   ENOMEM : out of memory
+//
+static inline int  mulle_concurrent_keymap_init( struct mulle_concurrent_keymap *map,
+                                                 uintptr_t size,
+                                                 struct mulle_concurrent_keymapcallback *callback,
+                                                 struct mulle_allocator *allocator)
+{
+   int  _mulle_concurrent_keymap_init( struct mulle_concurrent_keymap *map,
+                                       uintptr_t size,
+                                       struct mulle_concurrent_keymapcallback *callback,
+                                       struct mulle_allocator *allocator);
+   if( ! map)
+      return( EINVAL);
+   if( callback && (! callback->hash || ! callback->is_equal))
+      return( EINVAL);
+   return( _mulle_concurrent_keymap_init( map, size, callback, allocator));
+}
+
+
+static inline void  mulle_concurrent_keymap_done( struct mulle_concurrent_keymap *map)
+{
+   void  _mulle_concurrent_keymap_done( struct mulle_concurrent_keymap *map);
+
+   if( map)
+      _mulle_concurrent_keymap_done( map);
+}
+
+
+static inline uintptr_t   mulle_concurrent_keymap_get_size( struct mulle_concurrent_keymap *map)
+{
+   uintptr_t   _mulle_concurrent_keymap_get_size( struct mulle_concurrent_keymap *map);
+
+   if( ! map)
+      return( 0);
+   return( _mulle_concurrent_keymap_get_size( map));
+}
+
+
+#pragma mark -
+#pragma mark multi-threaded
+
+// Return value (rval):
+//   0      : OK, inserted
+//   EEXIST : detected duplicate
+//   EINVAL : invalid argument
+//   ENOMEM : must be out of memory
+//
+// Do not use key=NULL
+// Do not use value=0 or value=INTPTR_MIN
+//
+int   mulle_concurrent_keymap_insert( struct mulle_concurrent_keymap *map,
+                                      void *key,
+                                      void *value);
+
+
+// if rval == MULLE_CONCURRENT_NO_POINTER, not found
+
+static inline void  *mulle_concurrent_keymap_lookup( struct mulle_concurrent_keymap *map,
+                                                    void *key)
+{
+   void  *_mulle_concurrent_keymap_lookup( struct mulle_concurrent_keymap *map,
+                                           void *key);
+
+   if( ! map || ! key)
+      return( MULLE_CONCURRENT_NO_POINTER);
+   return( _mulle_concurrent_keymap_lookup( map, key));
+}
+
+
+// if rval == 0, removed
+// rval == ENOENT, not found (key/value pair does not exist (anymore))
+// rval == EINVAL, parameter has invalid value
+// rval == ENOMEM, must be out of memory
+
+int   mulle_concurrent_keymap_remove( struct mulle_concurrent_keymap *map,
+                                      void *key,
+                                      void *value);
+
+
+#pragma mark -
+#pragma mark limited multi-threaded
+
+struct mulle_concurrent_keymapenumerator
+{
+   struct mulle_concurrent_keymap   *map;
+   uintptr_t                        index;
+   uintptr_t                        mask;
+};
+
+
+//
+// same rules as for mulle_concurrent_hashmapenumerator
+//
+static inline struct mulle_concurrent_keymapenumerator  mulle_concurrent_keymap_enumerate( struct mulle_concurrent_keymap *map)
+{
+   struct mulle_concurrent_keymapenumerator   rover;
+
+   rover.map   = map;
+   rover.index = map ? 0 : (uintptr_t) -1;
+   rover.mask  = 0;
+
+   return( rover);
+}
+
+
+//  1         : OK
+//  0         : nothing left
+// ECANCELLED : mutation alert
+// ENOMEM     : out of memory
+// EINVAL     : wrong parameter value
+
+static inline int  mulle_concurrent_keymapenumerator_next( struct mulle_concurrent_keymapenumerator *rover,
+                                                           void **key,
+                                                           void **value)
+{
+   int  _mulle_concurrent_keymapenumerator_next( struct mulle_concurrent_keymapenumerator *rover,
+                                                 void **key,
+                                                 void **value);
+   if( ! rover)
+      return( -EINVAL);
+   return( _mulle_concurrent_keymapenumerator_next( rover, key, value));
+}
+
+
+static inline void  mulle_concurrent_keymapenumerator_done( struct mulle_concurrent_keymapenumerator *rover)
+{
+}
+
+
+#pragma mark -
+#pragma mark enumerator conveniences
+
+uintptr_t   mulle_concurrent_keymap_count( struct mulle_concurrent_keymap *map);
+
+
+#pragma mark -
+#pragma mark various functions, no parameter checks
+
+int  _mulle_concurrent_keymap_init( struct mulle_concurrent_keymap *map,
+                                    uintptr_t size,
+                                    struct mulle_concurrent_keymapcallback *callback,
+                                    struct mulle_allocator *allocator);
+void  _mulle_concurrent_keymap_done( struct mulle_concurrent_keymap *map);
+
+uintptr_t   _mulle_concurrent_keymap_get_size( struct mulle_concurrent_keymap *map);
+
+
+int  _mulle_concurrent_keymap_insert( struct mulle_concurrent_keymap *map,
+                                      void *key,
+                                      void *value);
+
+void  *_mulle_concurrent_keymap_lookup( struct mulle_concurrent_keymap *map,
+                                        void *key);
+
+int  _mulle_concurrent_keymap_remove( struct mulle_concurrent_keymap *map,
+                                      void *key,
+                                      void *value);
+
+
+int  _mulle_concurrent_keymapenumerator_next( struct mulle_concurrent_keymapenumerator *rover,
+                                              void **key,
+                                              void **value);
+
+#endif /* mulle_concurrent_keymap_h */
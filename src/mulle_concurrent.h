@@ -37,14 +37,23 @@
 //
 // community version is always even
 //
-#define MULLE_CONCURRENT_VERSION  ((1 << 20) | (1 << 8) | 5)
+#define MULLE_CONCURRENT_VERSION  ((2 << 20) | (0 << 8) | 0)
 
 #include <mulle_thread/mulle_thread.h>
 #include <mulle_allocator/mulle_allocator.h>
 
 #include "mulle_concurrent_types.h"
+#include "mulle_concurrent_stats.h"
 #include "mulle_concurrent_hashmap.h"
+#include "mulle_concurrent_hashset.h"
+#include "mulle_concurrent_countermap.h"
+#include "mulle_concurrent_keymap.h"
+#include "mulle_concurrent_interntable.h"
 #include "mulle_concurrent_pointerarray.h"
+#include "mulle_concurrent_storagepool.h"
+#include "mulle_concurrent_reclaim.h"
+#include "mulle_concurrent_migrationhook.h"
+#include "mulle_concurrent_trace.h"
 
 
 #if MULLE_ALLOCATOR_VERSION < ((1 << 20) | (3 << 8) | 0)
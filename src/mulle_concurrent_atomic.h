@@ -0,0 +1,91 @@
+//
+//  mulle_concurrent_atomic.h
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#ifndef mulle_concurrent_atomic_h__
+#define mulle_concurrent_atomic_h__
+
+#include <mulle_thread/mulle_thread.h>
+#include <stdint.h>
+
+
+//
+// Weaker loads for the read paths (lookup, get, enumeration). Everything
+// that writes keeps using the sequentially consistent mulle_thread atomics.
+// The contract is in dox/MEMORY_ORDERING.md.
+//
+// Define MULLE_CONCURRENT_SEQ_CST to get the old behaviour back. Compilers
+// without the __atomic builtins get it anyway.
+//
+#if defined( __ATOMIC_ACQUIRE) && ! defined( MULLE_CONCURRENT_SEQ_CST)
+
+// pairs with the CAS or write that stored the pointer
+static inline void   *_mulle_concurrent_atomic_pointer_read_acquire( mulle_atomic_pointer_t *p)
+{
+   return( __atomic_load_n( (void **) p, __ATOMIC_ACQUIRE));
+}
+
+
+// a hash is only trusted together with the value of its entry
+static inline intptr_t   _mulle_concurrent_atomic_hash_read( intptr_t *p)
+{
+   return( __atomic_load_n( p, __ATOMIC_RELAXED));
+}
+
+
+static inline void   _mulle_concurrent_atomic_hash_write( intptr_t *p, intptr_t hash)
+{
+   __atomic_store_n( p, hash, __ATOMIC_RELAXED);
+}
+
+#else
+
+static inline void   *_mulle_concurrent_atomic_pointer_read_acquire( mulle_atomic_pointer_t *p)
+{
+   return( _mulle_atomic_pointer_read( p));
+}
+
+
+static inline intptr_t   _mulle_concurrent_atomic_hash_read( intptr_t *p)
+{
+   return( *(volatile intptr_t *) p);
+}
+
+
+static inline void   _mulle_concurrent_atomic_hash_write( intptr_t *p, intptr_t hash)
+{
+   *(volatile intptr_t *) p = hash;
+}
+
+#endif
+
+#endif /* mulle_concurrent_atomic_h */
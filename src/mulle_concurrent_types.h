@@ -39,12 +39,65 @@
 #include <stdint.h>
 
 //
-// if you don't like those values, you 'should' be able to redefine those
-// this file is not exposed (yet)
+// the ABI changing options, the library was built with. Builds that don't
+// go through cmake (and have no generated header) pass them with -D
 //
-#define MULLE_CONCURRENT_NO_HASH           0
+#if defined( __has_include)
+# if __has_include( "mulle_concurrent_config.h")
+#  include "mulle_concurrent_config.h"
+# endif
+#else
+# include "mulle_concurrent_config.h"
+#endif
 
-#define MULLE_CONCURRENT_INVALID_POINTER   ((void *) INTPTR_MIN)
-#define MULLE_CONCURRENT_NO_POINTER        ((void *) 0)
+//
+// NO_HASH marks an empty slot, NO_POINTER an empty value and INVALID_POINTER
+// a migrated value. These can't be stored. With MULLE_CONCURRENT_STORE_ZERO
+// hash 0 and value 0 (NULL) become storable and INTPTR_MAX is reserved
+// instead, so small integer ids need no boxing. You can also define the
+// three yourself. NO_POINTER and INVALID_POINTER must differ and NO_HASH
+// must not be one of the reserved hashes of mulle_concurrent_hashset.
+//
+// Lookups and enumerators return NO_POINTER for "not found", so with
+// MULLE_CONCURRENT_STORE_ZERO compare with MULLE_CONCURRENT_NO_POINTER and
+// not with NULL. This changes the ABI, so the library and its users must
+// agree on it, the installed mulle_concurrent_config.h takes care of that.
+//
+#ifdef MULLE_CONCURRENT_STORE_ZERO
+# ifndef MULLE_CONCURRENT_NO_HASH
+#  define MULLE_CONCURRENT_NO_HASH          INTPTR_MAX
+# endif
+# ifndef MULLE_CONCURRENT_NO_POINTER
+#  define MULLE_CONCURRENT_NO_POINTER       ((void *) INTPTR_MAX)
+# endif
+#endif
+
+#ifndef MULLE_CONCURRENT_NO_HASH
+# define MULLE_CONCURRENT_NO_HASH           0
+#endif
+
+#ifndef MULLE_CONCURRENT_INVALID_POINTER
+# define MULLE_CONCURRENT_INVALID_POINTER   ((void *) INTPTR_MIN)
+#endif
+
+#ifndef MULLE_CONCURRENT_NO_POINTER
+# define MULLE_CONCURRENT_NO_POINTER        ((void *) 0)
+#endif
+
+
+//
+// with MULLE_CONCURRENT_CACHELINE_LAYOUT the counters that are written by
+// every add or insert get a cache line of their own, away from the fields
+// that every lookup reads. The entries start on a cache line. This changes
+// the ABI, so the library and its users must agree on it (see above).
+//
+#ifdef MULLE_CONCURRENT_CACHELINE_LAYOUT
+# ifndef MULLE_CONCURRENT_CACHELINE_SIZE
+#  define MULLE_CONCURRENT_CACHELINE_SIZE   64
+# endif
+# define MULLE_CONCURRENT_CACHELINE_ALIGNED   __attribute__(( aligned( MULLE_CONCURRENT_CACHELINE_SIZE)))
+#else
+# define MULLE_CONCURRENT_CACHELINE_ALIGNED
+#endif
 
 #endif /* mulle_concurrent_types_h */
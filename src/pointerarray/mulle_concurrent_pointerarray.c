@@ -35,48 +35,149 @@
 //
 #include "mulle_concurrent_pointerarray.h"
 
+#include "mulle_concurrent_atomic.h"
+#include "mulle_concurrent_migrationhook.h"
+#include "mulle_concurrent_hashmap.h"
+#include "mulle_concurrent_storagepool.h"
+#include "mulle_concurrent_trace.h"
 #include "mulle_concurrent_types.h"
 #include <assert.h>
 #include <errno.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+#if defined( __SANITIZE_THREAD__)
+# define MULLE_CONCURRENT_NO_VECTOR_SCAN
+#elif defined( __has_feature)
+# if __has_feature( thread_sanitizer)
+#  define MULLE_CONCURRENT_NO_VECTOR_SCAN
+# endif
+#endif
 
+#if defined( MULLE_CONCURRENT_NO_VECTOR_SCAN)
+#elif defined( __AVX2__) && UINTPTR_MAX == UINT64_MAX
+# include <immintrin.h>
+#elif defined( __SSE2__)
+# include <emmintrin.h>
+#endif
+
+
+//
+// source is the storage this one was migrated from, it's only compared.
+// stage receives the entries of source, while they are being frozen.
+// generation counts the migrations, dropped the tombstones they dropped.
+// survivors has a bit for each entry of source, that was copied, so an
+// enumerator can map its position (see below). It's placed behind the
+// entries.
+//
 struct _mulle_concurrent_pointerarraystorage
 {
-   mulle_atomic_pointer_t   n;
-   uintptr_t                size;
-
-   mulle_atomic_pointer_t   entries[ 1];
+   mulle_atomic_pointer_t                         n;
+   uintptr_t                                      size MULLE_CONCURRENT_CACHELINE_ALIGNED;
+   uintptr_t                                      generation;
+   mulle_atomic_pointer_t                         dropped;
+   struct _mulle_concurrent_pointerarraystorage   *source;
+   uintptr_t                                      source_n;
+   mulle_atomic_pointer_t                         *stage;
+   mulle_atomic_pointer_t                         *survivors;
+
+   mulle_atomic_pointer_t   entries[ 1] MULLE_CONCURRENT_CACHELINE_ALIGNED;
 };
 
 
 //
-// the nice thing about the redirect is, that another thread that is
-// trying to add at the same time cooperates
-// The negative is, that we encure extra write cycles, if there is no
-// other thread
+// survivors holds a pair of words for each SURVIVOR_BITS entries of source:
+// the number of survivors before them and their bits. A final word has the
+// total.
+//
+#define SURVIVOR_BITS                 (sizeof( uintptr_t) * 8)
+#define N_SURVIVOR_WORDS( n)          (2 * (((n) + SURVIVOR_BITS - 1) / SURVIVOR_BITS) + 1)
+
+
+//
+// A removed entry is overwritten with a tombstone. Tombstones are dropped,
+// when the storage is migrated. As a storage is only migrated when it is
+// full, no one can add to it anymore. Each entry is then frozen by
+// replacing it with REDIRECT_VALUE, after its value has been put on the
+// stage. A remover, that finds a redirect, retries in the new storage.
+// An entry only ever goes from value to tombstone to redirect, so the
+// stage is final, once all entries are frozen. All threads copying the
+// storage then see the same values and compute the same compacted
+// positions.
 //
-#define REDIRECT_VALUE   MULLE_CONCURRENT_INVALID_POINTER
+#define TOMBSTONE_VALUE   MULLE_CONCURRENT_INVALID_POINTER
+#define REDIRECT_VALUE    MULLE_CONCURRENT_POINTERARRAY_REDIRECT_POINTER
+
+
+//
+// The side index maps a value to its index + 1 (as index 0 would be
+// NO_POINTER). The hashmap uses the hash as the key, so we need something
+// that is unique for each value. The mixing is bijective (the murmur3
+// finalizer), so there are no collisions, 0 stays 0 and aligned pointers
+// get spread over the table. The one value that mixes to NO_HASH (with
+// MULLE_CONCURRENT_STORE_ZERO it isn't NO_POINTER) shares ~NO_HASH with
+// another value. That's OK, as a lookup checks the index it gets.
+//
+static inline intptr_t   _mulle_concurrent_pointerarray_hash_value( void *value)
+{
+   uintptr_t   h;
+
+   h = (uintptr_t) value;
+#if UINTPTR_MAX == UINT64_MAX
+   h ^= h >> 33;
+   h *= 0xff51afd7ed558ccdULL;
+   h ^= h >> 33;
+   h *= 0xc4ceb9fe1a85ec53ULL;
+   h ^= h >> 33;
+#else
+   h ^= h >> 16;
+   h *= 0x85ebca6bU;
+   h ^= h >> 13;
+   h *= 0xc2b2ae35U;
+   h ^= h >> 16;
+#endif
+   if( (intptr_t) h == MULLE_CONCURRENT_NO_HASH)
+      return( ~MULLE_CONCURRENT_NO_HASH);
+   return( (intptr_t) h);
+}
 
 
 #pragma mark -
 #pragma mark _mulle_concurrent_pointerarraystorage
 
 
-// n must be a power of 2
+//
+// n must be a power of 2. If source is given, the storage gets a stage
+// for the entries of source. The stage is freed, when the storage has
+// replaced source.
+//
 static struct _mulle_concurrent_pointerarraystorage *
-   _mulle_concurrent_alloc_pointerarraystorage( unsigned int n,
+   _mulle_concurrent_alloc_pointerarraystorage( uintptr_t n,
+                                                struct _mulle_concurrent_pointerarraystorage *source,
                                                 struct mulle_allocator *allocator)
 {
    struct _mulle_concurrent_pointerarraystorage  *p;
+   uintptr_t                                     extra;
 
    if( n < 8)
       n = 8;
 
-   p = _mulle_allocator_calloc( allocator, 1, sizeof( void *) * (n - 1) +
-                                sizeof( struct _mulle_concurrent_pointerarraystorage));
-   p->size = n;
+   extra = source ? N_SURVIVOR_WORDS( source->size) : 0;
+   p     = _mulle_concurrent_storagepool_calloc( sizeof( void *) * (n - 1 + extra) +
+                                                 sizeof( struct _mulle_concurrent_pointerarraystorage),
+                                                 allocator);
+   p->size       = n;
+   p->generation = 1;
+
+   if( source)
+   {
+      p->generation = source->generation + 1;
+      p->source     = source;
+      p->source_n   = source->size;
+      p->survivors  = &p->entries[ n];
+      p->stage      = _mulle_concurrent_storagepool_calloc( sizeof( void *) * p->source_n,
+                                                            allocator);
+   }
 
    /*
     * in theory, one should be able to use different values for NO_POINTER and
@@ -88,7 +189,7 @@ static struct _mulle_concurrent_pointerarraystorage *
       mulle_atomic_pointer_t   *sentinel;
 
       q        = p->entries;
-      sentinel = &p->entries[ (unsigned int) p->size];
+      sentinel = &p->entries[ p->size];
       while( q < sentinel)
       {
          _mulle_atomic_pointer_nonatomic_write( q, MULLE_CONCURRENT_NO_POINTER);
@@ -100,69 +201,460 @@ static struct _mulle_concurrent_pointerarraystorage *
 }
 
 
+//
+// returns NO_POINTER if i is out of range, a storage can shrink in count
+// when it is compacted
+//
+//
+// checks against size and not n, so readers don't touch the cache line of
+// the counter, that every add writes to. Entries past n are empty, unless
+// an add is just about to increment n
+//
 static void   *_mulle_concurrent_pointerarraystorage_get( struct _mulle_concurrent_pointerarraystorage *p,
-                                                    unsigned int i)
+                                                    uintptr_t i)
 {
-   assert( i < (unsigned int) (uintptr_t) _mulle_atomic_pointer_read( &p->n));
-   return( _mulle_atomic_pointer_read( &p->entries[ i]));
+   if( i >= p->size)
+      return( MULLE_CONCURRENT_NO_POINTER);
+   return( _mulle_concurrent_atomic_pointer_read_acquire( &p->entries[ i]));
 }
 
 
 //
 // insert:
 //
-//  0      : did insert
-//  EBUSY  : this storage can't be written to
+//  0      : did insert, *index is set
 //  ENOSPC : storage is full
 //
 static int   _mulle_concurrent_pointerarraystorage_add( struct _mulle_concurrent_pointerarraystorage *p,
-                                                  void *value)
+                                                        void *value,
+                                                        uintptr_t *index)
 {
-   void           *found;
-   unsigned int   i;
+   void        *found;
+   uintptr_t   i;
 
    assert( p);
    assert( value != MULLE_CONCURRENT_NO_POINTER);
-   assert( value != MULLE_CONCURRENT_INVALID_POINTER);
+   assert( value != TOMBSTONE_VALUE);
+   assert( value != REDIRECT_VALUE);
 
    for(;;)
    {
-      i = (unsigned int) (uintptr_t) _mulle_atomic_pointer_read( &p->n);
-      if( i >= (unsigned int) p->size)
+      i = (uintptr_t) _mulle_atomic_pointer_read( &p->n);
+      if( i >= p->size)
          return( ENOSPC);
 
       found = __mulle_atomic_pointer_compare_and_swap( &p->entries[ i], value, MULLE_CONCURRENT_NO_POINTER);
       if( found == MULLE_CONCURRENT_NO_POINTER)
       {
          _mulle_atomic_pointer_increment( &p->n);
+         *index = i;
          return( 0);
       }
+   }
+}
+
+
+//
+// returns the index of the first entry in [i,n[ that is 'search', n if there
+// is none.
+//
+// The vector loads race with the CAS writes of add and remove. That's
+// deliberate: they are only a filter, which may see an entry before or
+// after a concurrent write. A hit is always confirmed with an atomic load
+// of the entry, which is what the caller then acts upon. A write that the
+// filter misses, happened concurrently with the scan, so it could have
+// been ordered after it anyway. ThreadSanitizer can't know that, so with
+// it the filter is compiled out.
+//
+static uintptr_t      _mulle_concurrent_pointerarraystorage_scan( struct _mulle_concurrent_pointerarraystorage *p,
+                                                                  uintptr_t i,
+                                                                  uintptr_t n,
+                                                                  void *search)
+{
+   uintptr_t   j;
+
+#if defined( MULLE_CONCURRENT_NO_VECTOR_SCAN)
+#elif defined( __AVX2__) && UINTPTR_MAX == UINT64_MAX
+   {
+      void      **entries;
+      __m256i   v_search;
+      __m256i   a;
+      __m256i   b;
+      __m256i   hit;
+
+      entries  = (void **) p->entries;
+      v_search = _mm256_set1_epi64x( (long long) (intptr_t) search);
+
+      // 64 bytes (8 pointers) per iteration
+      for( ; i + 8 <= n; i += 8)
+      {
+         a   = _mm256_loadu_si256( (__m256i *) &entries[ i]);
+         b   = _mm256_loadu_si256( (__m256i *) &entries[ i + 4]);
+         hit = _mm256_or_si256( _mm256_cmpeq_epi64( a, v_search),
+                                _mm256_cmpeq_epi64( b, v_search));
+         if( _mm256_testz_si256( hit, hit))
+            continue;
+
+         for( j = i; j < i + 8; j++)
+            if( _mulle_atomic_pointer_read( &p->entries[ j]) == search)
+               return( j);
+      }
+   }
+#elif defined( __SSE2__)
+   {
+      void      **entries;
+      __m128i   v_search;
+      __m128i   a;
+      __m128i   b;
+      __m128i   hit;
+
+      entries = (void **) p->entries;
+
+      //
+      // SSE2 has no 64 bit compare, so we compare 32 bit lanes. This can
+      // produce false positives (half a pointer matching), which the
+      // scalar check weeds out
+      //
+# if UINTPTR_MAX == UINT64_MAX
+      v_search = _mm_set1_epi64x( (long long) (intptr_t) search);
+# else
+      v_search = _mm_set1_epi32( (int) (intptr_t) search);
+# endif
+
+# define N_STRIDE_ENTRIES   (32 / sizeof( void *))
+
+      // 32 bytes per iteration
+      for( ; i + N_STRIDE_ENTRIES <= n; i += N_STRIDE_ENTRIES)
+      {
+         a   = _mm_loadu_si128( (__m128i *) &entries[ i]);
+         b   = _mm_loadu_si128( (__m128i *) &entries[ i + N_STRIDE_ENTRIES / 2]);
+         hit = _mm_or_si128( _mm_cmpeq_epi32( a, v_search),
+                             _mm_cmpeq_epi32( b, v_search));
+         if( ! _mm_movemask_epi8( hit))
+            continue;
+
+         for( j = i; j < i + N_STRIDE_ENTRIES; j++)
+            if( _mulle_atomic_pointer_read( &p->entries[ j]) == search)
+               return( j);
+      }
+
+# undef N_STRIDE_ENTRIES
+   }
+#endif
+
+   for( j = i; j < n; j++)
+      if( _mulle_atomic_pointer_read( &p->entries[ j]) == search)
+         break;
+   return( j);
+}
+
+
+static uintptr_t      _mulle_concurrent_pointerarraystorage_find( struct _mulle_concurrent_pointerarraystorage *p,
+                                                                  void *search)
+{
+   uintptr_t   i;
+   uintptr_t   n;
+
+   assert( search != MULLE_CONCURRENT_NO_POINTER);
+   assert( search != TOMBSTONE_VALUE);
+
+   n = (uintptr_t) _mulle_atomic_pointer_read( &p->n);
+   i = _mulle_concurrent_pointerarraystorage_scan( p, 0, n, search);
+   MULLE_CONCURRENT_STATS_ADD( POINTERARRAY, PROBE_STEPS, i);
+   return( i == n ? MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND : i);
+}
+
 
+static unsigned int   _mulle_concurrent_pointerarray_popcount( uintptr_t bits)
+{
+   unsigned int   n;
+
+   for( n = 0; bits; n++)
+      bits &= bits - 1;
+   return( n);
+}
+
+
+//
+// 'p' must have been migrated from a storage, returns the index in 'p' of
+// the first survivor at or after index 'i' of that storage. Which is also
+// the number of survivors before 'i'.
+//
+static uintptr_t   _mulle_concurrent_pointerarraystorage_map_index( struct _mulle_concurrent_pointerarraystorage *p,
+                                                                    uintptr_t i)
+{
+   uintptr_t   before;
+   uintptr_t   bits;
+
+   if( i >= p->source_n)
+      return( (uintptr_t) _mulle_atomic_pointer_read( &p->survivors[ N_SURVIVOR_WORDS( p->source_n) - 1]));
+
+   before = (uintptr_t) _mulle_atomic_pointer_read( &p->survivors[ 2 * (i / SURVIVOR_BITS)]);
+   bits   = (uintptr_t) _mulle_atomic_pointer_read( &p->survivors[ 2 * (i / SURVIVOR_BITS) + 1]);
+   bits  &= ((uintptr_t) 1 << (i % SURVIVOR_BITS)) - 1;
+   return( before + _mulle_concurrent_pointerarray_popcount( bits));
+}
+
+
+//
+// Entries only ever move to a lower index, when a storage is compacted.
+// Find 'last' (a value returned by an enumerator) in [lower, upper[.
+//
+static uintptr_t      _mulle_concurrent_pointerarraystorage_relocate( struct _mulle_concurrent_pointerarraystorage *p,
+                                                                      uintptr_t lower,
+                                                                      uintptr_t upper,
+                                                                      void *last)
+{
+   if( last == MULLE_CONCURRENT_NO_POINTER)
+      return( MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
+
+   if( upper > p->size)
+      upper = p->size;
+   while( upper > lower)
+      if( _mulle_atomic_pointer_read( &p->entries[ --upper]) == last)
+         return( upper);
+   return( MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
+}
+
+
+//
+// remove:
+//
+//  0      : did remove, *index is set
+//  ENOENT : not found
+//  EBUSY  : the entry has been frozen, retry in the new storage
+//
+static int   _mulle_concurrent_pointerarraystorage_remove( struct _mulle_concurrent_pointerarraystorage *p,
+                                                           void *value,
+                                                           uintptr_t *index)
+{
+   void        *found;
+   uintptr_t   i;
+   uintptr_t   n;
+
+   assert( value != MULLE_CONCURRENT_NO_POINTER);
+   assert( value != TOMBSTONE_VALUE);
+   assert( value != REDIRECT_VALUE);
+
+   n = (uintptr_t) _mulle_atomic_pointer_read( &p->n);
+   for( i = 0; (i = _mulle_concurrent_pointerarraystorage_scan( p, i, n, value)) < n; i++)
+   {
+      found = __mulle_atomic_pointer_compare_and_swap( &p->entries[ i], TOMBSTONE_VALUE, value);
+      if( found == value)
+      {
+         *index = i;
+         return( 0);
+      }
       if( found == REDIRECT_VALUE)
          return( EBUSY);
+      // someone else removed it, look for a duplicate
+   }
+   return( ENOENT);
+}
+
+
+//
+// Puts each entry of 'src' on the stage of 'dst' and then replaces it with
+// a redirect. No thread waits for another here: whoever is first freezes an
+// entry. If a remover is faster, the entry is staged again as a tombstone.
+// The stage entry can't be overwritten with an older value, as the stage
+// is read before the entry and an entry only goes from value to tombstone
+// to redirect.
+//
+static void   _mulle_concurrent_pointerarraystorage_freeze( struct _mulle_concurrent_pointerarraystorage *dst,
+                                                            struct _mulle_concurrent_pointerarraystorage *src)
+{
+   void        *staged;
+   void        *value;
+   uintptr_t   i;
+
+   for( i = 0; i < dst->source_n; i++)
+      for(;;)
+      {
+         staged = _mulle_atomic_pointer_read( &dst->stage[ i]);
+         value  = _mulle_atomic_pointer_read( &src->entries[ i]);
+         if( value == REDIRECT_VALUE)
+            break;
+
+         if( staged != value)
+            if( ! _mulle_atomic_pointer_compare_and_swap( &dst->stage[ i], value, staged))
+               continue;
+
+         if( _mulle_atomic_pointer_compare_and_swap( &src->entries[ i], REDIRECT_VALUE, value))
+            break;
+      }
+}
+
+
+static uintptr_t      _mulle_concurrent_pointerarraystorage_count_live( struct _mulle_concurrent_pointerarraystorage *p)
+{
+   uintptr_t   i;
+   uintptr_t   n;
+   uintptr_t   live;
+
+   n    = (uintptr_t) _mulle_atomic_pointer_read( &p->n);
+   live = 0;
+   for( i = 0; i < n; i++)
+      if( _mulle_atomic_pointer_read( &p->entries[ i]) != TOMBSTONE_VALUE)
+         ++live;
+   return( live);
+}
+
+
+//
+// The entries of 'src' must be frozen, so the stage doesn't change anymore.
+// Copying threads agree on the positions, so whoever is first writes an
+// entry, the others CAS harmlessly. After 'dst' has been published, an
+// entry in 'dst' may already have been removed, the CAS then also fails.
+// The survivors and dropped are written by every thread, but they all
+// write the same values. The first thread to finish sets the count.
+//
+// If there is a side index, the entries of moved values are updated. Only
+// the first thread succeeds with that, for the others the expected index
+// is gone. A value whose add hasn't indexed it yet, gets a stale entry,
+// which a lookup fixes.
+//
+// returns the number of entries copied
+static uintptr_t   _mulle_concurrent_pointerarraystorage_copy( struct _mulle_concurrent_pointerarraystorage *dst,
+                                                               struct _mulle_concurrent_pointerarraystorage *src,
+                                                               struct mulle_concurrent_hashmap *index)
+{
+   void        *value;
+   uintptr_t   i;
+   uintptr_t   j;
+   uintptr_t   k;
+   uintptr_t   bits;
+   uintptr_t   dropped;
+
+   bits = 0;
+   for( i = 0, j = 0; i < dst->source_n; i++)
+   {
+      k = i % SURVIVOR_BITS;
+      if( ! k)
+         _mulle_atomic_pointer_write( &dst->survivors[ 2 * (i / SURVIVOR_BITS)], (void *) j);
+
+      value = _mulle_atomic_pointer_read( &dst->stage[ i]);
+      if( value != TOMBSTONE_VALUE)
+      {
+         _mulle_atomic_pointer_compare_and_swap( &dst->entries[ j], value, MULLE_CONCURRENT_NO_POINTER);
+         if( index && j != i)
+            _mulle_concurrent_hashmap_replace( index,
+                                               _mulle_concurrent_pointerarray_hash_value( value),
+                                               (void *) (uintptr_t) (j + 1),
+                                               (void *) (uintptr_t) (i + 1));
+         bits |= (uintptr_t) 1 << k;
+         ++j;
+      }
+
+      if( k == SURVIVOR_BITS - 1 || i == dst->source_n - 1)
+      {
+         _mulle_atomic_pointer_write( &dst->survivors[ 2 * (i / SURVIVOR_BITS) + 1], (void *) bits);
+         bits = 0;
+      }
    }
+   _mulle_atomic_pointer_write( &dst->survivors[ N_SURVIVOR_WORDS( dst->source_n) - 1], (void *) j);
+
+   dropped = (uintptr_t) _mulle_atomic_pointer_read( &src->dropped) + dst->source_n - j;
+   _mulle_atomic_pointer_write( &dst->dropped, (void *) dropped);
+
+   MULLE_CONCURRENT_STATS_ADD( POINTERARRAY, ENTRIES_COPIED, j);
+
+   _mulle_atomic_pointer_compare_and_swap( &dst->n, (void *) (uintptr_t) j, (void *) 0);
+   return( j);
 }
 
 
-static void   _mulle_concurrent_pointerarraystorage_copy( struct _mulle_concurrent_pointerarraystorage *dst,
-                                                    struct _mulle_concurrent_pointerarraystorage *src)
+#pragma mark -
+#pragma mark side index
+
+static void   _mulle_concurrent_pointerarray_index_value( struct mulle_concurrent_pointerarray *array,
+                                                          void *value,
+                                                          uintptr_t i)
 {
-   mulle_atomic_pointer_t   *p;
-   mulle_atomic_pointer_t   *p_last;
-   void                     *value;
-   unsigned int             i;
-   unsigned int             n;
+   //
+   // EEXIST is fine, the index keeps the first occurence it saw (the
+   // array is allowed to have duplicates)
+   //
+   _mulle_concurrent_hashmap_insert( array->index,
+                                     _mulle_concurrent_pointerarray_hash_value( value),
+                                     (void *) (uintptr_t) (i + 1));
+}
 
-   n      = (unsigned int) (uintptr_t) _mulle_atomic_pointer_read( &dst->n);
-   p      = &src->entries[ n];
-   p_last = &src->entries[ src->size];
 
-   for( i = n; p < p_last; p++, i++)
+static void  _mulle_concurrent_pointerarray_migrate_storage( struct mulle_concurrent_pointerarray *array,
+                                                             struct _mulle_concurrent_pointerarraystorage *p);
+
+//
+// during a migration, the value may have been frozen before the scan got
+// to it, so then help migrating and look again
+//
+static uintptr_t      _mulle_concurrent_pointerarray_scan_index( struct mulle_concurrent_pointerarray *array,
+                                                                 void *value)
+{
+   struct _mulle_concurrent_pointerarraystorage   *p;
+   uintptr_t                                      i;
+
+retry:
+   p = _mulle_atomic_pointer_read( &array->storage.pointer);
+   i = _mulle_concurrent_pointerarraystorage_find( p, value);
+   if( i == MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND &&
+       _mulle_atomic_pointer_read( &array->next_storage.pointer) != p)
    {
-      value = _mulle_atomic_pointer_read( p);
-      if( _mulle_atomic_pointer_compare_and_swap( &dst->entries[ i], value, MULLE_CONCURRENT_NO_POINTER))
-         _mulle_atomic_pointer_increment( &dst->n);
+      _mulle_concurrent_pointerarray_migrate_storage( array, p);
+      goto retry;
    }
+   return( i);
+}
+
+
+//
+// A migration moves the index entries along with the values, but the index
+// can still be stale, if the value was added or removed while the array
+// was being compacted. Then we fall back to a scan and fix the entry. If
+// the remove fails, someone else is fixing it or removed the value.
+//
+static uintptr_t      _mulle_concurrent_pointerarray_lookup_index( struct mulle_concurrent_pointerarray *array,
+                                                                   void *value)
+{
+   intptr_t    hash;
+   void        *found;
+   uintptr_t   i;
+
+   hash  = _mulle_concurrent_pointerarray_hash_value( value);
+   found = _mulle_concurrent_hashmap_lookup( array->index, hash);
+   if( found == MULLE_CONCURRENT_NO_POINTER)
+      return( MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
+
+   i = (uintptr_t) found - 1;
+   if( _mulle_concurrent_pointerarray_get( array, i) == value)
+      return( i);
+
+   i = _mulle_concurrent_pointerarray_scan_index( array, value);
+   if( ! _mulle_concurrent_hashmap_remove( array->index, hash, found))
+      if( i != MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND)
+         _mulle_concurrent_pointerarray_index_value( array, value, i);
+   return( i);
+}
+
+
+//
+// drop the index entry of a removed value, but if there is a duplicate left
+// in the array, index that one
+//
+static void   _mulle_concurrent_pointerarray_unindex_value( struct mulle_concurrent_pointerarray *array,
+                                                            void *value)
+{
+   intptr_t    hash;
+   void        *found;
+   uintptr_t   i;
+
+   hash = _mulle_concurrent_pointerarray_hash_value( value);
+   while( (found = _mulle_concurrent_hashmap_lookup( array->index, hash)) != MULLE_CONCURRENT_NO_POINTER)
+      _mulle_concurrent_hashmap_remove( array->index, hash, found);
+
+   i = _mulle_concurrent_pointerarray_scan_index( array, value);
+   if( i != MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND)
+      _mulle_concurrent_pointerarray_index_value( array, value, i);
 }
 
 
@@ -170,7 +662,7 @@ static void   _mulle_concurrent_pointerarraystorage_copy( struct _mulle_concurre
 #pragma mark _mulle_concurrent_pointerarray
 
 void  _mulle_concurrent_pointerarray_init( struct mulle_concurrent_pointerarray *array,
-                                           unsigned int size,
+                                           uintptr_t size,
                                            struct mulle_allocator *allocator)
 {
    struct _mulle_concurrent_pointerarraystorage   *storage;
@@ -181,7 +673,8 @@ void  _mulle_concurrent_pointerarray_init( struct mulle_concurrent_pointerarray
    assert( allocator->abafree && allocator->abafree != (int (*)()) abort);
 
    array->allocator = allocator;
-   storage          = _mulle_concurrent_alloc_pointerarraystorage( size, allocator);
+   array->index     = NULL;
+   storage          = _mulle_concurrent_alloc_pointerarraystorage( size, NULL, allocator);
 
    _mulle_atomic_pointer_nonatomic_write( &array->storage.pointer, storage);
    _mulle_atomic_pointer_nonatomic_write( &array->next_storage.pointer, storage);
@@ -199,30 +692,70 @@ void  _mulle_concurrent_pointerarray_done( struct mulle_concurrent_pointerarray
    storage      = _mulle_atomic_pointer_nonatomic_read( &array->storage.pointer);
    next_storage = _mulle_atomic_pointer_nonatomic_read( &array->next_storage.pointer);
 
-   _mulle_allocator_abafree( array->allocator, storage);
+   _mulle_concurrent_storagepool_abafree( storage);
    if( storage != next_storage)
-      _mulle_allocator_abafree( array->allocator, next_storage);
+   {
+      _mulle_concurrent_storagepool_abafree( next_storage->stage);
+      _mulle_concurrent_storagepool_abafree( next_storage);
+   }
+
+   if( array->index)
+   {
+      _mulle_concurrent_hashmap_done( array->index);
+      _mulle_allocator_free( array->allocator, array->index);
+   }
 }
 
 
-unsigned int  _mulle_concurrent_pointerarray_get_size( struct mulle_concurrent_pointerarray *array)
+int   _mulle_concurrent_pointerarray_init_indexed( struct mulle_concurrent_pointerarray *array,
+                                                   uintptr_t size,
+                                                   struct mulle_allocator *allocator)
+{
+   struct mulle_concurrent_hashmap   *index;
+   uintptr_t                         n;
+   int                               rval;
+
+   _mulle_concurrent_pointerarray_init( array, size, allocator);
+
+   index = _mulle_allocator_malloc( array->allocator, sizeof( struct mulle_concurrent_hashmap));
+   if( ! index)
+      rval = ENOMEM;
+   else
+   {
+      // hashmap needs twice the slots for the same number of entries
+      for( n = 4; n < size * 2; n <<= 1);
+      rval = _mulle_concurrent_hashmap_init( index, n, array->allocator);
+      if( ! rval)
+      {
+         array->index = index;
+         return( 0);
+      }
+      _mulle_allocator_free( array->allocator, index);
+   }
+
+   _mulle_concurrent_pointerarray_done( array);
+   return( rval);
+}
+
+
+uintptr_t     _mulle_concurrent_pointerarray_get_size( struct mulle_concurrent_pointerarray *array)
 {
    struct _mulle_concurrent_pointerarraystorage   *p;
 
    p = _mulle_atomic_pointer_read( &array->storage.pointer);
-   return( (unsigned int) p->size);
+   return( p->size);
 }
 
 
 //
 // obviously just a snapshot at some recent point in time
 //
-unsigned int   _mulle_concurrent_pointerarray_get_count( struct mulle_concurrent_pointerarray *array)
+uintptr_t      _mulle_concurrent_pointerarray_get_count( struct mulle_concurrent_pointerarray *array)
 {
    struct _mulle_concurrent_pointerarraystorage   *p;
 
    p = _mulle_atomic_pointer_read( &array->storage.pointer);
-   return( (unsigned int) (uintptr_t) _mulle_atomic_pointer_read( &p->n));
+   return( (uintptr_t) _mulle_atomic_pointer_read( &p->n));
 }
 
 
@@ -230,15 +763,22 @@ unsigned int   _mulle_concurrent_pointerarray_get_count( struct mulle_concurrent
 # pragma mark multi-threaded
 
 static void  _mulle_concurrent_pointerarray_migrate_storage( struct mulle_concurrent_pointerarray *array,
-                                                      struct _mulle_concurrent_pointerarraystorage *p)
+                                                             struct _mulle_concurrent_pointerarraystorage *p)
 {
-
    struct _mulle_concurrent_pointerarraystorage   *q;
    struct _mulle_concurrent_pointerarraystorage   *alloced;
    struct _mulle_concurrent_pointerarraystorage   *previous;
+   struct mulle_concurrent_migrationevent         event;
+   uintptr_t                                      size;
+   uintptr_t                                      n;
+   int                                            hooked;
 
    assert( p);
 
+   hooked = _mulle_concurrent_migrationhook_is_set();
+   if( hooked)
+      event.start = mulle_concurrent_timestamp();
+
    // acquire new storage
    alloced = NULL;
    q       = _mulle_atomic_pointer_read( &array->next_storage.pointer);
@@ -247,47 +787,94 @@ static void  _mulle_concurrent_pointerarray_migrate_storage( struct mulle_concur
 
    if( q == p)
    {
-      alloced = _mulle_concurrent_alloc_pointerarraystorage( (unsigned int) p->size * 2, array->allocator);
+      // tombstones are dropped, so only grow if that doesn't free enough
+      size = p->size;
+      if( _mulle_concurrent_pointerarraystorage_count_live( p) >= size / 2)
+         size *= 2;
+
+      alloced = _mulle_concurrent_alloc_pointerarraystorage( size, p, array->allocator);
 
       // make this the next world, assume that's still set to 'p' (SIC)
       q = __mulle_atomic_pointer_compare_and_swap( &array->next_storage.pointer, alloced, p);
       if( q != p)
       {
          // someone else produced a next world, use that and get rid of 'alloced'
-         _mulle_allocator_abafree( array->allocator, alloced);
+         _mulle_concurrent_storagepool_abafree( alloced->stage);
+         _mulle_concurrent_storagepool_abafree( alloced);
          alloced = NULL;
       }
       else
          q = alloced;
    }
 
-   // this thread can partake in copying
-   _mulle_concurrent_pointerarraystorage_copy( q, p);
+   //
+   // if 'q' is not the successor of 'p', then 'p' has been replaced
+   // already and 'q' is a later generation (also when we lost the race
+   // above). Copying 'p' into it, would write stale values past its count.
+   //
+   if( q->source != p)
+      return;
+
+   if( alloced)
+      MULLE_CONCURRENT_STATS_COUNT( POINTERARRAY, MIGRATIONS_STARTED);
+   else
+      MULLE_CONCURRENT_STATS_COUNT( POINTERARRAY, MIGRATIONS_JOINED);
+
+   if( hooked)
+   {
+      event.container = MULLE_CONCURRENT_STATS_POINTERARRAY;
+      event.object    = array;
+      event.old_size  = p->size;
+      event.new_size  = q->size;
+      event.n_copied  = 0;
+      if( alloced)
+         _mulle_concurrent_migrationhook_call( &event, MULLE_CONCURRENT_MIGRATION_STARTED);
+   }
+
+   // this thread can partake in freezing and copying
+   _mulle_concurrent_pointerarraystorage_freeze( q, p);
+   n = _mulle_concurrent_pointerarraystorage_copy( q, p, array->index);
+   if( hooked)
+   {
+      event.n_copied = n;
+      _mulle_concurrent_migrationhook_call( &event, MULLE_CONCURRENT_MIGRATION_COPIED);
+   }
 
    // now update world, giving it the same value as 'next_world'
    previous = __mulle_atomic_pointer_compare_and_swap( &array->storage.pointer, q, p);
 
-   // ok, if we succeed free old, if we fail alloced is
+   // ok, if we succeed free old and the stage, if we fail alloced is
    // already gone
    if( previous == p)
-      _mulle_allocator_abafree( array->allocator, previous);
+   {
+      if( hooked)
+         _mulle_concurrent_migrationhook_call( &event, MULLE_CONCURRENT_MIGRATION_SWAPPED);
+      _mulle_concurrent_storagepool_abafree( q->stage);
+      _mulle_concurrent_storagepool_abafree( previous);
+   }
 }
 
 
+// removed entries read as NO_POINTER
 void  *_mulle_concurrent_pointerarray_get( struct mulle_concurrent_pointerarray *array,
-                                           unsigned int index)
+                                           uintptr_t index)
 {
    struct _mulle_concurrent_pointerarraystorage   *p;
    void                                           *value;
 
+   MULLE_CONCURRENT_STATS_COUNT( POINTERARRAY, LOOKUPS);
+   MULLE_CONCURRENT_TRACE_RECORD( POINTERARRAY_GET, array, index);
+
 retry:
-   p     = _mulle_atomic_pointer_read( &array->storage.pointer);
+   p     = _mulle_concurrent_atomic_pointer_read_acquire( &array->storage.pointer);
    value = _mulle_concurrent_pointerarraystorage_get( p, index);
    if( value == REDIRECT_VALUE)
    {
       _mulle_concurrent_pointerarray_migrate_storage( array, p);
       goto retry;
    }
+   if( value == TOMBSTONE_VALUE)
+      return( MULLE_CONCURRENT_NO_POINTER);
    return( value);
 }
 
@@ -296,19 +883,58 @@ void  _mulle_concurrent_pointerarray_add( struct mulle_concurrent_pointerarray *
                                          void *value)
 {
    struct _mulle_concurrent_pointerarraystorage   *p;
+   uintptr_t                                      index;
 
    assert( value != MULLE_CONCURRENT_NO_POINTER);
+   assert( value != TOMBSTONE_VALUE);
    assert( value != REDIRECT_VALUE);
+   MULLE_CONCURRENT_STATS_COUNT( POINTERARRAY, INSERTS);
+   MULLE_CONCURRENT_TRACE_RECORD( POINTERARRAY_ADD, array, (uintptr_t) value);
 
 retry:
    p = _mulle_atomic_pointer_read( &array->storage.pointer);
-   switch( _mulle_concurrent_pointerarraystorage_add( p, value))
+   if( _mulle_concurrent_pointerarraystorage_add( p, value, &index) == ENOSPC)
    {
-   case EBUSY   :
-   case ENOSPC  :
+      MULLE_CONCURRENT_STATS_COUNT( POINTERARRAY, RETRIES);
       _mulle_concurrent_pointerarray_migrate_storage( array, p);
       goto retry;
    }
+
+   if( array->index)
+      _mulle_concurrent_pointerarray_index_value( array, value, index);
+}
+
+
+int  _mulle_concurrent_pointerarray_remove( struct mulle_concurrent_pointerarray *array,
+                                            void *value)
+{
+   struct _mulle_concurrent_pointerarraystorage   *p;
+   uintptr_t                                      index;
+
+   assert( value != MULLE_CONCURRENT_NO_POINTER);
+   assert( value != TOMBSTONE_VALUE);
+   assert( value != REDIRECT_VALUE);
+   MULLE_CONCURRENT_TRACE_RECORD( POINTERARRAY_REMOVE, array, (uintptr_t) value);
+
+retry:
+   p = _mulle_atomic_pointer_read( &array->storage.pointer);
+   switch( _mulle_concurrent_pointerarraystorage_remove( p, value, &index))
+   {
+   case ENOENT :
+      // it may have been frozen before the scan got to it
+      if( _mulle_atomic_pointer_read( &array->next_storage.pointer) == p)
+         return( ENOENT);
+      /* fall thru */
+
+   case EBUSY  :
+      MULLE_CONCURRENT_STATS_COUNT( POINTERARRAY, RETRIES);
+      _mulle_concurrent_pointerarray_migrate_storage( array, p);
+      goto retry;
+   }
+
+   if( array->index)
+      _mulle_concurrent_pointerarray_unindex_value( array, value);
+   return( 0);
 }
 
 
@@ -317,7 +943,8 @@ int  mulle_concurrent_pointerarray_add( struct mulle_concurrent_pointerarray *ar
 {
    if( ! array)
       return( EINVAL);
-   if( value == MULLE_CONCURRENT_NO_POINTER || value == MULLE_CONCURRENT_INVALID_POINTER)
+   if( value == MULLE_CONCURRENT_NO_POINTER || value == MULLE_CONCURRENT_INVALID_POINTER ||
+       value == MULLE_CONCURRENT_POINTERARRAY_REDIRECT_POINTER)
       return( EINVAL);
 
    _mulle_concurrent_pointerarray_add( array, value);
@@ -325,11 +952,24 @@ int  mulle_concurrent_pointerarray_add( struct mulle_concurrent_pointerarray *ar
 }
 
 
+int  mulle_concurrent_pointerarray_remove( struct mulle_concurrent_pointerarray *array,
+                                           void *value)
+{
+   if( ! array)
+      return( EINVAL);
+   if( value == MULLE_CONCURRENT_NO_POINTER || value == MULLE_CONCURRENT_INVALID_POINTER ||
+       value == MULLE_CONCURRENT_POINTERARRAY_REDIRECT_POINTER)
+      return( EINVAL);
+
+   return( _mulle_concurrent_pointerarray_remove( array, value));
+}
+
+
 void  *mulle_concurrent_pointerarray_get( struct mulle_concurrent_pointerarray *array,
-                                          unsigned int i)
+                                          uintptr_t i)
 {
    if( ! array)
-      return( NULL);
+      return( MULLE_CONCURRENT_NO_POINTER);
    return( _mulle_concurrent_pointerarray_get( array, i));
 }
 
@@ -340,64 +980,163 @@ int  mulle_concurrent_pointerarray_find( struct mulle_concurrent_pointerarray *a
 {
    if( ! array)
       return( EINVAL);
-   if( value == MULLE_CONCURRENT_NO_POINTER || value == MULLE_CONCURRENT_INVALID_POINTER)
+   if( value == MULLE_CONCURRENT_NO_POINTER || value == MULLE_CONCURRENT_INVALID_POINTER ||
+       value == MULLE_CONCURRENT_POINTERARRAY_REDIRECT_POINTER)
       return( EINVAL);
    return( _mulle_concurrent_pointerarray_find( array, value));
 }
 
 
+uintptr_t     mulle_concurrent_pointerarray_index_of( struct mulle_concurrent_pointerarray *array,
+                                                      void *value)
+{
+   if( ! array)
+      return( MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
+   if( value == MULLE_CONCURRENT_NO_POINTER || value == MULLE_CONCURRENT_INVALID_POINTER ||
+       value == MULLE_CONCURRENT_POINTERARRAY_REDIRECT_POINTER)
+      return( MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
+   return( _mulle_concurrent_pointerarray_index_of( array, value));
+}
+
+
 #pragma mark -
 #pragma mark not so concurrent enumerator
 
+//
+// If the storage changed since the last call, it has been compacted and
+// the enumerator position must be mapped. If it's just one migration
+// later, the survivors say exactly where to continue. Otherwise the entries
+// can have moved down by as many tombstones as were dropped since. In that
+// range look for the last returned value and if that's gone too, continue
+// at the lowest position a value not yet returned can be at. Some values
+// may then be returned twice, but none is skipped.
+//
 void  *_mulle_concurrent_pointerarrayenumerator_next( struct mulle_concurrent_pointerarrayenumerator *rover)
 {
-   void           *value;
-   unsigned int   n;
+   struct _mulle_concurrent_pointerarraystorage   *p;
+   void                                           *value;
+   uintptr_t                                      i;
+   uintptr_t                                      dropped;
+   uintptr_t                                      moved;
+   uintptr_t                                      lower;
 
-   n = mulle_concurrent_pointerarray_get_count( rover->array);
-   if( rover->index >= n)
+   if( ! rover->array)
       return( MULLE_CONCURRENT_NO_POINTER);
 
-   value = _mulle_concurrent_pointerarray_get( rover->array, rover->index);
-   assert( value != MULLE_CONCURRENT_NO_POINTER);
+retry:
+   p = _mulle_concurrent_atomic_pointer_read_acquire( &rover->array->storage.pointer);
+   if( p->generation != rover->generation)
+   {
+      dropped = (uintptr_t) _mulle_atomic_pointer_read( &p->dropped);
+      if( rover->generation)
+      {
+         if( p->generation == rover->generation + 1)
+            rover->index = _mulle_concurrent_pointerarraystorage_map_index( p, rover->index);
+         else
+         {
+            moved        = dropped - rover->dropped;
+            lower        = rover->index > moved ? rover->index - moved : 0;
+            i            = _mulle_concurrent_pointerarraystorage_relocate( p, lower, rover->index, rover->last);
+            rover->index = (i != MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND) ? i + 1 : lower;
+         }
+      }
+      rover->generation = p->generation;
+      rover->dropped    = dropped;
+   }
+
+   do
+   {
+      value = _mulle_concurrent_pointerarraystorage_get( p, rover->index);
+      if( value == MULLE_CONCURRENT_NO_POINTER)
+         return( MULLE_CONCURRENT_NO_POINTER);
+      if( value == REDIRECT_VALUE)
+      {
+         _mulle_concurrent_pointerarray_migrate_storage( rover->array, p);
+         goto retry;
+      }
+      ++rover->index;
+   }
+   while( value == TOMBSTONE_VALUE);
 
-   ++rover->index;
+   rover->last = value;
    return( value);
 }
 
 
+//
+// Same as above, but all entries below index are still to be returned, so
+// they are all in [0, index[ after a compaction. 'last' was at index.
+//
 void   *_mulle_concurrent_pointerarrayreverseenumerator_next( struct mulle_concurrent_pointerarrayreverseenumerator *rover)
 {
-   void   *value;
+   struct _mulle_concurrent_pointerarraystorage   *p;
+   void                                           *value;
+   uintptr_t                                      i;
+   uintptr_t                                      dropped;
+   uintptr_t                                      moved;
+   uintptr_t                                      lower;
 
    if( ! rover->index)
       return( MULLE_CONCURRENT_NO_POINTER);
 
-   value = _mulle_concurrent_pointerarray_get( rover->array, --rover->index);
-   assert( value != MULLE_CONCURRENT_NO_POINTER);
+retry:
+   p = _mulle_concurrent_atomic_pointer_read_acquire( &rover->array->storage.pointer);
+   if( p->generation != rover->generation)
+   {
+      dropped = (uintptr_t) _mulle_atomic_pointer_read( &p->dropped);
+      if( rover->generation)
+      {
+         if( p->generation == rover->generation + 1)
+            rover->index = _mulle_concurrent_pointerarraystorage_map_index( p, rover->index);
+         else
+         {
+            moved = dropped - rover->dropped;
+            lower = rover->index > moved ? rover->index - moved : 0;
+            i     = _mulle_concurrent_pointerarraystorage_relocate( p, lower, rover->index + 1, rover->last);
+            if( i != MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND)
+               rover->index = i;
+         }
+      }
+      rover->generation = p->generation;
+      rover->dropped    = dropped;
+   }
 
-   return( value);
+   while( rover->index)
+   {
+      value = _mulle_concurrent_pointerarraystorage_get( p, rover->index - 1);
+      if( value == REDIRECT_VALUE)
+      {
+         _mulle_concurrent_pointerarray_migrate_storage( rover->array, p);
+         goto retry;
+      }
+      --rover->index;
+      if( value != MULLE_CONCURRENT_NO_POINTER && value != TOMBSTONE_VALUE)
+      {
+         rover->last = value;
+         return( value);
+      }
+   }
+   return( MULLE_CONCURRENT_NO_POINTER);
 }
 
 
-int   _mulle_concurrent_pointerarray_find( struct mulle_concurrent_pointerarray *array,
-                                           void *search)
+//
+// with a side index, this is a hashmap lookup. Otherwise it scans the
+// storage directly instead of going through the enumerator
+//
+uintptr_t      _mulle_concurrent_pointerarray_index_of( struct mulle_concurrent_pointerarray *array,
+                                                        void *search)
 {
-   struct mulle_concurrent_pointerarrayenumerator   rover;
-   int                                              found;
-   void                                             *value;
+   if( array->index)
+      return( _mulle_concurrent_pointerarray_lookup_index( array, search));
+   return( _mulle_concurrent_pointerarray_scan_index( array, search));
+}
 
-   found = 0;
-   rover = mulle_concurrent_pointerarray_enumerate( array);
-   while( value = _mulle_concurrent_pointerarrayenumerator_next( &rover))
-      if( value == search)
-      {
-         found = 1;
-         break;
-      }
-   mulle_concurrent_pointerarrayenumerator_done( &rover);
 
-   return( found);
+int   _mulle_concurrent_pointerarray_find( struct mulle_concurrent_pointerarray *array,
+                                           void *search)
+{
+   return( _mulle_concurrent_pointerarray_index_of( array, search) != MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
 }
 
 
@@ -409,9 +1148,306 @@ int   mulle_concurrent_pointerarray_map( struct mulle_concurrent_pointerarray *l
    void                                            *value;
 
    rover = mulle_concurrent_pointerarray_enumerate( list);
-   while( value = _mulle_concurrent_pointerarrayenumerator_next( &rover))
+   while( (value = _mulle_concurrent_pointerarrayenumerator_next( &rover)) != MULLE_CONCURRENT_NO_POINTER)
       (*f)( value, userinfo);
    mulle_concurrent_pointerarrayenumerator_done( &rover);
 
    return( 0);
 }
+
+
+#pragma mark -
+#pragma mark parallel map
+
+//
+// The live values are copied into a snapshot first, so the workers never
+// touch the array and need not be registered with mulle_aba. The snapshot
+// is split into one range per worker. A worker takes chunks from the front
+// of its own range and when that is empty, it takes chunks from the ranges
+// of the other workers. So any single worker will process everything that
+// is left.
+//
+#define PARALLEL_MAP_CHUNK   16
+
+
+struct _mulle_concurrent_pointerarray_mapcontext;
+
+struct _mulle_concurrent_pointerarray_mapworker
+{
+   mulle_atomic_pointer_t                             next;
+   uintptr_t                                          end;
+   struct _mulle_concurrent_pointerarray_mapcontext   *ctx;
+   unsigned int                                       i;
+};
+
+
+struct _mulle_concurrent_pointerarray_mapcontext
+{
+   void                                              **values;
+   struct _mulle_concurrent_pointerarray_mapworker   *workers;
+   unsigned int                                      n_workers;
+   void                                              (*f)( void *, void *);
+   void                                              *userinfo;
+};
+
+
+static int   _mulle_concurrent_pointerarray_mapworker_claim( struct _mulle_concurrent_pointerarray_mapworker *p,
+                                                             uintptr_t *begin,
+                                                             uintptr_t *end)
+{
+   void        *old;
+   uintptr_t   next;
+   uintptr_t   stop;
+
+   for(;;)
+   {
+      old  = _mulle_atomic_pointer_read( &p->next);
+      next = (uintptr_t) old;
+      if( next >= p->end)
+         return( 0);
+
+      stop = next + PARALLEL_MAP_CHUNK;
+      if( stop > p->end)
+         stop = p->end;
+
+      if( _mulle_atomic_pointer_compare_and_swap( &p->next, (void *) stop, old))
+      {
+         *begin = next;
+         *end   = stop;
+         return( 1);
+      }
+   }
+}
+
+
+static void   _mulle_concurrent_pointerarray_mapworker_run( struct _mulle_concurrent_pointerarray_mapworker *worker)
+{
+   struct _mulle_concurrent_pointerarray_mapcontext   *ctx;
+   struct _mulle_concurrent_pointerarray_mapworker    *victim;
+   unsigned int                                       k;
+   uintptr_t                                          i;
+   uintptr_t                                          end;
+
+   ctx = worker->ctx;
+   for( k = 0; k < ctx->n_workers; k++)
+   {
+      victim = &ctx->workers[ (worker->i + k) % ctx->n_workers];
+      while( _mulle_concurrent_pointerarray_mapworker_claim( victim, &i, &end))
+         for( ; i < end; i++)
+            (*ctx->f)( ctx->values[ i], ctx->userinfo);
+   }
+}
+
+
+//
+// what a thread of the thread executor needs to run its worker
+//
+struct _mulle_concurrent_pointerarray_threadstart
+{
+   void             (*worker)( void *);
+   void             *info;
+   mulle_thread_t   thread;
+};
+
+
+// the worker has a different signature than a thread function
+static void   *_mulle_concurrent_pointerarray_threadstart_run( void *arg)
+{
+   struct _mulle_concurrent_pointerarray_threadstart   *start;
+
+   start = arg;
+   (*start->worker)( start->info);
+   return( NULL);
+}
+
+
+//
+// runs the first worker on the calling thread and the others on
+// mulle_threads. If a thread can't be created, the remaining workers just
+// don't run, the others will do their work.
+//
+static int   _mulle_concurrent_pointerarray_thread_executor( void (*worker)( void *),
+                                                             void **worker_infos,
+                                                             unsigned int n,
+                                                             void *executor_info)
+{
+   struct _mulle_concurrent_pointerarray_threadstart   *starts;
+   struct mulle_allocator                              *allocator;
+   unsigned int                                        i;
+   unsigned int                                        n_started;
+
+   allocator = executor_info;
+   starts    = NULL;
+   if( n > 1)
+      starts = _mulle_allocator_malloc( allocator, sizeof( *starts) * n);
+
+   n_started = 1;
+   if( starts)
+      for( ; n_started < n; n_started++)
+      {
+         starts[ n_started].worker = worker;
+         starts[ n_started].info   = worker_infos[ n_started];
+         if( mulle_thread_create( _mulle_concurrent_pointerarray_threadstart_run,
+                                  &starts[ n_started],
+                                  &starts[ n_started].thread))
+            break;
+      }
+
+   (*worker)( worker_infos[ 0]);
+
+   for( i = 1; i < n_started; i++)
+      mulle_thread_join( starts[ i].thread);
+
+   _mulle_allocator_free( allocator, starts);
+   return( 0);
+}
+
+
+static void   **_mulle_concurrent_pointerarray_snapshot( struct mulle_concurrent_pointerarray *array,
+                                                         uintptr_t *p_n)
+{
+   struct mulle_concurrent_pointerarrayenumerator  rover;
+   void                                            **values;
+   void                                            **tmp;
+   void                                            *value;
+   uintptr_t                                        size;
+   uintptr_t                                        n;
+
+   // count includes removed entries, so this is usually big enough
+   size = _mulle_concurrent_pointerarray_get_count( array);
+   if( size < PARALLEL_MAP_CHUNK)
+      size = PARALLEL_MAP_CHUNK;
+
+   values = _mulle_allocator_malloc( array->allocator, sizeof( void *) * size);
+   if( ! values)
+      return( NULL);
+
+   n     = 0;
+   rover = mulle_concurrent_pointerarray_enumerate( array);
+   while( (value = _mulle_concurrent_pointerarrayenumerator_next( &rover)) != MULLE_CONCURRENT_NO_POINTER)
+   {
+      if( n == size)
+      {
+         size *= 2;
+         tmp   = _mulle_allocator_realloc( array->allocator, values, sizeof( void *) * size);
+         if( ! tmp)
+         {
+            _mulle_allocator_free( array->allocator, values);
+            values = NULL;
+            break;
+         }
+         values = tmp;
+      }
+      values[ n++] = value;
+   }
+   mulle_concurrent_pointerarrayenumerator_done( &rover);
+
+   *p_n = n;
+   return( values);
+}
+
+
+int   _mulle_concurrent_pointerarray_parallel_map( struct mulle_concurrent_pointerarray *array,
+                                                   unsigned int n_workers,
+                                                   void (*f)( void *, void *),
+                                                   void *userinfo,
+                                                   mulle_concurrent_pointerarray_executor_t *executor,
+                                                   void *executor_info)
+{
+   struct _mulle_concurrent_pointerarray_mapcontext   ctx;
+   struct _mulle_concurrent_pointerarray_mapworker    *workers;
+   void                                               **infos;
+   uintptr_t                                          n;
+   uintptr_t                                          n_chunks;
+   unsigned int                                       i;
+   int                                                rval;
+
+   ctx.values = _mulle_concurrent_pointerarray_snapshot( array, &n);
+   if( ! ctx.values)
+      return( ENOMEM);
+
+   rval = 0;
+   if( ! n)
+      goto done;
+
+   // no point in having workers without a chunk of their own
+   n_chunks = (n + PARALLEL_MAP_CHUNK - 1) / PARALLEL_MAP_CHUNK;
+   if( n_workers > n_chunks)
+      n_workers = (unsigned int) n_chunks;
+
+   workers = _mulle_allocator_calloc( array->allocator, n_workers, sizeof( *workers));
+   infos   = _mulle_allocator_calloc( array->allocator, n_workers, sizeof( void *));
+   if( ! workers || ! infos)
+   {
+      _mulle_allocator_free( array->allocator, infos);
+      _mulle_allocator_free( array->allocator, workers);
+      rval = ENOMEM;
+      goto done;
+   }
+
+   ctx.workers   = workers;
+   ctx.n_workers = n_workers;
+   ctx.f         = f;
+   ctx.userinfo  = userinfo;
+
+   for( i = 0; i < n_workers; i++)
+   {
+      _mulle_atomic_pointer_nonatomic_write( &workers[ i].next,
+                                             (void *) (uintptr_t) ((unsigned long long) n * i / n_workers));
+      workers[ i].end = (uintptr_t) ((unsigned long long) n * (i + 1) / n_workers);
+      workers[ i].ctx = &ctx;
+      workers[ i].i   = i;
+      infos[ i]       = &workers[ i];
+   }
+
+   rval = (*executor)( (void (*)( void *)) _mulle_concurrent_pointerarray_mapworker_run,
+                       infos,
+                       n_workers,
+                       executor_info);
+
+   // pick up whatever the executor left undone
+   _mulle_concurrent_pointerarray_mapworker_run( &workers[ 0]);
+
+   _mulle_allocator_free( array->allocator, infos);
+   _mulle_allocator_free( array->allocator, workers);
+
+done:
+   _mulle_allocator_free( array->allocator, ctx.values);
+   return( rval);
+}
+
+
+int   mulle_concurrent_pointerarray_parallel_map_with_executor( struct mulle_concurrent_pointerarray *array,
+                                                                unsigned int n_workers,
+                                                                void (*f)( void *, void *),
+                                                                void *userinfo,
+                                                                mulle_concurrent_pointerarray_executor_t *executor,
+                                                                void *executor_info)
+{
+   if( ! array || ! n_workers || ! f || ! executor)
+      return( EINVAL);
+
+   return( _mulle_concurrent_pointerarray_parallel_map( array,
+                                                        n_workers,
+                                                        f,
+                                                        userinfo,
+                                                        executor,
+                                                        executor_info));
+}
+
+
+int   mulle_concurrent_pointerarray_parallel_map( struct mulle_concurrent_pointerarray *array,
+                                                  unsigned int n_workers,
+                                                  void (*f)( void *, void *),
+                                                  void *userinfo)
+{
+   if( ! array || ! n_workers || ! f)
+      return( EINVAL);
+
+   return( _mulle_concurrent_pointerarray_parallel_map( array,
+                                                        n_workers,
+                                                        f,
+                                                        userinfo,
+                                                        _mulle_concurrent_pointerarray_thread_executor,
+                                                        array->allocator));
+}
@@ -39,8 +39,12 @@
 #include <mulle_thread/mulle_thread.h>
 #include <mulle_allocator/mulle_allocator.h>
 
+#include "mulle_concurrent_types.h"
+#include "mulle_concurrent_stats.h"
+
 
 struct _mulle_concurrent_pointerarraystorage;
+struct mulle_concurrent_hashmap;
 
 
 union mulle_concurrent_atomicpointerarraystorage_t
@@ -50,14 +54,32 @@ union mulle_concurrent_atomicpointerarraystorage_t
 };
 
 
+//
+// index is an optional side index (value -> index), that makes find and
+// index_of O(1). With MULLE_CONCURRENT_CACHELINE_LAYOUT next_storage, which
+// is written when a migration starts, is kept off the line of storage.
+//
 struct mulle_concurrent_pointerarray
 {
-   union mulle_concurrent_atomicpointerarraystorage_t   storage;
-   union mulle_concurrent_atomicpointerarraystorage_t   next_storage;
+   union mulle_concurrent_atomicpointerarraystorage_t   storage MULLE_CONCURRENT_CACHELINE_ALIGNED;
    struct mulle_allocator                               *allocator;
+   struct mulle_concurrent_hashmap                      *index;
+   union mulle_concurrent_atomicpointerarraystorage_t   next_storage MULLE_CONCURRENT_CACHELINE_ALIGNED;
 };
 
 
+#define MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND   ((uintptr_t) -1)
+
+//
+// Besides MULLE_CONCURRENT_NO_POINTER and MULLE_CONCURRENT_INVALID_POINTER,
+// this value can't be stored. It marks entries, that have been moved to a
+// new storage.
+//
+#ifndef MULLE_CONCURRENT_POINTERARRAY_REDIRECT_POINTER
+# define MULLE_CONCURRENT_POINTERARRAY_REDIRECT_POINTER   ((void *) (INTPTR_MIN + 1))
+#endif
+
+
 #pragma mark -
 #pragma mark single-threaded
 
@@ -67,11 +89,11 @@ struct mulle_concurrent_pointerarray
 //   ENOMEM : out of memory
 //
 static inline int  mulle_concurrent_pointerarray_init( struct mulle_concurrent_pointerarray *array,
-                                                       unsigned int size,
+                                                       uintptr_t size,
                                                        struct mulle_allocator *allocator)
 {
    void  _mulle_concurrent_pointerarray_init( struct mulle_concurrent_pointerarray *array,
-                                              unsigned int size,
+                                              uintptr_t size,
                                               struct mulle_allocator *allocator);
    if( ! array)
       return( EINVAL);
@@ -81,6 +103,25 @@ static inline int  mulle_concurrent_pointerarray_init( struct mulle_concurrent_p
 }
 
 
+//
+// Like mulle_concurrent_pointerarray_init, but also maintains a
+// mulle_concurrent_hashmap as a side index. This costs an extra hashmap
+// insert per add, but find and index_of are then hash lookups.
+//
+static inline int  mulle_concurrent_pointerarray_init_indexed( struct mulle_concurrent_pointerarray *array,
+                                                               uintptr_t size,
+                                                               struct mulle_allocator *allocator)
+{
+   int  _mulle_concurrent_pointerarray_init_indexed( struct mulle_concurrent_pointerarray *array,
+                                                     uintptr_t size,
+                                                     struct mulle_allocator *allocator);
+   if( ! array)
+      return( EINVAL);
+
+   return( _mulle_concurrent_pointerarray_init_indexed( array, size, allocator));
+}
+
+
 static inline void  mulle_concurrent_pointerarray_done( struct mulle_concurrent_pointerarray *array)
 {
    void  _mulle_concurrent_pointerarray_done( struct mulle_concurrent_pointerarray *array);
@@ -90,9 +131,9 @@ static inline void  mulle_concurrent_pointerarray_done( struct mulle_concurrent_
 }
 
 
-static inline unsigned int  mulle_concurrent_pointerarray_get_size( struct mulle_concurrent_pointerarray *array)
+static inline uintptr_t     mulle_concurrent_pointerarray_get_size( struct mulle_concurrent_pointerarray *array)
 {
-   unsigned int  _mulle_concurrent_pointerarray_get_size( struct mulle_concurrent_pointerarray *array);
+   uintptr_t     _mulle_concurrent_pointerarray_get_size( struct mulle_concurrent_pointerarray *array);
    
    if( ! array)
       return( 0);
@@ -100,9 +141,9 @@ static inline unsigned int  mulle_concurrent_pointerarray_get_size( struct mulle
 }
 
 
-static inline unsigned int  mulle_concurrent_pointerarray_get_count( struct mulle_concurrent_pointerarray *array)
+static inline uintptr_t     mulle_concurrent_pointerarray_get_count( struct mulle_concurrent_pointerarray *array)
 {
-   unsigned int  _mulle_concurrent_pointerarray_get_count( struct mulle_concurrent_pointerarray *array);
+   uintptr_t     _mulle_concurrent_pointerarray_get_count( struct mulle_concurrent_pointerarray *array);
 
    if( ! array)
       return( 0);
@@ -121,25 +162,62 @@ static inline unsigned int  mulle_concurrent_pointerarray_get_count( struct mull
 int  mulle_concurrent_pointerarray_add( struct mulle_concurrent_pointerarray *array,
                                         void *value);
 
+// Returns MULLE_CONCURRENT_NO_POINTER if i is out of range or the value at i
+// has been removed
 void  *mulle_concurrent_pointerarray_get( struct mulle_concurrent_pointerarray *array,
-                                          unsigned int i);
+                                          uintptr_t i);
+
+// Removes the first occurence of value. The slot becomes a tombstone, that
+// is skipped by the enumerators and dropped, when the array is migrated
+// to a new storage. Indices of later values change then!
+//
+// Returns:
+//   0      : OK
+//   ENOENT : value not found
+//   EINVAL : invalid argument
+//
+int  mulle_concurrent_pointerarray_remove( struct mulle_concurrent_pointerarray *array,
+                                           void *value);
 
+// Returns:
+//   1      : found
+//   0      : not found
+//   EINVAL : invalid argument
+//
 int  mulle_concurrent_pointerarray_find( struct mulle_concurrent_pointerarray *array,
                                          void *value);
 
+// Returns the index of the first occurence of value or
+// MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND. With a side index and concurrent
+// adds of the same value, it may be the index of a later duplicate.
+//
+uintptr_t     mulle_concurrent_pointerarray_index_of( struct mulle_concurrent_pointerarray *array,
+                                                      void *value);
+
 #pragma mark -
 #pragma mark enumerator
 
+//
+// generation, dropped and last are used to map the position, if the array
+// was compacted during enumeration. generation 0 means, that the enumerator
+// hasn't looked at a storage yet.
+//
 struct mulle_concurrent_pointerarrayenumerator
 {
    struct mulle_concurrent_pointerarray   *array;
-   unsigned int                            index;
+   uintptr_t                              index;
+   uintptr_t                              generation;
+   uintptr_t                              dropped;
+   void                                   *last;
 };
 
 struct mulle_concurrent_pointerarrayreverseenumerator
 {
    struct mulle_concurrent_pointerarray   *array;
-   unsigned int                           index;
+   uintptr_t                              index;
+   uintptr_t                              generation;
+   uintptr_t                              dropped;
+   void                                   *last;
 };
 
 //
@@ -150,21 +228,27 @@ static inline struct mulle_concurrent_pointerarrayenumerator
 {
    struct mulle_concurrent_pointerarrayenumerator   rover;
    
-   rover.array = array;
-   rover.index = array ? 0 : (unsigned int) -1;
-   
+   rover.array      = array;
+   rover.index      = array ? 0 : (uintptr_t) -1;
+   rover.generation = 0;
+   rover.dropped    = 0;
+   rover.last       = MULLE_CONCURRENT_NO_POINTER;
+
    return( rover);
 }
 
 
 static inline struct mulle_concurrent_pointerarrayreverseenumerator
-   mulle_concurrent_pointerarray_reverseenumerate( struct mulle_concurrent_pointerarray *array, unsigned int n)
+   mulle_concurrent_pointerarray_reverseenumerate( struct mulle_concurrent_pointerarray *array, uintptr_t n)
 {
    struct mulle_concurrent_pointerarrayreverseenumerator   rover;
    
-   rover.array = array;
-   rover.index = n;
-   
+   rover.array      = array;
+   rover.index      = array ? n : 0;
+   rover.generation = 0;
+   rover.dropped    = 0;
+   rover.last       = MULLE_CONCURRENT_NO_POINTER;
+
    return( rover);
 }
 
@@ -178,7 +262,7 @@ static inline void  *mulle_concurrent_pointerarrayenumerator_next( struct mulle_
    void   *_mulle_concurrent_pointerarrayenumerator_next( struct mulle_concurrent_pointerarrayenumerator *rover);
 
    if( ! rover)
-      return(  NULL);
+      return( MULLE_CONCURRENT_NO_POINTER);
    return( _mulle_concurrent_pointerarrayenumerator_next( rover));
 }
 
@@ -188,7 +272,7 @@ static inline void  *mulle_concurrent_pointerarrayreverseenumerator_next( struct
    void   *_mulle_concurrent_pointerarrayreverseenumerator_next( struct mulle_concurrent_pointerarrayreverseenumerator *rover);
 
    if( ! rover)
-      return( NULL);
+      return( MULLE_CONCURRENT_NO_POINTER);
    return( _mulle_concurrent_pointerarrayreverseenumerator_next( rover));
 }
 
@@ -210,26 +294,87 @@ int   mulle_concurrent_pointerarray_map( struct mulle_concurrent_pointerarray *l
                                         void (*f)( void *, void *),
                                         void *userinfo);
 
+
+//
+// An executor must call worker( worker_infos[ i]) for i = 0 to n-1, ideally
+// each on its own thread, and must not return before those calls are done.
+// It may skip workers, as the others will do their work.
+//
+typedef int   mulle_concurrent_pointerarray_executor_t( void (*worker)( void *),
+                                                        void **worker_infos,
+                                                        unsigned int n,
+                                                        void *executor_info);
+
+//
+// Calls f for each value of a snapshot of the array. The snapshot is split
+// into up to n_workers ranges, which are run on mulle_threads (the calling
+// thread being one of them). Idle workers take over parts of the ranges of
+// the others. f is called concurrently and in no particular order.
+//
+int   mulle_concurrent_pointerarray_parallel_map( struct mulle_concurrent_pointerarray *array,
+                                                  unsigned int n_workers,
+                                                  void (*f)( void *, void *),
+                                                  void *userinfo);
+
+int   mulle_concurrent_pointerarray_parallel_map_with_executor( struct mulle_concurrent_pointerarray *array,
+                                                                unsigned int n_workers,
+                                                                void (*f)( void *, void *),
+                                                                void *userinfo,
+                                                                mulle_concurrent_pointerarray_executor_t *executor,
+                                                                void *executor_info);
+
+#pragma mark -
+#pragma mark stats
+
+//
+// the counters of all pointerarrays, if compiled with MULLE_CONCURRENT_STATS
+//
+// Returns:
+//   0      : OK
+//   EINVAL : invalid argument
+//   ENOSYS : compiled without MULLE_CONCURRENT_STATS, stats is zeroed
+//
+static inline int   mulle_concurrent_pointerarray_get_stats( struct mulle_concurrent_stats *stats)
+{
+   if( ! stats)
+      return( EINVAL);
+   return( _mulle_concurrent_stats_get( MULLE_CONCURRENT_STATS_POINTERARRAY, stats));
+}
+
+
 #pragma mark -
 #pragma mark various functions, no parameter checks
 
 void  _mulle_concurrent_pointerarray_init( struct mulle_concurrent_pointerarray *array,
-                                          unsigned int size,
+                                          uintptr_t size,
                                           struct mulle_allocator *allocator);
 void  _mulle_concurrent_pointerarray_done( struct mulle_concurrent_pointerarray *array);
 
-unsigned int  _mulle_concurrent_pointerarray_get_size( struct mulle_concurrent_pointerarray *array);
-unsigned int  _mulle_concurrent_pointerarray_get_count( struct mulle_concurrent_pointerarray *array);
+uintptr_t     _mulle_concurrent_pointerarray_get_size( struct mulle_concurrent_pointerarray *array);
+uintptr_t     _mulle_concurrent_pointerarray_get_count( struct mulle_concurrent_pointerarray *array);
 
 void  _mulle_concurrent_pointerarray_add( struct mulle_concurrent_pointerarray *array,
                                          void *value);
 
 void  *_mulle_concurrent_pointerarray_get( struct mulle_concurrent_pointerarray *array,
-                                           unsigned int i);
+                                           uintptr_t i);
+
+int  _mulle_concurrent_pointerarray_remove( struct mulle_concurrent_pointerarray *array,
+                                            void *value);
+
+int   _mulle_concurrent_pointerarray_parallel_map( struct mulle_concurrent_pointerarray *array,
+                                                   unsigned int n_workers,
+                                                   void (*f)( void *, void *),
+                                                   void *userinfo,
+                                                   mulle_concurrent_pointerarray_executor_t *executor,
+                                                   void *executor_info);
 
 int  _mulle_concurrent_pointerarray_find( struct mulle_concurrent_pointerarray *array,
                                           void *value);
 
+uintptr_t     _mulle_concurrent_pointerarray_index_of( struct mulle_concurrent_pointerarray *array,
+                                                       void *value);
+
 void   *_mulle_concurrent_pointerarrayenumerator_next( struct mulle_concurrent_pointerarrayenumerator *rover);
 
 
@@ -0,0 +1,386 @@
+//
+//  mulle_concurrent_reclaim.c
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#include "mulle_concurrent_reclaim.h"
+
+#include "mulle_concurrent_storagepool.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+
+
+//
+// every retire stamps the block with a fresh global epoch. A thread that
+// is online publishes the global epoch it last saw at a quiescent state (or
+// when it went online). A block can be freed, when no online thread has
+// published an epoch older than the stamp of the block.
+//
+struct _mulle_concurrent_reclaimnode
+{
+   struct _mulle_concurrent_reclaimnode   *next;
+   void                                   (*free)( void *);
+   void                                   *block;
+   uintptr_t                              epoch;
+};
+
+
+//
+// the allocators made by mulle_concurrent_reclaim_init_allocator, their
+// blocks are drained from the storagepool on done
+//
+struct _mulle_concurrent_reclaimallocator
+{
+   struct _mulle_concurrent_reclaimallocator   *next;
+   struct mulle_allocator                      *allocator;
+};
+
+
+static inline uintptr_t   _mulle_concurrent_reclaim_get_epoch( struct mulle_concurrent_reclaim *p)
+{
+   return( (uintptr_t) _mulle_atomic_pointer_read( &p->epoch));
+}
+
+
+static uintptr_t   _mulle_concurrent_reclaim_next_epoch( struct mulle_concurrent_reclaim *p)
+{
+   uintptr_t   epoch;
+
+   do
+      epoch = _mulle_concurrent_reclaim_get_epoch( p);
+   while( ! _mulle_atomic_pointer_compare_and_swap( &p->epoch,
+                                                    (void *) (epoch + 1),
+                                                    (void *) epoch));
+   return( epoch + 1);
+}
+
+
+static void   _mulle_concurrent_reclaim_lock( struct mulle_concurrent_reclaim *p)
+{
+   while( ! _mulle_atomic_pointer_compare_and_swap( &p->lock, (void *) 1, NULL))
+      mulle_thread_yield();
+}
+
+
+static inline int   _mulle_concurrent_reclaim_trylock( struct mulle_concurrent_reclaim *p)
+{
+   return( _mulle_atomic_pointer_compare_and_swap( &p->lock, (void *) 1, NULL));
+}
+
+
+static void   _mulle_concurrent_reclaim_unlock( struct mulle_concurrent_reclaim *p)
+{
+   _mulle_atomic_pointer_write( &p->lock, NULL);
+}
+
+
+static void   _mulle_concurrent_reclaim_push( struct mulle_concurrent_reclaim *p,
+                                              struct _mulle_concurrent_reclaimnode *first,
+                                              struct _mulle_concurrent_reclaimnode *last)
+{
+   struct _mulle_concurrent_reclaimnode   *head;
+
+   // only the whole list is ever taken, so there is no ABA problem here
+   do
+   {
+      head       = _mulle_atomic_pointer_read( &p->retired);
+      last->next = head;
+   }
+   while( ! _mulle_atomic_pointer_compare_and_swap( &p->retired, first, head));
+}
+
+
+static struct _mulle_concurrent_reclaimnode  *
+   _mulle_concurrent_reclaim_take( struct mulle_concurrent_reclaim *p)
+{
+   struct _mulle_concurrent_reclaimnode   *head;
+
+   do
+   {
+      head = _mulle_atomic_pointer_read( &p->retired);
+      if( ! head)
+         break;
+   }
+   while( ! _mulle_atomic_pointer_compare_and_swap( &p->retired, NULL, head));
+   return( head);
+}
+
+
+static void   _mulle_concurrent_reclaim_free_node( struct mulle_concurrent_reclaim *p,
+                                                   struct _mulle_concurrent_reclaimnode *node)
+{
+   (*node->free)( node->block);
+   _mulle_allocator_free( p->allocator, node);
+}
+
+
+//
+// whoever gets the lock, frees what is safe to free. Everybody else just
+// moves on, the next quiescent state will get to it.
+//
+static void   _mulle_concurrent_reclaim_collect( struct mulle_concurrent_reclaim *p)
+{
+   struct mulle_concurrent_reclaimthread   *thread;
+   struct _mulle_concurrent_reclaimnode    *node;
+   struct _mulle_concurrent_reclaimnode    *next;
+   struct _mulle_concurrent_reclaimnode    *keep;
+   struct _mulle_concurrent_reclaimnode    *last;
+   uintptr_t                               oldest;
+   uintptr_t                               epoch;
+
+   if( ! _mulle_atomic_pointer_read( &p->retired))
+      return;
+   if( ! _mulle_concurrent_reclaim_trylock( p))
+      return;
+
+   oldest = UINTPTR_MAX;
+   for( thread = p->threads; thread; thread = thread->next)
+   {
+      epoch = (uintptr_t) _mulle_atomic_pointer_read( &thread->epoch);
+      if( epoch && epoch < oldest)
+         oldest = epoch;
+   }
+
+   keep = NULL;
+   last = NULL;
+   for( node = _mulle_concurrent_reclaim_take( p); node; node = next)
+   {
+      next = node->next;
+      if( node->epoch <= oldest)
+      {
+         _mulle_concurrent_reclaim_free_node( p, node);
+         continue;
+      }
+
+      if( ! last)
+         last = node;
+      node->next = keep;
+      keep       = node;
+   }
+
+   if( keep)
+      _mulle_concurrent_reclaim_push( p, keep, last);
+
+   _mulle_concurrent_reclaim_unlock( p);
+}
+
+
+#pragma mark -
+#pragma mark single-threaded
+
+int   mulle_concurrent_reclaim_init( struct mulle_concurrent_reclaim *p,
+                                     struct mulle_allocator *allocator)
+{
+   if( ! p)
+      return( EINVAL);
+
+   if( ! allocator)
+      allocator = &mulle_default_allocator;
+
+   _mulle_atomic_pointer_nonatomic_write( &p->epoch, (void *) 1);
+   _mulle_atomic_pointer_nonatomic_write( &p->retired, NULL);
+   _mulle_atomic_pointer_nonatomic_write( &p->lock, NULL);
+   p->threads    = NULL;
+   p->allocator  = allocator;
+   p->allocators = NULL;
+
+   return( 0);
+}
+
+
+void   mulle_concurrent_reclaim_done( struct mulle_concurrent_reclaim *p)
+{
+   struct _mulle_concurrent_reclaimnode        *node;
+   struct _mulle_concurrent_reclaimnode        *next;
+   struct _mulle_concurrent_reclaimallocator   *entry;
+   struct _mulle_concurrent_reclaimallocator   *next_entry;
+
+   if( ! p)
+      return;
+
+   assert( ! p->threads);
+
+   for( node = _mulle_concurrent_reclaim_take( p); node; node = next)
+   {
+      next = node->next;
+      _mulle_concurrent_reclaim_free_node( p, node);
+   }
+
+   // the freed storages may have gone into the pool
+   for( entry = p->allocators; entry; entry = next_entry)
+   {
+      next_entry = entry->next;
+      mulle_concurrent_storagepool_drain_allocator( entry->allocator);
+      _mulle_allocator_free( p->allocator, entry);
+   }
+   p->allocators = NULL;
+}
+
+
+int   mulle_concurrent_reclaim_init_allocator( struct mulle_concurrent_reclaim *p,
+                                               struct mulle_allocator *dst,
+                                               struct mulle_allocator *allocator)
+{
+   struct _mulle_concurrent_reclaimallocator   *entry;
+
+   if( ! p || ! dst)
+      return( EINVAL);
+
+   if( ! allocator)
+      allocator = &mulle_default_allocator;
+
+   for( entry = p->allocators; entry; entry = entry->next)
+      if( entry->allocator == dst)
+         break;
+
+   if( ! entry)
+   {
+      entry = _mulle_allocator_calloc( p->allocator, 1, sizeof( *entry));
+      if( ! entry)
+         return( ENOMEM);
+
+      entry->allocator = dst;
+      entry->next      = p->allocators;
+      p->allocators    = entry;
+   }
+
+   *dst         = *allocator;
+   dst->abafree = _mulle_concurrent_reclaim_retire;
+   dst->aba     = p;
+
+   return( 0);
+}
+
+
+#pragma mark -
+#pragma mark multi-threaded
+
+int   _mulle_concurrent_reclaim_retire( void *reclaim,
+                                        void (*free)( void *),
+                                        void *block)
+{
+   struct mulle_concurrent_reclaim        *p;
+   struct _mulle_concurrent_reclaimnode   *node;
+
+   if( ! block)
+      return( 0);
+
+   p    = reclaim;
+   node = _mulle_allocator_calloc( p->allocator, 1, sizeof( *node));
+   if( ! node)
+      return( ENOMEM);  // leak it, better than freeing it too early
+
+   node->free  = free;
+   node->block = block;
+
+   // the block is unreachable, before it gets its stamp
+   node->epoch = _mulle_concurrent_reclaim_next_epoch( p);
+   _mulle_concurrent_reclaim_push( p, node, node);
+
+   _mulle_concurrent_reclaim_collect( p);
+   return( 0);
+}
+
+
+void   mulle_concurrent_reclaim_register( struct mulle_concurrent_reclaim *p,
+                                          struct mulle_concurrent_reclaimthread *thread)
+{
+   if( ! p || ! thread)
+      return;
+
+   _mulle_atomic_pointer_write( &thread->epoch,
+                                (void *) _mulle_concurrent_reclaim_get_epoch( p));
+
+   _mulle_concurrent_reclaim_lock( p);
+   thread->next = p->threads;
+   p->threads   = thread;
+   _mulle_concurrent_reclaim_unlock( p);
+}
+
+
+void   mulle_concurrent_reclaim_unregister( struct mulle_concurrent_reclaim *p,
+                                            struct mulle_concurrent_reclaimthread *thread)
+{
+   struct mulle_concurrent_reclaimthread   **q;
+
+   if( ! p || ! thread)
+      return;
+
+   _mulle_concurrent_reclaim_lock( p);
+   for( q = &p->threads; *q; q = &(*q)->next)
+      if( *q == thread)
+      {
+         *q = thread->next;
+         break;
+      }
+   _mulle_concurrent_reclaim_unlock( p);
+
+   _mulle_atomic_pointer_write( &thread->epoch, NULL);
+   _mulle_concurrent_reclaim_collect( p);
+}
+
+
+void   mulle_concurrent_reclaim_quiescent( struct mulle_concurrent_reclaim *p,
+                                           struct mulle_concurrent_reclaimthread *thread)
+{
+   if( ! p || ! thread)
+      return;
+
+   assert( _mulle_atomic_pointer_read( &thread->epoch) && "thread is offline");
+
+   _mulle_atomic_pointer_write( &thread->epoch,
+                                (void *) _mulle_concurrent_reclaim_get_epoch( p));
+   _mulle_concurrent_reclaim_collect( p);
+}
+
+
+void   mulle_concurrent_reclaim_offline( struct mulle_concurrent_reclaim *p,
+                                         struct mulle_concurrent_reclaimthread *thread)
+{
+   if( ! p || ! thread)
+      return;
+
+   _mulle_atomic_pointer_write( &thread->epoch, NULL);
+   _mulle_concurrent_reclaim_collect( p);
+}
+
+
+void   mulle_concurrent_reclaim_online( struct mulle_concurrent_reclaim *p,
+                                        struct mulle_concurrent_reclaimthread *thread)
+{
+   if( ! p || ! thread)
+      return;
+
+   // the write must be visible, before the thread reads any container
+   _mulle_atomic_pointer_write( &thread->epoch,
+                                (void *) _mulle_concurrent_reclaim_get_epoch( p));
+}
@@ -0,0 +1,144 @@
+//
+//  mulle_concurrent_reclaim.h
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#ifndef mulle_concurrent_reclaim_h__
+#define mulle_concurrent_reclaim_h__
+
+#include <mulle_thread/mulle_thread.h>
+#include <mulle_allocator/mulle_allocator.h>
+
+
+//
+// An alternative to mulle_aba for freeing container storages. The
+// containers retire old storage through the abafree function of their
+// allocator. mulle_concurrent_reclaim_init_allocator makes an allocator,
+// that retires into a mulle_concurrent_reclaim instead.
+//
+// Every thread that accesses a container using such an allocator, must be
+// registered with the mulle_concurrent_reclaim. A retired block is freed,
+// once all registered threads, that are online, have passed a quiescent
+// state after it was retired. There are two ways to use it:
+//
+// QSBR : threads stay online and call mulle_concurrent_reclaim_quiescent,
+//        when they hold no pointers into containers, e.g. once per event
+//        loop iteration. This is the cheapest.
+// EBR  : threads bracket their container accesses with
+//        mulle_concurrent_reclaim_enter and mulle_concurrent_reclaim_leave,
+//        and are offline otherwise.
+//
+struct mulle_concurrent_reclaimthread
+{
+   mulle_atomic_pointer_t                  epoch;    // 0: offline
+   struct mulle_concurrent_reclaimthread   *next;
+};
+
+
+struct _mulle_concurrent_reclaimallocator;
+
+
+struct mulle_concurrent_reclaim
+{
+   mulle_atomic_pointer_t                      epoch;
+   mulle_atomic_pointer_t                      retired;
+   mulle_atomic_pointer_t                      lock;
+   struct mulle_concurrent_reclaimthread       *threads;
+   struct mulle_allocator                      *allocator;
+   struct _mulle_concurrent_reclaimallocator   *allocators;  // init_allocator
+};
+
+
+#pragma mark -
+#pragma mark single-threaded
+
+// allocator is used for the bookkeeping of retired blocks
+int    mulle_concurrent_reclaim_init( struct mulle_concurrent_reclaim *reclaim,
+                                      struct mulle_allocator *allocator);
+
+//
+// frees all retired blocks, no thread may access the containers anymore.
+// Afterwards the storagepool has no blocks of the allocators made by
+// mulle_concurrent_reclaim_init_allocator anymore, so they can go away.
+//
+void   mulle_concurrent_reclaim_done( struct mulle_concurrent_reclaim *reclaim);
+
+//
+// copies `allocator` into `dst` and routes its abafree into `reclaim`.
+// Use `dst` for the containers. `dst` must stay valid until
+// mulle_concurrent_reclaim_done.
+//
+int    mulle_concurrent_reclaim_init_allocator( struct mulle_concurrent_reclaim *reclaim,
+                                                struct mulle_allocator *dst,
+                                                struct mulle_allocator *allocator);
+
+
+#pragma mark -
+#pragma mark multi-threaded
+
+// thread is online after registration
+void   mulle_concurrent_reclaim_register( struct mulle_concurrent_reclaim *reclaim,
+                                          struct mulle_concurrent_reclaimthread *thread);
+void   mulle_concurrent_reclaim_unregister( struct mulle_concurrent_reclaim *reclaim,
+                                            struct mulle_concurrent_reclaimthread *thread);
+
+// QSBR
+void   mulle_concurrent_reclaim_quiescent( struct mulle_concurrent_reclaim *reclaim,
+                                           struct mulle_concurrent_reclaimthread *thread);
+void   mulle_concurrent_reclaim_offline( struct mulle_concurrent_reclaim *reclaim,
+                                         struct mulle_concurrent_reclaimthread *thread);
+void   mulle_concurrent_reclaim_online( struct mulle_concurrent_reclaim *reclaim,
+                                        struct mulle_concurrent_reclaimthread *thread);
+
+// EBR
+static inline void   mulle_concurrent_reclaim_enter( struct mulle_concurrent_reclaim *reclaim,
+                                                     struct mulle_concurrent_reclaimthread *thread)
+{
+   mulle_concurrent_reclaim_online( reclaim, thread);
+}
+
+
+static inline void   mulle_concurrent_reclaim_leave( struct mulle_concurrent_reclaim *reclaim,
+                                                     struct mulle_concurrent_reclaimthread *thread)
+{
+   mulle_concurrent_reclaim_offline( reclaim, thread);
+}
+
+
+//
+// has the signature of the abafree function of mulle_allocator, with
+// `reclaim` as the aba
+//
+int   _mulle_concurrent_reclaim_retire( void *reclaim,
+                                        void (*free)( void *),
+                                        void *block);
+
+#endif /* mulle_concurrent_reclaim_h */
@@ -0,0 +1,106 @@
+//
+//  mulle_concurrent_migrationhook.c
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#include "mulle_concurrent_migrationhook.h"
+
+#include <mulle_thread/mulle_thread.h>
+#include <time.h>
+
+
+static struct
+{
+   mulle_atomic_pointer_t   hook;
+   mulle_atomic_pointer_t   userinfo;
+} migration;
+
+
+void   mulle_concurrent_set_migrationhook( mulle_concurrent_migrationhook_t *hook,
+                                           void *userinfo)
+{
+   _mulle_atomic_pointer_write( &migration.userinfo, userinfo);
+   _mulle_atomic_pointer_write( &migration.hook, (void *) hook);
+}
+
+
+mulle_concurrent_migrationhook_t   *mulle_concurrent_get_migrationhook( void **userinfo)
+{
+   mulle_concurrent_migrationhook_t   *hook;
+
+   // read in the opposite order of set
+   hook = (mulle_concurrent_migrationhook_t *) _mulle_atomic_pointer_read( &migration.hook);
+   if( userinfo)
+      *userinfo = _mulle_atomic_pointer_read( &migration.userinfo);
+   return( hook);
+}
+
+
+uint64_t   mulle_concurrent_timestamp( void)
+{
+#if defined( CLOCK_MONOTONIC)
+   struct timespec   ts;
+
+   if( clock_gettime( CLOCK_MONOTONIC, &ts))
+      return( 0);
+   return( (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec);
+#elif defined( TIME_UTC)
+   struct timespec   ts;
+
+   if( ! timespec_get( &ts, TIME_UTC))
+      return( 0);
+   return( (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec);
+#else
+   return( 0);
+#endif
+}
+
+
+int   _mulle_concurrent_migrationhook_is_set( void)
+{
+   return( _mulle_atomic_pointer_read( &migration.hook) != NULL);
+}
+
+
+void   _mulle_concurrent_migrationhook_call( struct mulle_concurrent_migrationevent *event,
+                                             unsigned int type)
+{
+   mulle_concurrent_migrationhook_t   *hook;
+   void                               *userinfo;
+
+   hook = mulle_concurrent_get_migrationhook( &userinfo);
+   if( ! hook)
+      return;
+
+   event->type      = type;
+   event->timestamp = mulle_concurrent_timestamp();
+   (*hook)( event, userinfo);
+}
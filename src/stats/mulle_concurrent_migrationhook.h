@@ -0,0 +1,106 @@
+//
+//  mulle_concurrent_migrationhook.h
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#ifndef mulle_concurrent_migrationhook_h__
+#define mulle_concurrent_migrationhook_h__
+
+#include "mulle_concurrent_stats.h"
+
+#include <stdint.h>
+
+
+//
+// A process wide hook, that is called when a container migrates to a new
+// storage. Use it to correlate stalls of inserts and adds with migrations.
+//
+// STARTED is sent by the thread that created the new storage.
+// COPIED is sent by every thread, that took part in the copying, when it
+// is done with it.
+// SWAPPED is sent by the thread, that made the new storage current.
+//
+// The hook is called by the migrating threads, while they are in the
+// middle of an insert or add. Keep it short and don't call back into the
+// container.
+//
+enum
+{
+   MULLE_CONCURRENT_MIGRATION_STARTED,
+   MULLE_CONCURRENT_MIGRATION_COPIED,
+   MULLE_CONCURRENT_MIGRATION_SWAPPED
+};
+
+
+struct mulle_concurrent_migrationevent
+{
+   unsigned int   type;        // MULLE_CONCURRENT_MIGRATION_STARTED...
+   unsigned int   container;   // MULLE_CONCURRENT_STATS_HASHMAP...
+   void           *object;     // the hashmap or pointerarray
+   uintptr_t      old_size;
+   uintptr_t      new_size;
+   uintptr_t      n_copied;    // entries copied by this thread, 0 for STARTED
+   uint64_t       start;       // ns, when this thread entered the migration
+   uint64_t       timestamp;   // ns, when the event happened
+};
+
+
+typedef void   mulle_concurrent_migrationhook_t( struct mulle_concurrent_migrationevent *event,
+                                                 void *userinfo);
+
+
+#pragma mark -
+#pragma mark multi-threaded
+
+//
+// Set hook to NULL to turn it off. Changing the userinfo of a hook, while
+// containers are migrating, may pass the old userinfo to the new hook.
+// Turn the hook off first.
+//
+void   mulle_concurrent_set_migrationhook( mulle_concurrent_migrationhook_t *hook,
+                                           void *userinfo);
+mulle_concurrent_migrationhook_t   *mulle_concurrent_get_migrationhook( void **userinfo);
+
+
+// nanoseconds of a monotonic clock, 0 if there is none
+uint64_t   mulle_concurrent_timestamp( void);
+
+
+#pragma mark -
+#pragma mark used by the containers, no parameter checks
+
+int    _mulle_concurrent_migrationhook_is_set( void);
+
+// sets type and timestamp of event and calls the hook, if there is one
+void   _mulle_concurrent_migrationhook_call( struct mulle_concurrent_migrationevent *event,
+                                             unsigned int type);
+
+#endif /* mulle_concurrent_migrationhook_h */
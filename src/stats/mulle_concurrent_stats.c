@@ -0,0 +1,206 @@
+//
+//  mulle_concurrent_stats.c
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#include "mulle_concurrent_stats.h"
+
+#include <mulle_thread/mulle_thread.h>
+#include <errno.h>
+#include <string.h>
+
+
+#ifdef MULLE_CONCURRENT_STATS
+
+#if defined( _MSC_VER)
+# define THREAD_LOCAL   __declspec( thread)
+#elif defined( __STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+# define THREAD_LOCAL   _Thread_local
+#else
+# define THREAD_LOCAL   __thread
+#endif
+
+
+//
+// Each thread has its counters in thread local storage, so counting is
+// just an increment. When a thread counts for the first time, its counters
+// are linked into a list, so that they can be summed up. When it exits,
+// the counters are added to 'retired' and unlinked again.
+//
+struct _mulle_concurrent_threadstats
+{
+   struct _mulle_concurrent_threadstats   *next;
+   int                                    registered;
+   uint64_t                               counters[ MULLE_CONCURRENT_STATS_N_CONTAINERS][ MULLE_CONCURRENT_STATS_N_COUNTERS];
+};
+
+
+static THREAD_LOCAL struct _mulle_concurrent_threadstats   threadstats;
+
+
+static struct
+{
+   mulle_atomic_pointer_t                 lock;
+   struct _mulle_concurrent_threadstats   *threads;
+   uint64_t                               retired[ MULLE_CONCURRENT_STATS_N_CONTAINERS][ MULLE_CONCURRENT_STATS_N_COUNTERS];
+   mulle_thread_tss_t                     key;
+   int                                    has_key;
+} stats;
+
+
+// the owning thread writes, any thread may read
+static inline uint64_t   _mulle_concurrent_stats_read( uint64_t *p)
+{
+#ifdef __ATOMIC_RELAXED
+   return( __atomic_load_n( p, __ATOMIC_RELAXED));
+#else
+   return( *(volatile uint64_t *) p);
+#endif
+}
+
+
+static inline void   _mulle_concurrent_stats_write( uint64_t *p, uint64_t value)
+{
+#ifdef __ATOMIC_RELAXED
+   __atomic_store_n( p, value, __ATOMIC_RELAXED);
+#else
+   *(volatile uint64_t *) p = value;
+#endif
+}
+
+
+static void   _mulle_concurrent_stats_lock( void)
+{
+   while( ! _mulle_atomic_pointer_compare_and_swap( &stats.lock, (void *) 1, NULL))
+      mulle_thread_yield();
+}
+
+
+static void   _mulle_concurrent_stats_unlock( void)
+{
+   _mulle_atomic_pointer_write( &stats.lock, NULL);
+}
+
+
+static void   _mulle_concurrent_threadstats_retire( void *p)
+{
+   struct _mulle_concurrent_threadstats   *thread;
+   struct _mulle_concurrent_threadstats   **q;
+   unsigned int                           i;
+   unsigned int                           j;
+
+   thread = p;
+
+   _mulle_concurrent_stats_lock();
+   for( q = &stats.threads; *q; q = &(*q)->next)
+      if( *q == thread)
+      {
+         *q = thread->next;
+         break;
+      }
+
+   for( i = 0; i < MULLE_CONCURRENT_STATS_N_CONTAINERS; i++)
+      for( j = 0; j < MULLE_CONCURRENT_STATS_N_COUNTERS; j++)
+         stats.retired[ i][ j] += thread->counters[ i][ j];
+   _mulle_concurrent_stats_unlock();
+}
+
+
+static void   _mulle_concurrent_threadstats_register( struct _mulle_concurrent_threadstats *thread)
+{
+   _mulle_concurrent_stats_lock();
+   if( ! stats.has_key)
+      stats.has_key = ! mulle_thread_tss_create( _mulle_concurrent_threadstats_retire, &stats.key);
+
+   // without the key the counters of this thread are lost, when it exits
+   if( stats.has_key)
+      mulle_thread_tss_set( stats.key, thread);
+
+   thread->next       = stats.threads;
+   thread->registered = 1;
+   stats.threads      = thread;
+   _mulle_concurrent_stats_unlock();
+}
+
+
+void   _mulle_concurrent_stats_add( unsigned int container,
+                                    unsigned int counter,
+                                    uint64_t n)
+{
+   struct _mulle_concurrent_threadstats   *thread;
+   uint64_t                               *p;
+
+   thread = &threadstats;
+   if( ! thread->registered)
+      _mulle_concurrent_threadstats_register( thread);
+
+   p = &thread->counters[ container][ counter];
+   _mulle_concurrent_stats_write( p, *p + n);
+}
+
+
+int   _mulle_concurrent_stats_get( unsigned int container,
+                                   struct mulle_concurrent_stats *p)
+{
+   struct _mulle_concurrent_threadstats   *thread;
+   uint64_t                               sum[ MULLE_CONCURRENT_STATS_N_COUNTERS];
+   unsigned int                           j;
+
+   _mulle_concurrent_stats_lock();
+   for( j = 0; j < MULLE_CONCURRENT_STATS_N_COUNTERS; j++)
+      sum[ j] = stats.retired[ container][ j];
+   for( thread = stats.threads; thread; thread = thread->next)
+      for( j = 0; j < MULLE_CONCURRENT_STATS_N_COUNTERS; j++)
+         sum[ j] += _mulle_concurrent_stats_read( &thread->counters[ container][ j]);
+   _mulle_concurrent_stats_unlock();
+
+   p->lookups            = sum[ MULLE_CONCURRENT_STATS_LOOKUPS];
+   p->inserts            = sum[ MULLE_CONCURRENT_STATS_INSERTS];
+   p->eexists            = sum[ MULLE_CONCURRENT_STATS_EEXISTS];
+   p->retries            = sum[ MULLE_CONCURRENT_STATS_RETRIES];
+   p->migrations_started = sum[ MULLE_CONCURRENT_STATS_MIGRATIONS_STARTED];
+   p->migrations_joined  = sum[ MULLE_CONCURRENT_STATS_MIGRATIONS_JOINED];
+   p->entries_copied     = sum[ MULLE_CONCURRENT_STATS_ENTRIES_COPIED];
+   p->probe_steps        = sum[ MULLE_CONCURRENT_STATS_PROBE_STEPS];
+
+   return( 0);
+}
+
+#else
+
+int   _mulle_concurrent_stats_get( unsigned int container,
+                                   struct mulle_concurrent_stats *p)
+{
+   memset( p, 0, sizeof( *p));
+   return( ENOSYS);
+}
+
+#endif
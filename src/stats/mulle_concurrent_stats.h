@@ -0,0 +1,112 @@
+//
+//  mulle_concurrent_stats.h
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#ifndef mulle_concurrent_stats_h__
+#define mulle_concurrent_stats_h__
+
+#include <stdint.h>
+
+
+//
+// Counters of the internals of the containers. They are only kept, if
+// the library is compiled with MULLE_CONCURRENT_STATS, otherwise all the
+// counting compiles to nothing. Every thread counts for itself, the
+// counters are summed up when asked for. The counters are process wide,
+// not per container. Use mulle_concurrent_hashmap_get_stats and
+// mulle_concurrent_pointerarray_get_stats to read them.
+//
+struct mulle_concurrent_stats
+{
+   uint64_t   lookups;              // lookup, get
+   uint64_t   inserts;              // insert, add
+   uint64_t   eexists;              // inserts that returned EEXIST
+   uint64_t   retries;              // operations redone on a migrated storage
+   uint64_t   migrations_started;   // migrations this process started
+   uint64_t   migrations_joined;    // times a thread helped with a migration
+   uint64_t   entries_copied;       // entries copied during migrations
+   uint64_t   probe_steps;          // entries looked at past the first
+};
+
+
+// the containers, that keep counters
+enum
+{
+   MULLE_CONCURRENT_STATS_HASHMAP,
+   MULLE_CONCURRENT_STATS_POINTERARRAY,
+   MULLE_CONCURRENT_STATS_N_CONTAINERS
+};
+
+
+// the counters in the order of struct mulle_concurrent_stats
+enum
+{
+   MULLE_CONCURRENT_STATS_LOOKUPS,
+   MULLE_CONCURRENT_STATS_INSERTS,
+   MULLE_CONCURRENT_STATS_EEXISTS,
+   MULLE_CONCURRENT_STATS_RETRIES,
+   MULLE_CONCURRENT_STATS_MIGRATIONS_STARTED,
+   MULLE_CONCURRENT_STATS_MIGRATIONS_JOINED,
+   MULLE_CONCURRENT_STATS_ENTRIES_COPIED,
+   MULLE_CONCURRENT_STATS_PROBE_STEPS,
+   MULLE_CONCURRENT_STATS_N_COUNTERS
+};
+
+
+//
+// Returns:
+//   0      : OK
+//   ENOSYS : compiled without MULLE_CONCURRENT_STATS, stats is zeroed
+//
+int   _mulle_concurrent_stats_get( unsigned int container,
+                                   struct mulle_concurrent_stats *stats);
+
+
+#ifdef MULLE_CONCURRENT_STATS
+
+void   _mulle_concurrent_stats_add( unsigned int container,
+                                    unsigned int counter,
+                                    uint64_t n);
+
+# define MULLE_CONCURRENT_STATS_ADD( container, counter, n) \
+   _mulle_concurrent_stats_add( MULLE_CONCURRENT_STATS_ ## container, MULLE_CONCURRENT_STATS_ ## counter, (n))
+
+#else
+
+# define MULLE_CONCURRENT_STATS_ADD( container, counter, n)   ((void) 0)
+
+#endif
+
+#define MULLE_CONCURRENT_STATS_COUNT( container, counter) \
+   MULLE_CONCURRENT_STATS_ADD( container, counter, 1)
+
+#endif /* mulle_concurrent_stats_h */
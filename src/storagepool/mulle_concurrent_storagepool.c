@@ -0,0 +1,404 @@
+//
+//  mulle_concurrent_storagepool.c
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#include "mulle_concurrent_storagepool.h"
+
+#include "mulle_concurrent_types.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#if ! defined( MULLE_CONCURRENT_NO_MMAP) && (defined( __linux__) || defined( __APPLE__) || defined( __FreeBSD__))
+# define HAVE_MMAP
+# include <sys/mman.h>
+# if ! defined( MAP_ANONYMOUS) && defined( MAP_ANON)
+#  define MAP_ANONYMOUS   MAP_ANON
+# endif
+# ifndef MAP_ANONYMOUS
+#  undef HAVE_MMAP
+# endif
+#endif
+
+
+//
+// every block is preceeded by a header, so that the ABA free callback, which
+// only gets the block, knows where the block came from. mapped is the length
+// of the mapping for a block from mmap, otherwise 0. offset is the distance
+// from the start of the allocation (or mapping) to the header.
+//
+// allocator must be last, see _mulle_concurrent_storagepool_is_owned
+//
+struct _mulle_concurrent_storagepoolheader
+{
+   size_t                   size;
+   size_t                   mapped;
+   size_t                   offset;    // also keeps the block 16 byte aligned
+   struct mulle_allocator   *allocator;
+};
+
+
+//
+// with MULLE_CONCURRENT_CACHELINE_LAYOUT blocks start on a cache line, so
+// that the aligned fields of the storages are aligned in memory too
+//
+#ifdef MULLE_CONCURRENT_CACHELINE_LAYOUT
+# define BLOCK_ALIGNMENT   MULLE_CONCURRENT_CACHELINE_SIZE
+#else
+# define BLOCK_ALIGNMENT   0
+#endif
+
+
+static struct _mulle_concurrent_storagepoolheader  *
+   _mulle_concurrent_storagepoolheader_place( void *p)
+{
+   struct _mulle_concurrent_storagepoolheader   *header;
+   uintptr_t                                    block;
+
+   block = (uintptr_t) p + sizeof( *header);
+#if BLOCK_ALIGNMENT
+   block = (block + BLOCK_ALIGNMENT - 1) & ~(uintptr_t) (BLOCK_ALIGNMENT - 1);
+#endif
+   header         = &((struct _mulle_concurrent_storagepoolheader *) block)[ -1];
+   header->offset = (char *) header - (char *) p;
+   return( header);
+}
+
+
+static inline void   *
+   _mulle_concurrent_storagepoolheader_get_base( struct _mulle_concurrent_storagepoolheader *header)
+{
+   return( (char *) header - header->offset);
+}
+
+
+//
+// storage that lives inside its container (e.g. the inline storage of a
+// mulle_concurrent_inlinehashmap) is preceeded by a NULL pointer instead of
+// a header. It's never freed
+//
+static inline int   _mulle_concurrent_storagepool_is_owned( void *block)
+{
+   return( ((struct mulle_allocator **) block)[ -1] != NULL);
+}
+
+
+//
+// blocks of mmap_threshold bytes and more are mapped. Huge pages are tried
+// first, then normal pages with a hint to use transparent huge pages. The
+// kernel hands out zeroed pages on first touch, so these blocks don't have
+// to be cleared. They don't go into the pool, as they would need clearing
+// then.
+//
+#ifdef HAVE_MMAP
+static size_t   mmap_threshold = MULLE_CONCURRENT_STORAGEPOOL_MMAP_THRESHOLD;
+#else
+static size_t   mmap_threshold;
+#endif
+
+#define HUGEPAGE_SIZE   (2 * 1024 * 1024)
+
+
+#define N_SIZE_CLASSES   (sizeof( size_t) * 8)
+
+
+//
+// each size class has a fixed number of slots. A block is put into the pool
+// by CASing it into an empty slot, and taken out by CASing the slot back to
+// NULL. A slot only ever holds the whole state, so there is no ABA problem
+// and no thread can hold up another one.
+//
+static struct
+{
+   mulle_atomic_pointer_t   capacity;
+   mulle_atomic_pointer_t   slots[ N_SIZE_CLASSES][ MULLE_CONCURRENT_STORAGEPOOL_MAX_CAPACITY];
+} pool;
+
+
+static unsigned int   _mulle_concurrent_storagepool_size_class( size_t size)
+{
+   unsigned int   i;
+
+   for( i = 0; size >>= 1; i++);
+   return( i);
+}
+
+
+#ifdef HAVE_MMAP
+
+static void   *_mulle_concurrent_storagepool_mmap( size_t length)
+{
+   void   *p;
+
+# ifdef MAP_HUGETLB
+   p = mmap( NULL, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+   if( p != MAP_FAILED)
+      return( p);
+# endif
+
+   p = mmap( NULL, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+   if( p == MAP_FAILED)
+      return( NULL);
+
+# ifdef MADV_HUGEPAGE
+   madvise( p, length, MADV_HUGEPAGE);
+# endif
+   return( p);
+}
+
+#endif
+
+
+static unsigned int   _mulle_concurrent_storagepool_get_capacity( void)
+{
+   return( (unsigned int) (uintptr_t) _mulle_atomic_pointer_read( &pool.capacity));
+}
+
+
+static void   _mulle_concurrent_storagepoolheader_free( struct _mulle_concurrent_storagepoolheader *header)
+{
+   _mulle_allocator_free( header->allocator, _mulle_concurrent_storagepoolheader_get_base( header));
+}
+
+
+//
+// only the thread, that emptied a slot, owns the block, so the header
+// isn't looked at before that
+//
+static struct _mulle_concurrent_storagepoolheader  *
+   _mulle_concurrent_storagepool_take( mulle_atomic_pointer_t *slot)
+{
+   struct _mulle_concurrent_storagepoolheader   *header;
+
+   header = _mulle_atomic_pointer_read( slot);
+   if( header && _mulle_atomic_pointer_compare_and_swap( slot, NULL, header))
+      return( header);
+   return( NULL);
+}
+
+
+// returns 0, if the pool is full
+static int   _mulle_concurrent_storagepool_put( struct _mulle_concurrent_storagepoolheader *header,
+                                                unsigned int capacity)
+{
+   mulle_atomic_pointer_t   *slot;
+   mulle_atomic_pointer_t   *sentinel;
+
+   slot     = pool.slots[ _mulle_concurrent_storagepool_size_class( header->size)];
+   sentinel = &slot[ capacity];
+   for( ; slot < sentinel; slot++)
+      if( ! _mulle_atomic_pointer_read( slot) &&
+          _mulle_atomic_pointer_compare_and_swap( slot, header, NULL))
+         return( 1);
+   return( 0);
+}
+
+
+void   *_mulle_concurrent_storagepool_calloc( size_t size,
+                                              struct mulle_allocator *allocator)
+{
+   struct _mulle_concurrent_storagepoolheader   *header;
+   mulle_atomic_pointer_t                       *slot;
+   mulle_atomic_pointer_t                       *sentinel;
+   unsigned int                                 capacity;
+   void                                         *p;
+
+#ifdef HAVE_MMAP
+   if( mmap_threshold && size >= mmap_threshold)
+   {
+      size_t   length;
+
+      length = (sizeof( *header) + BLOCK_ALIGNMENT + size + HUGEPAGE_SIZE - 1) & ~(size_t) (HUGEPAGE_SIZE - 1);
+      p      = _mulle_concurrent_storagepool_mmap( length);
+      if( p)
+      {
+         header            = _mulle_concurrent_storagepoolheader_place( p);
+         header->allocator = allocator;
+         header->size      = size;
+         header->mapped    = length;
+         return( &header[ 1]);
+      }
+      // try the allocator then
+   }
+#endif
+
+   capacity = _mulle_concurrent_storagepool_get_capacity();
+   if( capacity)
+   {
+      slot     = pool.slots[ _mulle_concurrent_storagepool_size_class( size)];
+      sentinel = &slot[ capacity];
+      for( ; slot < sentinel; slot++)
+      {
+         header = _mulle_concurrent_storagepool_take( slot);
+         if( ! header)
+            continue;
+
+         if( header->size == size && header->allocator == allocator)
+         {
+            memset( &header[ 1], 0, size);
+            return( &header[ 1]);
+         }
+
+         // not ours, a different size in the same class or allocator
+         if( ! _mulle_concurrent_storagepool_put( header, capacity))
+            _mulle_concurrent_storagepoolheader_free( header);
+      }
+   }
+
+   p = _mulle_allocator_calloc( allocator, 1, sizeof( *header) + BLOCK_ALIGNMENT + size);
+   if( ! p)
+      return( NULL);
+
+   header            = _mulle_concurrent_storagepoolheader_place( p);
+   header->allocator = allocator;
+   header->size      = size;
+   header->mapped    = 0;
+   return( &header[ 1]);
+}
+
+
+void   _mulle_concurrent_storagepool_free( void *block)
+{
+   struct _mulle_concurrent_storagepoolheader   *header;
+   unsigned int                                 capacity;
+
+   if( ! block || ! _mulle_concurrent_storagepool_is_owned( block))
+      return;
+
+   header = &((struct _mulle_concurrent_storagepoolheader *) block)[ -1];
+
+#ifdef HAVE_MMAP
+   if( header->mapped)
+   {
+      munmap( _mulle_concurrent_storagepoolheader_get_base( header), header->mapped);
+      return;
+   }
+#endif
+
+   capacity = _mulle_concurrent_storagepool_get_capacity();
+   if( capacity && _mulle_concurrent_storagepool_put( header, capacity))
+      return;
+
+   _mulle_concurrent_storagepoolheader_free( header);
+}
+
+
+int   _mulle_concurrent_storagepool_abafree( void *block)
+{
+   struct _mulle_concurrent_storagepoolheader   *header;
+   struct mulle_allocator                       *allocator;
+
+   if( ! block || ! _mulle_concurrent_storagepool_is_owned( block))
+      return( 0);
+
+   header    = &((struct _mulle_concurrent_storagepoolheader *) block)[ -1];
+   allocator = header->allocator;
+   return( (*allocator->abafree)( allocator->aba, _mulle_concurrent_storagepool_free, block));
+}
+
+
+void   mulle_concurrent_storagepool_drain( void)
+{
+   struct _mulle_concurrent_storagepoolheader   *header;
+   unsigned int                                 i;
+   unsigned int                                 j;
+
+   for( i = 0; i < N_SIZE_CLASSES; i++)
+      for( j = 0; j < MULLE_CONCURRENT_STORAGEPOOL_MAX_CAPACITY; j++)
+      {
+         header = _mulle_concurrent_storagepool_take( &pool.slots[ i][ j]);
+         if( header)
+            _mulle_concurrent_storagepoolheader_free( header);
+      }
+}
+
+
+void   mulle_concurrent_storagepool_drain_allocator( struct mulle_allocator *allocator)
+{
+   struct _mulle_concurrent_storagepoolheader   *header;
+   unsigned int                                 capacity;
+   unsigned int                                 i;
+   unsigned int                                 j;
+
+   capacity = _mulle_concurrent_storagepool_get_capacity();
+   for( i = 0; i < N_SIZE_CLASSES; i++)
+      for( j = 0; j < MULLE_CONCURRENT_STORAGEPOOL_MAX_CAPACITY; j++)
+      {
+         header = _mulle_concurrent_storagepool_take( &pool.slots[ i][ j]);
+         if( ! header)
+            continue;
+
+         // only compare the pointer, other allocators are still alive
+         if( header->allocator != allocator &&
+             _mulle_concurrent_storagepool_put( header, capacity))
+            continue;
+
+         _mulle_concurrent_storagepoolheader_free( header);
+      }
+}
+
+
+void   mulle_concurrent_storagepool_set_capacity( unsigned int capacity)
+{
+   unsigned int   old;
+
+   if( capacity > MULLE_CONCURRENT_STORAGEPOOL_MAX_CAPACITY)
+      capacity = MULLE_CONCURRENT_STORAGEPOOL_MAX_CAPACITY;
+
+   old = _mulle_concurrent_storagepool_get_capacity();
+   _mulle_atomic_pointer_write( &pool.capacity, (void *) (uintptr_t) capacity);
+
+   // simpler than trimming each size class
+   if( capacity < old)
+      mulle_concurrent_storagepool_drain();
+}
+
+
+unsigned int   mulle_concurrent_storagepool_get_capacity( void)
+{
+   return( _mulle_concurrent_storagepool_get_capacity());
+}
+
+
+void   mulle_concurrent_storagepool_set_mmap_threshold( size_t threshold)
+{
+#ifdef HAVE_MMAP
+   mmap_threshold = threshold;
+#endif
+}
+
+
+size_t   mulle_concurrent_storagepool_get_mmap_threshold( void)
+{
+   return( mmap_threshold);
+}
@@ -0,0 +1,110 @@
+//
+//  mulle_concurrent_storagepool.h
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#ifndef mulle_concurrent_storagepool_h__
+#define mulle_concurrent_storagepool_h__
+
+#include <mulle_thread/mulle_thread.h>
+#include <mulle_allocator/mulle_allocator.h>
+#include <stddef.h>
+
+
+//
+// The storagepool keeps storage blocks, that the containers have released
+// after a migration or a done, for reuse by the next container storage of
+// the same size and allocator. This saves the calls to the allocator, when
+// maps are created and destroyed in quick succession or grow and shrink
+// around a threshold.
+//
+// The pool is process wide and keeps blocks per power of two size. The
+// capacity is the maximum number of blocks kept for each size. It's 0
+// by default, which turns the pool off. It's lock-free.
+//
+// A kept block remembers its allocator. So an allocator must not go away,
+// while the pool still has blocks of it. Once all containers using it are
+// done and their storages have been released (e.g. after mulle_aba_done),
+// call mulle_concurrent_storagepool_drain_allocator.
+// mulle_concurrent_reclaim_done does this for the allocators made by
+// mulle_concurrent_reclaim_init_allocator.
+//
+#ifndef MULLE_CONCURRENT_STORAGEPOOL_MAX_CAPACITY
+# define MULLE_CONCURRENT_STORAGEPOOL_MAX_CAPACITY   16
+#endif
+
+
+#pragma mark -
+#pragma mark multi-threaded
+
+// capacity is clamped to MULLE_CONCURRENT_STORAGEPOOL_MAX_CAPACITY
+
+void           mulle_concurrent_storagepool_set_capacity( unsigned int capacity);
+unsigned int   mulle_concurrent_storagepool_get_capacity( void);
+
+// free all blocks kept in the pool
+void           mulle_concurrent_storagepool_drain( void);
+
+// free all blocks of allocator kept in the pool, the allocator is going away
+void           mulle_concurrent_storagepool_drain_allocator( struct mulle_allocator *allocator);
+
+
+//
+// Storages of at least this many bytes are allocated with mmap and huge
+// pages, if the platform has them. 0 (the default) always uses the
+// allocator, so a custom allocator sees all storage allocations. Set this
+// before creating containers, it's not meant to be changed while
+// containers are in use.
+//
+#ifndef MULLE_CONCURRENT_STORAGEPOOL_MMAP_THRESHOLD
+# define MULLE_CONCURRENT_STORAGEPOOL_MMAP_THRESHOLD   0
+#endif
+
+void     mulle_concurrent_storagepool_set_mmap_threshold( size_t threshold);
+size_t   mulle_concurrent_storagepool_get_mmap_threshold( void);
+
+
+#pragma mark -
+#pragma mark used by the containers, no parameter checks
+
+//
+// calloc returns a zeroed block of size bytes. free and abafree take back
+// blocks returned by calloc. Blocks that are preceeded by a NULL pointer
+// are not owned by the pool, free and abafree ignore them. abafree defers
+// the release until no thread can access the block anymore
+// (see _mulle_allocator_abafree).
+//
+void   *_mulle_concurrent_storagepool_calloc( size_t size,
+                                              struct mulle_allocator *allocator);
+void   _mulle_concurrent_storagepool_free( void *block);
+int    _mulle_concurrent_storagepool_abafree( void *block);
+
+#endif /* mulle_concurrent_storagepool_h */
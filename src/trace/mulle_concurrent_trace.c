@@ -0,0 +1,313 @@
+//
+//  mulle_concurrent_trace.c
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#include "mulle_concurrent_trace.h"
+
+#include "mulle_concurrent_migrationhook.h"
+#include <mulle_thread/mulle_thread.h>
+#include <errno.h>
+#include <string.h>
+
+
+#ifdef MULLE_CONCURRENT_TRACE
+
+#if defined( _MSC_VER)
+# define THREAD_LOCAL   __declspec( thread)
+#elif defined( __STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+# define THREAD_LOCAL   _Thread_local
+#else
+# define THREAD_LOCAL   __thread
+#endif
+
+
+#define N_BUFFERED   256
+
+
+//
+// the object is kept as a pointer, until the record is written
+//
+struct _mulle_concurrent_traceentry
+{
+   uint64_t       timestamp;
+   uint64_t       key;
+   void           *object;
+   unsigned int   op;
+};
+
+
+//
+// generation is the number of the trace, that the thread number and the
+// entries belong to
+//
+struct _mulle_concurrent_tracebuffer
+{
+   struct _mulle_concurrent_tracebuffer   *next;
+   int                                    registered;
+   uintptr_t                              generation;
+   uint16_t                               thread;
+   unsigned int                           n;
+   struct _mulle_concurrent_traceentry    entries[ N_BUFFERED];
+};
+
+
+static THREAD_LOCAL struct _mulle_concurrent_tracebuffer   tracebuffer;
+
+
+static struct
+{
+   mulle_atomic_pointer_t                 running;
+   mulle_atomic_pointer_t                 lock;
+   FILE                                   *fp;
+   uint64_t                               start;
+   uintptr_t                              generation;
+   unsigned int                           n_threads;
+   unsigned int                           n_objects;
+   void                                   *objects[ MULLE_CONCURRENT_TRACE_MAX_OBJECTS];
+   int                                    error;
+   struct _mulle_concurrent_tracebuffer   *threads;
+   mulle_thread_tss_t                     key;
+   int                                    has_key;
+} trace;
+
+
+static void   _mulle_concurrent_trace_lock( void)
+{
+   while( ! _mulle_atomic_pointer_compare_and_swap( &trace.lock, (void *) 1, NULL))
+      mulle_thread_yield();
+}
+
+
+static void   _mulle_concurrent_trace_unlock( void)
+{
+   _mulle_atomic_pointer_write( &trace.lock, NULL);
+}
+
+
+// must be locked
+static uint16_t   _mulle_concurrent_trace_object_number( void *object)
+{
+   unsigned int   i;
+
+   for( i = 0; i < trace.n_objects; i++)
+      if( trace.objects[ i] == object)
+         return( (uint16_t) i);
+
+   if( trace.n_objects == MULLE_CONCURRENT_TRACE_MAX_OBJECTS)
+      return( MULLE_CONCURRENT_TRACE_MAX_OBJECTS);
+
+   trace.objects[ trace.n_objects] = object;
+   return( (uint16_t) trace.n_objects++);
+}
+
+
+// must be locked
+static void   _mulle_concurrent_tracebuffer_flush( struct _mulle_concurrent_tracebuffer *buffer)
+{
+   struct mulle_concurrent_tracerecord   records[ N_BUFFERED];
+   struct _mulle_concurrent_traceentry   *entry;
+   unsigned int                          i;
+   unsigned int                          n;
+
+   n = buffer->n;
+   if( buffer->generation != trace.generation || ! trace.fp)
+      n = 0;
+   buffer->n = 0;
+
+   for( i = 0; i < n; i++)
+   {
+      entry                   = &buffer->entries[ i];
+      records[ i].timestamp   = entry->timestamp;
+      records[ i].key         = entry->key;
+      records[ i].thread      = buffer->thread;
+      records[ i].object      = _mulle_concurrent_trace_object_number( entry->object);
+      records[ i].op          = (uint16_t) entry->op;
+      records[ i]._reserved   = 0;
+   }
+
+   if( n && fwrite( records, sizeof( records[ 0]), n, trace.fp) != n)
+      trace.error = EIO;
+}
+
+
+static void   _mulle_concurrent_tracebuffer_retire( void *p)
+{
+   struct _mulle_concurrent_tracebuffer   *buffer;
+   struct _mulle_concurrent_tracebuffer   **q;
+
+   buffer = p;
+
+   _mulle_concurrent_trace_lock();
+   _mulle_concurrent_tracebuffer_flush( buffer);
+   for( q = &trace.threads; *q; q = &(*q)->next)
+      if( *q == buffer)
+      {
+         *q = buffer->next;
+         break;
+      }
+   buffer->registered = 0;
+   _mulle_concurrent_trace_unlock();
+}
+
+
+// gives the thread a number in the current trace
+static void   _mulle_concurrent_tracebuffer_register( struct _mulle_concurrent_tracebuffer *buffer)
+{
+   _mulle_concurrent_trace_lock();
+   if( ! buffer->registered)
+   {
+      if( ! trace.has_key)
+         trace.has_key = ! mulle_thread_tss_create( _mulle_concurrent_tracebuffer_retire, &trace.key);
+
+      // without the key the last records of this thread are lost, when it exits
+      if( trace.has_key)
+         mulle_thread_tss_set( trace.key, buffer);
+
+      buffer->next       = trace.threads;
+      buffer->registered = 1;
+      trace.threads      = buffer;
+   }
+
+   buffer->generation = trace.generation;
+   buffer->thread     = (uint16_t) trace.n_threads++;
+   buffer->n          = 0;
+   _mulle_concurrent_trace_unlock();
+}
+
+
+void   _mulle_concurrent_trace_record( unsigned int op, void *object, uint64_t key)
+{
+   struct _mulle_concurrent_tracebuffer   *buffer;
+   struct _mulle_concurrent_traceentry    *entry;
+
+   if( ! _mulle_atomic_pointer_read( &trace.running))
+      return;
+
+   buffer = &tracebuffer;
+   if( buffer->generation != (uintptr_t) _mulle_atomic_pointer_read( &trace.running))
+      _mulle_concurrent_tracebuffer_register( buffer);
+
+   entry            = &buffer->entries[ buffer->n];
+   entry->timestamp = mulle_concurrent_timestamp() - trace.start;
+   entry->key       = key;
+   entry->object    = object;
+   entry->op        = op;
+
+   if( ++buffer->n == N_BUFFERED)
+   {
+      _mulle_concurrent_trace_lock();
+      _mulle_concurrent_tracebuffer_flush( buffer);
+      _mulle_concurrent_trace_unlock();
+   }
+}
+
+
+int   mulle_concurrent_trace_start( FILE *fp)
+{
+   struct mulle_concurrent_traceheader   header;
+
+   if( ! fp)
+      return( EINVAL);
+
+   memset( &header, 0, sizeof( header));
+   strcpy( header.magic, MULLE_CONCURRENT_TRACE_MAGIC);
+   header.version     = MULLE_CONCURRENT_TRACE_VERSION;
+   header.record_size = sizeof( struct mulle_concurrent_tracerecord);
+
+   _mulle_concurrent_trace_lock();
+   if( _mulle_atomic_pointer_read( &trace.running))
+   {
+      _mulle_concurrent_trace_unlock();
+      return( EBUSY);
+   }
+
+   if( fwrite( &header, sizeof( header), 1, fp) != 1)
+   {
+      _mulle_concurrent_trace_unlock();
+      return( EIO);
+   }
+
+   trace.fp        = fp;
+   trace.start     = mulle_concurrent_timestamp();
+   trace.n_threads = 0;
+   trace.n_objects = 0;
+   trace.error     = 0;
+
+   // the generation doubles as the running flag, so it's never 0
+   trace.generation++;
+   _mulle_atomic_pointer_write( &trace.running, (void *) trace.generation);
+   _mulle_concurrent_trace_unlock();
+
+   return( 0);
+}
+
+
+int   mulle_concurrent_trace_stop( void)
+{
+   struct _mulle_concurrent_tracebuffer   *buffer;
+   int                                    rval;
+
+   _mulle_concurrent_trace_lock();
+   if( ! _mulle_atomic_pointer_read( &trace.running))
+   {
+      _mulle_concurrent_trace_unlock();
+      return( EINVAL);
+   }
+   _mulle_atomic_pointer_write( &trace.running, NULL);
+
+   for( buffer = trace.threads; buffer; buffer = buffer->next)
+      _mulle_concurrent_tracebuffer_flush( buffer);
+
+   if( fflush( trace.fp))
+      trace.error = EIO;
+
+   rval     = trace.error;
+   trace.fp = NULL;
+   _mulle_concurrent_trace_unlock();
+
+   return( rval);
+}
+
+#else
+
+int   mulle_concurrent_trace_start( FILE *fp)
+{
+   return( ENOSYS);
+}
+
+
+int   mulle_concurrent_trace_stop( void)
+{
+   return( ENOSYS);
+}
+
+#endif
@@ -0,0 +1,143 @@
+//
+//  mulle_concurrent_trace.h
+//  mulle-concurrent
+//
+//  Copyright © 2026 Nat! for Mulle kybernetiK.
+//  Copyright © 2026 Codeon GmbH.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//  Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//  Neither the name of Mulle kybernetiK nor the names of its contributors
+//  may be used to endorse or promote products derived from this software
+//  without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+#ifndef mulle_concurrent_trace_h__
+#define mulle_concurrent_trace_h__
+
+#include <stdint.h>
+#include <stdio.h>
+
+
+//
+// Records the operations on all hashmaps and pointerarrays into a binary
+// trace file, which benchmark/replay.c can play back. The recorder is
+// only there, if the library is compiled with MULLE_CONCURRENT_TRACE,
+// otherwise the recording compiles to nothing. Even then it costs only a
+// read of a flag per operation, until a trace is started.
+//
+// Each thread records into a buffer of its own, which is written to the
+// file when it's full, when the thread exits and when the trace is stopped.
+// So the records are only ordered per thread. Threads and containers are
+// numbered in the order of their appearance.
+//
+// An indexed pointerarray records the operations on its side index as
+// hashmap operations.
+//
+enum
+{
+   MULLE_CONCURRENT_TRACE_HASHMAP_INSERT = 1,
+   MULLE_CONCURRENT_TRACE_HASHMAP_LOOKUP,
+   MULLE_CONCURRENT_TRACE_HASHMAP_REMOVE,
+   MULLE_CONCURRENT_TRACE_POINTERARRAY_ADD,
+   MULLE_CONCURRENT_TRACE_POINTERARRAY_GET,
+   MULLE_CONCURRENT_TRACE_POINTERARRAY_REMOVE
+};
+
+
+#define MULLE_CONCURRENT_TRACE_MAGIC     "mctrace"
+#define MULLE_CONCURRENT_TRACE_VERSION   1
+
+// more containers are recorded as MULLE_CONCURRENT_TRACE_MAX_OBJECTS
+#define MULLE_CONCURRENT_TRACE_MAX_OBJECTS   1024
+
+
+//
+// The file is a header followed by records, both in the byte order of the
+// recording machine.
+//
+struct mulle_concurrent_traceheader
+{
+   char       magic[ 8];     // MULLE_CONCURRENT_TRACE_MAGIC
+   uint32_t   version;
+   uint32_t   record_size;   // sizeof( struct mulle_concurrent_tracerecord)
+};
+
+
+struct mulle_concurrent_tracerecord
+{
+   uint64_t   timestamp;   // ns since the trace was started
+   uint64_t   key;         // hash for hashmaps, index (get) or value (add, remove)
+   uint16_t   thread;
+   uint16_t   object;
+   uint16_t   op;          // MULLE_CONCURRENT_TRACE_HASHMAP_INSERT...
+   uint16_t   _reserved;
+};
+
+
+#pragma mark -
+#pragma mark multi-threaded
+
+//
+// Starts writing a trace to fp, which stays open.
+//
+// Returns:
+//   0      : OK
+//   EINVAL : invalid argument
+//   EBUSY  : a trace is already running
+//   EIO    : the header could not be written
+//   ENOSYS : compiled without MULLE_CONCURRENT_TRACE
+//
+int   mulle_concurrent_trace_start( FILE *fp);
+
+
+//
+// Stops the trace and writes the buffers of all threads. Other threads
+// should be done with the containers at this point, records made while
+// stopping may be lost.
+//
+// Returns:
+//   0      : OK
+//   EINVAL : no trace running
+//   EIO    : records could not be written
+//   ENOSYS : compiled without MULLE_CONCURRENT_TRACE
+//
+int   mulle_concurrent_trace_stop( void);
+
+
+#pragma mark -
+#pragma mark used by the containers, no parameter checks
+
+#ifdef MULLE_CONCURRENT_TRACE
+
+void   _mulle_concurrent_trace_record( unsigned int op, void *object, uint64_t key);
+
+# define MULLE_CONCURRENT_TRACE_RECORD( op, object, key) \
+   _mulle_concurrent_trace_record( MULLE_CONCURRENT_TRACE_ ## op, (object), (uint64_t) (key))
+
+#else
+
+# define MULLE_CONCURRENT_TRACE_RECORD( op, object, key)   ((void) 0)
+
+#endif
+
+#endif /* mulle_concurrent_trace_h */
@@ -0,0 +1,192 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+
+#define N_VALUES   64
+
+
+static void   *make_value( unsigned int i)
+{
+   return( (void *) (uintptr_t) i);
+}
+
+
+static void   fill( struct mulle_concurrent_pointerarray *array,
+                    unsigned int from,
+                    unsigned int to)
+{
+   unsigned int   i;
+
+   for( i = from; i <= to; i++)
+      mulle_concurrent_pointerarray_add( array, make_value( i));
+}
+
+
+//
+// the enumerator has returned 1, 2 and 3. Then 3 (the value it would look
+// for) and 1 are removed and the array is migrated.
+//
+static void   forward_test( void)
+{
+   struct mulle_concurrent_pointerarray             array;
+   struct mulle_concurrent_pointerarrayenumerator   rover;
+   unsigned int                                     i;
+   void                                             *value;
+   int                                              rval;
+
+   mulle_concurrent_pointerarray_init( &array, 8, NULL);
+   {
+      fill( &array, 1, 8);
+
+      rover = mulle_concurrent_pointerarray_enumerate( &array);
+      for( i = 1; i <= 3; i++)
+      {
+         value = mulle_concurrent_pointerarrayenumerator_next( &rover);
+         assert( value == make_value( i));
+      }
+
+      rval = mulle_concurrent_pointerarray_remove( &array, make_value( 3));
+      assert( rval == 0);
+      rval = mulle_concurrent_pointerarray_remove( &array, make_value( 1));
+      assert( rval == 0);
+
+      // the array is full, so this migrates and drops the tombstones
+      fill( &array, 9, 9);
+      assert( mulle_concurrent_pointerarray_get( &array, 0) == make_value( 2));
+
+      for( i = 4; i <= 9; i++)
+      {
+         value = mulle_concurrent_pointerarrayenumerator_next( &rover);
+         assert( value == make_value( i));
+      }
+      value = mulle_concurrent_pointerarrayenumerator_next( &rover);
+      assert( value == MULLE_CONCURRENT_NO_POINTER);
+      mulle_concurrent_pointerarrayenumerator_done( &rover);
+   }
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+static void   reverse_test( void)
+{
+   struct mulle_concurrent_pointerarray                    array;
+   struct mulle_concurrent_pointerarrayreverseenumerator   rover;
+   unsigned int                                            i;
+   void                                                    *value;
+   int                                                     rval;
+
+   mulle_concurrent_pointerarray_init( &array, 8, NULL);
+   {
+      fill( &array, 1, 8);
+
+      rover = mulle_concurrent_pointerarray_reverseenumerate( &array, 8);
+      for( i = 8; i >= 6; i--)
+      {
+         value = mulle_concurrent_pointerarrayreverseenumerator_next( &rover);
+         assert( value == make_value( i));
+      }
+
+      rval = mulle_concurrent_pointerarray_remove( &array, make_value( 6));
+      assert( rval == 0);
+      rval = mulle_concurrent_pointerarray_remove( &array, make_value( 8));
+      assert( rval == 0);
+
+      fill( &array, 9, 9);
+      assert( mulle_concurrent_pointerarray_get( &array, 5) == make_value( 7));
+
+      for( i = 5; i >= 1; i--)
+      {
+         value = mulle_concurrent_pointerarrayreverseenumerator_next( &rover);
+         assert( value == make_value( i));
+      }
+      value = mulle_concurrent_pointerarrayreverseenumerator_next( &rover);
+      assert( value == MULLE_CONCURRENT_NO_POINTER);
+      mulle_concurrent_pointerarrayreverseenumerator_done( &rover);
+   }
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+//
+// more than one migration between two calls. Values may be returned twice
+// then, but none of the values that stayed in the array may be missed
+//
+static void   multiple_migrations_test( void)
+{
+   struct mulle_concurrent_pointerarray             array;
+   struct mulle_concurrent_pointerarrayenumerator   rover;
+   unsigned int                                     seen[ N_VALUES + 1];
+   unsigned int                                     i;
+   void                                             *value;
+   int                                              rval;
+
+   memset( seen, 0, sizeof( seen));
+
+   mulle_concurrent_pointerarray_init( &array, 8, NULL);
+   {
+      fill( &array, 1, 8);
+
+      rover = mulle_concurrent_pointerarray_enumerate( &array);
+      for( i = 1; i <= 4; i++)
+      {
+         value = mulle_concurrent_pointerarrayenumerator_next( &rover);
+         assert( value == make_value( i));
+         seen[ i]++;
+      }
+
+      for( i = 1; i <= 4; i += 3)
+      {
+         rval = mulle_concurrent_pointerarray_remove( &array, make_value( i));
+         assert( rval == 0);
+      }
+      fill( &array, 9, 16);
+
+      for( i = 5; i <= 16; i += 2)
+      {
+         rval = mulle_concurrent_pointerarray_remove( &array, make_value( i));
+         assert( rval == 0);
+      }
+      fill( &array, 17, N_VALUES);
+
+      while( (value = mulle_concurrent_pointerarrayenumerator_next( &rover)) != MULLE_CONCURRENT_NO_POINTER)
+      {
+         assert( (uintptr_t) value >= 1 && (uintptr_t) value <= N_VALUES);
+         seen[ (uintptr_t) value]++;
+      }
+      mulle_concurrent_pointerarrayenumerator_done( &rover);
+
+      for( i = 5; i <= N_VALUES; i++)
+         if( i > 16 || ! (i & 1))
+            assert( seen[ i] >= 1);
+         else
+            assert( seen[ i] == 0);
+   }
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   forward_test();
+   reverse_test();
+   multiple_migrations_test();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+
+   return( 0);
+}
@@ -0,0 +1,78 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <errno.h>
+
+
+//
+// sizes chosen to hit the vector strides and the scalar tail
+//
+static void   test( unsigned int n)
+{
+   struct mulle_concurrent_pointerarray   array;
+   unsigned int                           i;
+   void                                   *value;
+
+   mulle_concurrent_pointerarray_init( &array, 0, NULL);
+   {
+      for( i = 1; i <= n; i++)
+      {
+         value = (void *) (uintptr_t) (i * 16);
+         mulle_concurrent_pointerarray_add( &array, value);
+      }
+
+      for( i = 1; i <= n; i++)
+      {
+         value = (void *) (uintptr_t) (i * 16);
+         assert( mulle_concurrent_pointerarray_index_of( &array, value) == i - 1);
+         assert( mulle_concurrent_pointerarray_find( &array, value) == 1);
+      }
+
+#if UINTPTR_MAX == UINT64_MAX
+      // lower 32 bit match, upper don't
+      value = (void *) (uintptr_t) (((uint64_t) 1 << 32) + 16);
+      assert( mulle_concurrent_pointerarray_index_of( &array, value) == MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
+#endif
+
+      value = (void *) (uintptr_t) ((n + 1) * 16);
+      assert( mulle_concurrent_pointerarray_index_of( &array, value) == MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
+      assert( mulle_concurrent_pointerarray_find( &array, value) == 0);
+
+      // duplicates return the first index
+      if( n)
+      {
+         mulle_concurrent_pointerarray_add( &array, (void *) 16);
+         assert( mulle_concurrent_pointerarray_index_of( &array, (void *) 16) == 0);
+      }
+
+      assert( mulle_concurrent_pointerarray_index_of( &array, MULLE_CONCURRENT_NO_POINTER) == MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
+      assert( mulle_concurrent_pointerarray_find( &array, MULLE_CONCURRENT_NO_POINTER) == EINVAL);
+   }
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+int   main( void)
+{
+   unsigned int   n;
+
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   for( n = 0; n <= 67; n++)
+      test( n);
+   test( 10000);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+
+   return( 0);
+}
@@ -0,0 +1,150 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <errno.h>
+
+
+#define N_VALUES   10000
+
+
+static void  adder( struct mulle_concurrent_pointerarray *array)
+{
+   unsigned int   i;
+
+   mulle_aba_register();
+
+   for( i = 1; i <= N_VALUES; i++)
+      mulle_concurrent_pointerarray_add( array, (void *) (uintptr_t) (i * 8));
+
+   mulle_aba_unregister();
+}
+
+
+static void   multi_threaded_test( unsigned int n_threads)
+{
+   struct mulle_concurrent_pointerarray   array;
+   mulle_thread_t                         threads[ 8];
+   unsigned int                           i;
+   uintptr_t                              index;
+   void                                   *value;
+
+   assert( n_threads <= 8);
+
+   mulle_concurrent_pointerarray_init_indexed( &array, 0, NULL);
+   {
+      for( i = 0; i < n_threads; i++)
+         if( mulle_thread_create( (void *) adder, &array, &threads[ i]))
+         {
+            perror( "mulle_thread_create");
+            abort();
+         }
+
+      for( i = 0; i < n_threads; i++)
+         mulle_thread_join( threads[ i]);
+
+      assert( mulle_concurrent_pointerarray_get_count( &array) == N_VALUES * n_threads);
+
+      for( i = 1; i <= N_VALUES; i++)
+      {
+         value = (void *) (uintptr_t) (i * 8);
+         index = mulle_concurrent_pointerarray_index_of( &array, value);
+         assert( index != MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
+         assert( mulle_concurrent_pointerarray_get( &array, index) == value);
+         assert( mulle_concurrent_pointerarray_find( &array, value) == 1);
+      }
+
+      value = (void *) (uintptr_t) ((N_VALUES + 1) * 8);
+      assert( mulle_concurrent_pointerarray_index_of( &array, value) == MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
+      assert( mulle_concurrent_pointerarray_find( &array, value) == 0);
+   }
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+static void   single_threaded_test( void)
+{
+   struct mulle_concurrent_pointerarray   array;
+   unsigned int                           i;
+
+   mulle_concurrent_pointerarray_init_indexed( &array, 5, NULL);
+   {
+      for( i = 1; i <= 100; i++)
+         mulle_concurrent_pointerarray_add( &array, (void *) (uintptr_t) i);
+
+      // duplicates keep the first index
+      mulle_concurrent_pointerarray_add( &array, (void *) 1);
+
+      for( i = 1; i <= 100; i++)
+         assert( mulle_concurrent_pointerarray_index_of( &array, (void *) (uintptr_t) i) == i - 1);
+      assert( mulle_concurrent_pointerarray_index_of( &array, (void *) 101) == MULLE_CONCURRENT_POINTERARRAY_NOT_FOUND);
+      assert( mulle_concurrent_pointerarray_get_count( &array) == 101);
+   }
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+//
+// a compaction moves the index entries along with the values. With
+// MULLE_CONCURRENT_STATS check, that the lookups didn't have to scan
+//
+static void   compacted_test( void)
+{
+   struct mulle_concurrent_pointerarray   array;
+   struct mulle_concurrent_stats          before;
+   struct mulle_concurrent_stats          after;
+   unsigned int                           i;
+   int                                    has_stats;
+   int                                    rval;
+
+   mulle_concurrent_pointerarray_init_indexed( &array, 8, NULL);
+   {
+      for( i = 1; i <= 8; i++)
+         mulle_concurrent_pointerarray_add( &array, (void *) (uintptr_t) i);
+      for( i = 1; i <= 7; i += 2)
+      {
+         rval = mulle_concurrent_pointerarray_remove( &array, (void *) (uintptr_t) i);
+         assert( rval == 0);
+      }
+
+      // the array is full, so this moves 2, 4, 6 and 8 to the front
+      mulle_concurrent_pointerarray_add( &array, (void *) 9);
+      assert( mulle_concurrent_pointerarray_get( &array, 0) == (void *) 2);
+
+      has_stats = ! mulle_concurrent_pointerarray_get_stats( &before);
+      for( i = 2; i <= 8; i += 2)
+         assert( mulle_concurrent_pointerarray_index_of( &array, (void *) (uintptr_t) i) == i / 2 - 1);
+      assert( mulle_concurrent_pointerarray_index_of( &array, (void *) 9) == 4);
+
+      if( has_stats)
+      {
+         mulle_concurrent_pointerarray_get_stats( &after);
+         assert( after.probe_steps == before.probe_steps);
+      }
+   }
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   single_threaded_test();
+   compacted_test();
+   multi_threaded_test( 1);
+   multi_threaded_test( 4);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+
+   return( 0);
+}
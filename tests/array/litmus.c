@@ -0,0 +1,143 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+//
+// Message passing: the writers fill in a payload with plain stores, then
+// add it. A reader that gets the payload, by index or while enumerating,
+// must see it filled in. This is the ordering contract of
+// dox/MEMORY_ORDERING.md, on x86 it's mostly a stress test.
+//
+#define N_WRITERS   2
+#define N_VALUES    50000
+
+
+struct payload
+{
+   intptr_t   a;
+   intptr_t   b;
+};
+
+
+static struct payload                         payloads[ N_VALUES];
+static struct mulle_concurrent_pointerarray   array;
+static mulle_atomic_pointer_t                 n_writing;
+
+
+static void   check( struct payload *p)
+{
+   assert( p >= payloads && p < &payloads[ N_VALUES]);
+   assert( p->a == p - payloads);
+   assert( p->b == ~p->a);
+}
+
+
+static void   writer( void *info)
+{
+   intptr_t   i;
+
+   mulle_aba_register();
+
+   for( i = (intptr_t) info; i < N_VALUES; i += N_WRITERS)
+   {
+      payloads[ i].a = i;
+      payloads[ i].b = ~i;
+      mulle_concurrent_pointerarray_add( &array, &payloads[ i]);
+   }
+
+   _mulle_atomic_pointer_decrement( &n_writing);
+   mulle_aba_unregister();
+}
+
+
+static void   get_reader( void *info)
+{
+   struct payload   *p;
+   uintptr_t        i;
+
+   mulle_aba_register();
+
+   for( i = 0; i < N_VALUES; i++)
+   {
+      while( (p = mulle_concurrent_pointerarray_get( &array, i)) == MULLE_CONCURRENT_NO_POINTER)
+         mulle_thread_yield();
+      check( p);
+   }
+
+   mulle_aba_unregister();
+}
+
+
+static void   enumerate_reader( void *info)
+{
+   struct mulle_concurrent_pointerarrayenumerator   rover;
+   void                                             *value;
+   int                                              more;
+
+   mulle_aba_register();
+
+   do
+   {
+      more  = _mulle_atomic_pointer_read( &n_writing) != NULL;
+      rover = mulle_concurrent_pointerarray_enumerate( &array);
+      while( (value = _mulle_concurrent_pointerarrayenumerator_next( &rover)) != MULLE_CONCURRENT_NO_POINTER)
+         check( value);
+      mulle_concurrent_pointerarrayenumerator_done( &rover);
+      mulle_thread_yield();
+   }
+   while( more);
+
+   mulle_aba_unregister();
+}
+
+
+static void   test( void)
+{
+   mulle_thread_t   threads[ N_WRITERS + 2];
+   unsigned int     i;
+
+   mulle_concurrent_pointerarray_init( &array, 0, NULL);
+   _mulle_atomic_pointer_nonatomic_write( &n_writing, (void *) N_WRITERS);
+
+   if( mulle_thread_create( (void *) get_reader, NULL, &threads[ 0]) ||
+       mulle_thread_create( (void *) enumerate_reader, NULL, &threads[ 1]))
+   {
+      perror( "mulle_thread_create");
+      abort();
+   }
+   for( i = 0; i < N_WRITERS; i++)
+      if( mulle_thread_create( (void *) writer, (void *) (uintptr_t) i, &threads[ 2 + i]))
+      {
+         perror( "mulle_thread_create");
+         abort();
+      }
+
+   for( i = 0; i < N_WRITERS + 2; i++)
+      mulle_thread_join( threads[ i]);
+
+   assert( mulle_concurrent_pointerarray_get_count( &array) == N_VALUES);
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
@@ -0,0 +1,159 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <errno.h>
+
+
+#define N_VALUES   100000
+
+
+static mulle_atomic_pointer_t   seen[ N_VALUES];
+
+
+static void   *value_for_index( unsigned int i)
+{
+   return( (void *) (uintptr_t) ((i + 1) * 8));
+}
+
+
+static void   visit( void *value, void *userinfo)
+{
+   unsigned int            i;
+   volatile unsigned int   j;
+
+   i = (unsigned int) ((uintptr_t) value / 8) - 1;
+   assert( i < N_VALUES);
+
+   // make the cost uneven, so that stealing has something to do
+   if( i < N_VALUES / 8)
+      for( j = 0; j < 1000; j++);
+
+   _mulle_atomic_pointer_increment( &seen[ i]);
+   _mulle_atomic_pointer_increment( (mulle_atomic_pointer_t *) userinfo);
+}
+
+
+static int   serial_executor( void (*worker)( void *),
+                              void **worker_infos,
+                              unsigned int n,
+                              void *executor_info)
+{
+   unsigned int   i;
+
+   ++*(unsigned int *) executor_info;
+   for( i = 0; i < n; i++)
+      (*worker)( worker_infos[ i]);
+   return( 0);
+}
+
+
+static int   lazy_executor( void (*worker)( void *),
+                            void **worker_infos,
+                            unsigned int n,
+                            void *executor_info)
+{
+   return( 0);
+}
+
+
+static void   check_seen( unsigned int removed)
+{
+   unsigned int   i;
+
+   for( i = 0; i < N_VALUES; i++)
+   {
+      assert( (uintptr_t) _mulle_atomic_pointer_read( &seen[ i]) == (i % 5 == 0 && removed ? 0 : 1));
+      _mulle_atomic_pointer_nonatomic_write( &seen[ i], NULL);
+   }
+}
+
+
+static void   test( void)
+{
+   struct mulle_concurrent_pointerarray   array;
+   mulle_atomic_pointer_t                 total;
+   unsigned int                           i;
+   unsigned int                           calls;
+   unsigned int                           n_workers;
+   uintptr_t                              expect;
+   int                                    rval;
+
+   mulle_concurrent_pointerarray_init( &array, 0, NULL);
+
+   _mulle_atomic_pointer_nonatomic_write( &total, NULL);
+   rval = mulle_concurrent_pointerarray_parallel_map( &array, 4, visit, &total);
+   assert( rval == 0);
+   assert( _mulle_atomic_pointer_read( &total) == NULL);
+
+   for( i = 0; i < N_VALUES; i++)
+      mulle_concurrent_pointerarray_add( &array, value_for_index( i));
+
+   for( n_workers = 1; n_workers <= 8; n_workers *= 2)
+   {
+      _mulle_atomic_pointer_nonatomic_write( &total, NULL);
+      rval = mulle_concurrent_pointerarray_parallel_map( &array, n_workers, visit, &total);
+      assert( rval == 0);
+      assert( (uintptr_t) _mulle_atomic_pointer_read( &total) == N_VALUES);
+      check_seen( 0);
+   }
+
+   for( i = 0; i < N_VALUES; i += 5)
+   {
+      rval = mulle_concurrent_pointerarray_remove( &array, value_for_index( i));
+      assert( rval == 0);
+   }
+   expect = N_VALUES - (N_VALUES + 4) / 5;
+
+   _mulle_atomic_pointer_nonatomic_write( &total, NULL);
+   rval = mulle_concurrent_pointerarray_parallel_map( &array, 3, visit, &total);
+   assert( rval == 0);
+   assert( (uintptr_t) _mulle_atomic_pointer_read( &total) == expect);
+   check_seen( 1);
+
+   calls = 0;
+   _mulle_atomic_pointer_nonatomic_write( &total, NULL);
+   rval = mulle_concurrent_pointerarray_parallel_map_with_executor( &array, 5, visit, &total, serial_executor, &calls);
+   assert( rval == 0);
+   assert( calls == 1);
+   assert( (uintptr_t) _mulle_atomic_pointer_read( &total) == expect);
+   check_seen( 1);
+
+   // executor that runs nothing, the calling thread must finish the job
+   _mulle_atomic_pointer_nonatomic_write( &total, NULL);
+   rval = mulle_concurrent_pointerarray_parallel_map_with_executor( &array, 5, visit, &total, lazy_executor, NULL);
+   assert( rval == 0);
+   assert( (uintptr_t) _mulle_atomic_pointer_read( &total) == expect);
+   check_seen( 1);
+
+   rval = mulle_concurrent_pointerarray_parallel_map( NULL, 4, visit, &total);
+   assert( rval == EINVAL);
+   rval = mulle_concurrent_pointerarray_parallel_map( &array, 0, visit, &total);
+   assert( rval == EINVAL);
+   rval = mulle_concurrent_pointerarray_parallel_map( &array, 4, NULL, &total);
+   assert( rval == EINVAL);
+   rval = mulle_concurrent_pointerarray_parallel_map_with_executor( &array, 4, visit, &total, NULL, NULL);
+   assert( rval == EINVAL);
+
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
@@ -78,7 +78,7 @@ static void  enumerate_something( struct mulle_concurrent_pointerarray *map)
    int                                              rval;
 
    rover = mulle_concurrent_pointerarray_enumerate( map);
-   while( value = mulle_concurrent_pointerarrayenumerator_next( &rover))
+   while( (value = mulle_concurrent_pointerarrayenumerator_next( &rover)) != MULLE_CONCURRENT_NO_POINTER)
    {
    }
    mulle_concurrent_pointerarrayenumerator_done( &rover);
@@ -178,7 +178,7 @@ static void  single_threaded_test( void)
 
       i = 1;
       rover = mulle_concurrent_pointerarray_enumerate( &map);
-      while( value = mulle_concurrent_pointerarrayenumerator_next( &rover))
+      while( (value = mulle_concurrent_pointerarrayenumerator_next( &rover)) != MULLE_CONCURRENT_NO_POINTER)
       {
          assert( value == (void *) (i * 10));
          ++i;
@@ -0,0 +1,229 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <errno.h>
+
+
+#define N_THREADS   8
+#define N_VALUES    20000
+
+
+static void   *make_value( unsigned int thread, unsigned int i)
+{
+   return( (void *) (uintptr_t) (((thread + 1) << 24 | i) << 1));
+}
+
+
+static unsigned int   value_thread( void *value)
+{
+   return( (unsigned int) ((uintptr_t) value >> 25) - 1);
+}
+
+
+static unsigned int   value_index( void *value)
+{
+   return( (unsigned int) ((uintptr_t) value >> 1) & 0xFFFFFF);
+}
+
+
+struct info
+{
+   struct mulle_concurrent_pointerarray   *array;
+   unsigned int                           thread;
+};
+
+
+//
+// every thread adds its own values and removes those that are not a
+// multiple of three again, while checking that the order of the values it
+// sees is kept
+//
+static void  churner( struct info *info)
+{
+   struct mulle_concurrent_pointerarrayenumerator   rover;
+   unsigned int                                     i;
+   unsigned int                                     last[ N_THREADS];
+   void                                             *value;
+
+   mulle_aba_register();
+
+   for( i = 0; i < N_VALUES; i++)
+   {
+      mulle_concurrent_pointerarray_add( info->array, make_value( info->thread, i));
+      if( i >= 2 && (i - 2) % 3 != 0)
+         if( mulle_concurrent_pointerarray_remove( info->array, make_value( info->thread, i - 2)))
+            abort();
+
+      if( i % 1000)
+         continue;
+
+      memset( last, 0, sizeof( last));
+      rover = mulle_concurrent_pointerarray_enumerate( info->array);
+      while( (value = mulle_concurrent_pointerarrayenumerator_next( &rover)) != MULLE_CONCURRENT_NO_POINTER)
+      {
+         assert( value_thread( value) < N_THREADS);
+         assert( ! last[ value_thread( value)] || value_index( value) >= last[ value_thread( value)]);
+         last[ value_thread( value)] = value_index( value);
+      }
+      mulle_concurrent_pointerarrayenumerator_done( &rover);
+   }
+
+   mulle_aba_unregister();
+}
+
+
+static void   multi_threaded_test( int indexed)
+{
+   struct mulle_concurrent_pointerarray             array;
+   struct mulle_concurrent_pointerarrayenumerator   rover;
+   struct info                                      info[ N_THREADS];
+   mulle_thread_t                                   threads[ N_THREADS];
+   unsigned int                                     i;
+   unsigned int                                     n;
+   void                                             *value;
+
+   if( indexed)
+      mulle_concurrent_pointerarray_init_indexed( &array, 0, NULL);
+   else
+      mulle_concurrent_pointerarray_init( &array, 0, NULL);
+   {
+      for( i = 0; i < N_THREADS; i++)
+      {
+         info[ i].array  = &array;
+         info[ i].thread = i;
+         if( mulle_thread_create( (void *) churner, &info[ i], &threads[ i]))
+         {
+            perror( "mulle_thread_create");
+            abort();
+         }
+      }
+
+      for( i = 0; i < N_THREADS; i++)
+         mulle_thread_join( threads[ i]);
+
+      n = 0;
+      rover = mulle_concurrent_pointerarray_enumerate( &array);
+      while( (value = mulle_concurrent_pointerarrayenumerator_next( &rover)) != MULLE_CONCURRENT_NO_POINTER)
+      {
+         i = value_index( value);
+         assert( i % 3 == 0 || i >= N_VALUES - 2);
+         assert( mulle_concurrent_pointerarray_find( &array, value) == 1);
+         ++n;
+      }
+      mulle_concurrent_pointerarrayenumerator_done( &rover);
+
+      for( i = 0; i < N_VALUES; i++)
+         if( i % 3 == 0 || i >= N_VALUES - 2)
+            n -= N_THREADS;
+      assert( n == 0);
+      assert( mulle_concurrent_pointerarray_find( &array, make_value( 0, 1)) == 0);
+   }
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+static void   single_threaded_test( int indexed)
+{
+   struct mulle_concurrent_pointerarray                    array;
+   struct mulle_concurrent_pointerarrayenumerator          rover;
+   struct mulle_concurrent_pointerarrayreverseenumerator   reverse;
+   unsigned int                                            i;
+   unsigned int                                            n;
+   void                                                    *value;
+   int                                                     rval;
+
+   if( indexed)
+      mulle_concurrent_pointerarray_init_indexed( &array, 0, NULL);
+   else
+      mulle_concurrent_pointerarray_init( &array, 0, NULL);
+   {
+      for( i = 1; i <= 100; i++)
+         mulle_concurrent_pointerarray_add( &array, (void *) (uintptr_t) i);
+
+      for( i = 2; i <= 100; i += 2)
+      {
+         rval = mulle_concurrent_pointerarray_remove( &array, (void *) (uintptr_t) i);
+         assert( rval == 0);
+      }
+      rval = mulle_concurrent_pointerarray_remove( &array, (void *) 2);
+      assert( rval == ENOENT);
+      rval = mulle_concurrent_pointerarray_remove( &array, MULLE_CONCURRENT_NO_POINTER);
+      assert( rval == EINVAL);
+
+      // removed slots still count until the array is compacted
+      assert( mulle_concurrent_pointerarray_get_count( &array) == 100);
+      assert( mulle_concurrent_pointerarray_get( &array, 0) == (void *) 1);
+      assert( mulle_concurrent_pointerarray_get( &array, 1) == MULLE_CONCURRENT_NO_POINTER);
+      assert( mulle_concurrent_pointerarray_find( &array, (void *) 2) == 0);
+      assert( mulle_concurrent_pointerarray_index_of( &array, (void *) 3) == 2);
+
+      i = 1;
+      rover = mulle_concurrent_pointerarray_enumerate( &array);
+      while( (value = mulle_concurrent_pointerarrayenumerator_next( &rover)) != MULLE_CONCURRENT_NO_POINTER)
+      {
+         assert( value == (void *) (uintptr_t) i);
+         i += 2;
+      }
+      mulle_concurrent_pointerarrayenumerator_done( &rover);
+      assert( i == 101);
+
+      i = 99;
+      reverse = mulle_concurrent_pointerarray_reverseenumerate( &array, 100);
+      while( (value = mulle_concurrent_pointerarrayreverseenumerator_next( &reverse)) != MULLE_CONCURRENT_NO_POINTER)
+      {
+         assert( value == (void *) (uintptr_t) i);
+         i -= 2;
+      }
+      mulle_concurrent_pointerarrayreverseenumerator_done( &reverse);
+      assert( i == (unsigned int) -1);
+
+      // overflow the 128 slots, so the array migrates and drops the tombstones
+      for( i = 101; i <= 129; i++)
+         mulle_concurrent_pointerarray_add( &array, (void *) (uintptr_t) i);
+      assert( mulle_concurrent_pointerarray_get_count( &array) == 50 + 29);
+      assert( mulle_concurrent_pointerarray_get( &array, 1) == (void *) 3);
+      assert( mulle_concurrent_pointerarray_index_of( &array, (void *) 3) == 1);
+      assert( mulle_concurrent_pointerarray_index_of( &array, (void *) 129) == 78);
+
+      // compaction during enumeration
+      rover = mulle_concurrent_pointerarray_enumerate( &array);
+      for( i = 0; i < 10; i++)
+         mulle_concurrent_pointerarrayenumerator_next( &rover);
+      assert( rover.last == (void *) 19);
+      for( i = 1; i <= 9; i += 2)
+         mulle_concurrent_pointerarray_remove( &array, (void *) (uintptr_t) i);
+      n = mulle_concurrent_pointerarray_get_size( &array) - mulle_concurrent_pointerarray_get_count( &array);
+      for( i = 1000; i <= 1000 + n; i++)
+         mulle_concurrent_pointerarray_add( &array, (void *) (uintptr_t) i);
+      assert( mulle_concurrent_pointerarray_get( &array, 0) == (void *) 11);
+      value = mulle_concurrent_pointerarrayenumerator_next( &rover);
+      assert( value == (void *) 21);
+      mulle_concurrent_pointerarrayenumerator_done( &rover);
+   }
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   single_threaded_test( 0);
+   single_threaded_test( 1);
+   multi_threaded_test( 0);
+   multi_threaded_test( 1);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+
+   return( 0);
+}
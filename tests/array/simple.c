@@ -23,7 +23,7 @@ static void   test( void)
       printf( "%p\n", value);
 
       rover = mulle_concurrent_pointerarray_enumerate( &map);
-      while( value = mulle_concurrent_pointerarrayenumerator_next( &rover))
+      while( (value = mulle_concurrent_pointerarrayenumerator_next( &rover)) != MULLE_CONCURRENT_NO_POINTER)
          printf( "%p\n", value);
       mulle_concurrent_pointerarrayenumerator_done( &rover);
    }
@@ -0,0 +1,226 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define N_HASHS     5000
+#define N_ROUNDS    20
+#define N_THREADS   4
+
+#define N_WATCHED      64
+#define N_INCREMENTS   (N_WATCHED * 256)
+
+
+static struct mulle_concurrent_countermap   map;
+static mulle_atomic_pointer_t              n_running;
+static mulle_atomic_pointer_t              n_fresh;
+
+
+// all threads count all hashs up, while the map grows
+static void   counter( void)
+{
+   intptr_t       hash;
+   unsigned int   round;
+
+   mulle_aba_register();
+
+   for( round = 0; round < N_ROUNDS; round++)
+      for( hash = 1; hash <= N_HASHS; hash++)
+         if( mulle_concurrent_countermap_add( &map, hash * (intptr_t) 0x10001, hash))
+         {
+            perror( "mulle_concurrent_countermap_add");
+            abort();
+         }
+
+   mulle_aba_unregister();
+}
+
+
+// all threads count the odd ones down again
+static void   uncounter( void)
+{
+   intptr_t       hash;
+   unsigned int   round;
+
+   mulle_aba_register();
+
+   for( round = 0; round < N_ROUNDS; round++)
+      for( hash = 1; hash <= N_HASHS; hash += 2)
+         if( mulle_concurrent_countermap_add( &map, hash * (intptr_t) 0x10001, -hash))
+         {
+            perror( "mulle_concurrent_countermap_add");
+            abort();
+         }
+
+   mulle_aba_unregister();
+}
+
+
+static void   run( void (*f)( void))
+{
+   mulle_thread_t   threads[ N_THREADS];
+   unsigned int     i;
+
+   for( i = 0; i < N_THREADS; i++)
+      if( mulle_thread_create( (void *) f, NULL, &threads[ i]))
+      {
+         perror( "mulle_thread_create");
+         abort();
+      }
+   for( i = 0; i < N_THREADS; i++)
+      mulle_thread_join( threads[ i]);
+}
+
+
+// counts the watched hashs up by one, while fresh hashs grow the map
+static void   incrementer( void)
+{
+   intptr_t       hash;
+   unsigned int   i;
+
+   mulle_aba_register();
+
+   for( i = 0; i < N_INCREMENTS; i++)
+   {
+      hash = N_WATCHED + (intptr_t) _mulle_atomic_pointer_increment( &n_fresh);
+      if( mulle_concurrent_countermap_add( &map, 1 + i % N_WATCHED, 1) ||
+          mulle_concurrent_countermap_add( &map, hash * (intptr_t) 0x10001, 1))
+      {
+         perror( "mulle_concurrent_countermap_add");
+         abort();
+      }
+   }
+
+   _mulle_atomic_pointer_decrement( &n_running);
+   mulle_aba_unregister();
+}
+
+
+// a counter, that is only counted up, must never be seen going down
+static void   watcher( void)
+{
+   intptr_t   seen[ N_WATCHED + 1] = { 0 };
+   intptr_t   hash;
+   intptr_t   value;
+
+   mulle_aba_register();
+
+   while( _mulle_atomic_pointer_read( &n_running))
+      for( hash = 1; hash <= N_WATCHED; hash++)
+      {
+         value = mulle_concurrent_countermap_get( &map, hash);
+         if( value < seen[ hash])
+         {
+            fprintf( stderr, "counter %ld went down from %ld to %ld\n",
+                             (long) hash, (long) seen[ hash], (long) value);
+            abort();
+         }
+         seen[ hash] = value;
+      }
+
+   mulle_aba_unregister();
+}
+
+
+static void   monotonic_test( void)
+{
+   mulle_thread_t   threads[ N_THREADS];
+   unsigned int     i;
+   intptr_t         hash;
+
+   mulle_concurrent_countermap_init( &map, 0, NULL);
+
+   _mulle_atomic_pointer_nonatomic_write( &n_running, (void *) (N_THREADS - 1));
+   _mulle_atomic_pointer_nonatomic_write( &n_fresh, (void *) 0);
+   for( i = 0; i < N_THREADS; i++)
+      if( mulle_thread_create( (void *) (i ? incrementer : watcher), NULL, &threads[ i]))
+      {
+         perror( "mulle_thread_create");
+         abort();
+      }
+   for( i = 0; i < N_THREADS; i++)
+      mulle_thread_join( threads[ i]);
+
+   for( hash = 1; hash <= N_WATCHED; hash++)
+      assert( mulle_concurrent_countermap_get( &map, hash) == N_INCREMENTS / N_WATCHED * (N_THREADS - 1));
+
+   mulle_concurrent_countermap_done( &map);
+}
+
+
+static void   test( void)
+{
+   struct mulle_concurrent_countermapenumerator   rover;
+   intptr_t                                       hash;
+   intptr_t                                       value;
+   uintptr_t                                      n;
+   int                                            rval;
+
+   mulle_concurrent_countermap_init( &map, 0, NULL);
+
+   // no add may get lost during migration
+   run( counter);
+   for( hash = 1; hash <= N_HASHS; hash++)
+      assert( mulle_concurrent_countermap_get( &map, hash * (intptr_t) 0x10001) == hash * N_ROUNDS * N_THREADS);
+
+   run( uncounter);
+   for( hash = 1; hash <= N_HASHS; hash++)
+      assert( mulle_concurrent_countermap_get( &map, hash * (intptr_t) 0x10001) == ((hash & 1) ? 0 : hash * N_ROUNDS * N_THREADS));
+
+   // counters, that are down to 0, are still there
+   assert( mulle_concurrent_countermap_count( &map) == N_HASHS);
+   assert( mulle_concurrent_countermap_get_size( &map) >= N_HASHS);
+
+   n     = 0;
+   rover = mulle_concurrent_countermap_enumerate( &map);
+   while( mulle_concurrent_countermapenumerator_next( &rover, &hash, &value) == 1)
+   {
+      assert( ! (hash % 0x10001));
+      hash /= 0x10001;
+      assert( value == ((hash & 1) ? 0 : hash * N_ROUNDS * N_THREADS));
+      ++n;
+   }
+   mulle_concurrent_countermapenumerator_done( &rover);
+   assert( n == N_HASHS);
+
+   // missing counters are 0, negative counters are fine
+   assert( mulle_concurrent_countermap_get( &map, -1) == 0);
+   rval = mulle_concurrent_countermap_add( &map, -1, -1848);
+   assert( rval == 0);
+   assert( mulle_concurrent_countermap_get( &map, -1) == -1848);
+   rval = mulle_concurrent_countermap_add( &map, -1, 1848);
+   assert( rval == 0);
+   assert( mulle_concurrent_countermap_get( &map, -1) == 0);
+
+   rval = mulle_concurrent_countermap_add( &map, MULLE_CONCURRENT_NO_HASH, 1);
+   assert( rval == EINVAL);
+   rval = mulle_concurrent_countermap_add( NULL, 1, 1);
+   assert( rval == EINVAL);
+   assert( mulle_concurrent_countermap_get( NULL, 1) == 0);
+
+   mulle_concurrent_countermap_done( &map);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test();
+   monotonic_test();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
@@ -0,0 +1,113 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+
+static void   check_output( struct mulle_concurrent_hashmapanalysis *analysis,
+                            void (*print)( struct mulle_concurrent_hashmapanalysis *, FILE *),
+                            char *expect)
+{
+   FILE     *fp;
+   char     buf[ 1024];
+   size_t   len;
+
+   fp = tmpfile();
+   assert( fp);
+   (*print)( analysis, fp);
+   rewind( fp);
+   len = fread( buf, 1, sizeof( buf) - 1, fp);
+   buf[ len] = 0;
+   fclose( fp);
+
+   assert( strstr( buf, expect));
+}
+
+
+static void   test( void)
+{
+   struct mulle_concurrent_hashmap           map;
+   struct mulle_concurrent_hashmapanalysis   analysis;
+   intptr_t                                  hash;
+   int                                       rval;
+
+   mulle_concurrent_hashmap_init( &map, 64, NULL);
+
+   assert( mulle_concurrent_hashmap_analyze( NULL, &analysis) == EINVAL);
+   assert( mulle_concurrent_hashmap_analyze( &map, NULL) == EINVAL);
+
+   assert( mulle_concurrent_hashmap_analyze( &map, &analysis) == 0);
+   assert( analysis.size == 64);
+   assert( analysis.n_entries == 0);
+   assert( analysis.longest_cluster == 0);
+   assert( analysis.memory > 64 * sizeof( struct _mulle_concurrent_hashvaluepair));
+   assert( ! analysis.migrating);
+
+   // three entries with home slot 1, two with home slot 63, which wrap
+   mulle_concurrent_hashmap_insert( &map, 1, (void *) 0x10);
+   mulle_concurrent_hashmap_insert( &map, 1 + 64, (void *) 0x20);
+   mulle_concurrent_hashmap_insert( &map, 1 + 128, (void *) 0x30);
+   mulle_concurrent_hashmap_insert( &map, 63, (void *) 0x40);
+   mulle_concurrent_hashmap_insert( &map, 63 + 64, (void *) 0x50);
+
+   // lonely entry
+   mulle_concurrent_hashmap_insert( &map, 32, (void *) 0x60);
+
+   assert( mulle_concurrent_hashmap_analyze( &map, &analysis) == 0);
+   assert( analysis.n_entries == 6);
+   assert( analysis.n_tombstones == 0);
+   assert( analysis.n_homes == 3);
+   assert( analysis.distances[ 0] == 3);
+   assert( analysis.distances[ 1] == 2);
+   assert( analysis.distances[ 2] == 1);
+   assert( analysis.max_distance == 2);
+   // slots 63, 0, 1, 2, 3
+   assert( analysis.longest_cluster == 5);
+
+   rval = mulle_concurrent_hashmap_remove( &map, 1 + 64, (void *) 0x20);
+   assert( rval == 0);
+
+   assert( mulle_concurrent_hashmap_analyze( &map, &analysis) == 0);
+   assert( analysis.n_entries == 5);
+   assert( analysis.n_tombstones == 1);
+   assert( analysis.longest_cluster == 5);
+
+   check_output( &analysis, mulle_concurrent_hashmapanalysis_fprint, "tombstones      : 1\n");
+   check_output( &analysis, mulle_concurrent_hashmapanalysis_fprint, "              2 : 1\n");
+   check_output( &analysis, mulle_concurrent_hashmapanalysis_fprint_json, "\"home_slots\": 3, ");
+   check_output( &analysis, mulle_concurrent_hashmapanalysis_fprint_json, "\"distances\": [ 3, 1, 1 ] }\n");
+
+   // long probe sequences end up in the last bucket
+   for( hash = 1; hash <= 40; hash++)
+      mulle_concurrent_hashmap_insert( &map, hash * 1024, (void *) (hash * 8));
+
+   assert( mulle_concurrent_hashmap_analyze( &map, &analysis) == 0);
+   assert( analysis.n_entries == 45);
+   assert( analysis.max_distance >= MULLE_CONCURRENT_HASHMAP_ANALYSIS_N_DISTANCES);
+   assert( analysis.distances[ MULLE_CONCURRENT_HASHMAP_ANALYSIS_N_DISTANCES - 1]);
+
+   mulle_concurrent_hashmap_done( &map);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
@@ -91,7 +91,7 @@ static void  lookup_something( struct mulle_concurrent_hashmap *map)
 
    hash  = rand();
    value = _mulle_concurrent_hashmap_lookup( map, hash);
-   if( ! value)
+   if( value == MULLE_CONCURRENT_NO_POINTER)
       return;
    assert( ! (hash & 0x1));
    assert( value == (void *) (hash * 10));
@@ -226,7 +226,7 @@ static void  single_threaded_test( void)
       for( i = 1; i <= 100; i++)
          assert( mulle_concurrent_hashmap_lookup( &map, i) == (void *) (i * 10));
 
-      assert( ! mulle_concurrent_hashmap_lookup( &map, 101));
+      assert( mulle_concurrent_hashmap_lookup( &map, 101) == MULLE_CONCURRENT_NO_POINTER);
 
       i = 0;
       rover = mulle_concurrent_hashmap_enumerate( &map);
@@ -240,7 +240,7 @@ static void  single_threaded_test( void)
       assert( i == 100);
 
       mulle_concurrent_hashmap_remove( &map, 50, (void *) (50 * 10));
-      assert( mulle_concurrent_hashmap_lookup( &map, 50) == NULL);
+      assert( mulle_concurrent_hashmap_lookup( &map, 50) == MULLE_CONCURRENT_NO_POINTER);
 
       i = 0;
       rover = mulle_concurrent_hashmap_enumerate( &map);
@@ -0,0 +1,144 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+
+#define N_VALUES   1000
+
+
+static int   is_inline( struct mulle_concurrent_inlinehashmap *map)
+{
+   return( (void *) map->map.storage.storage == (void *) &map->storage.n_hashs);
+}
+
+
+static void   test( void)
+{
+   struct mulle_concurrent_inlinehashmap       map;
+   struct mulle_concurrent_hashmapenumerator   rover;
+   intptr_t                                    hash;
+   void                                        *value;
+   unsigned int                                n;
+   int                                         rval;
+
+   rval = mulle_concurrent_inlinehashmap_init( NULL, NULL);
+   assert( rval == EINVAL);
+
+   mulle_concurrent_inlinehashmap_init( &map, NULL);
+   {
+      assert( is_inline( &map));
+      assert( mulle_concurrent_hashmap_get_size( &map.map) == MULLE_CONCURRENT_HASHMAP_INLINE_SIZE);
+
+      // fits inline
+      for( hash = 1; hash <= MULLE_CONCURRENT_HASHMAP_INLINE_SIZE / 2; hash++)
+      {
+         rval = mulle_concurrent_hashmap_insert( &map.map, hash, (void *) (hash * 8));
+         assert( rval == 0);
+      }
+      assert( is_inline( &map));
+      rval = mulle_concurrent_hashmap_insert( &map.map, 1, (void *) 8);
+      assert( rval == EEXIST);
+
+      for( hash = 1; hash <= MULLE_CONCURRENT_HASHMAP_INLINE_SIZE / 2; hash++)
+         assert( mulle_concurrent_hashmap_lookup( &map.map, hash) == (void *) (hash * 8));
+
+      rval = mulle_concurrent_hashmap_remove( &map.map, 2, (void *) 16);
+      assert( rval == 0);
+      assert( mulle_concurrent_hashmap_lookup( &map.map, 2) == MULLE_CONCURRENT_NO_POINTER);
+
+      // outgrow it
+      for( hash = MULLE_CONCURRENT_HASHMAP_INLINE_SIZE / 2 + 1; hash <= N_VALUES; hash++)
+      {
+         rval = mulle_concurrent_hashmap_insert( &map.map, hash, (void *) (hash * 8));
+         assert( rval == 0);
+      }
+      assert( ! is_inline( &map));
+
+      n     = 0;
+      rover = mulle_concurrent_hashmap_enumerate( &map.map);
+      while( mulle_concurrent_hashmapenumerator_next( &rover, &hash, &value) == 1)
+      {
+         assert( hash != 2);
+         assert( value == (void *) (hash * 8));
+         ++n;
+      }
+      mulle_concurrent_hashmapenumerator_done( &rover);
+      assert( n == N_VALUES - 1);
+   }
+   mulle_concurrent_inlinehashmap_done( &map);
+
+   // done without ever migrating
+   mulle_concurrent_inlinehashmap_init( &map, NULL);
+   mulle_concurrent_hashmap_insert( &map.map, 1848, (void *) 0x1848);
+   mulle_concurrent_inlinehashmap_done( &map);
+}
+
+
+static void  inserter( struct mulle_concurrent_inlinehashmap *map)
+{
+   intptr_t   hash;
+
+   mulle_aba_register();
+
+   for( hash = 1; hash <= N_VALUES; hash++)
+      mulle_concurrent_hashmap_insert( &map->map, hash, (void *) (hash * 8));
+
+   mulle_aba_unregister();
+}
+
+
+static void   multi_threaded_test( unsigned int n_threads)
+{
+   struct mulle_concurrent_inlinehashmap   map;
+   mulle_thread_t                          threads[ 8];
+   unsigned int                            i;
+   intptr_t                                hash;
+
+   assert( n_threads <= 8);
+
+   mulle_concurrent_inlinehashmap_init( &map, NULL);
+   {
+      for( i = 0; i < n_threads; i++)
+         if( mulle_thread_create( (void *) inserter, &map, &threads[ i]))
+         {
+            perror( "mulle_thread_create");
+            abort();
+         }
+
+      for( i = 0; i < n_threads; i++)
+         mulle_thread_join( threads[ i]);
+
+      assert( mulle_concurrent_hashmap_count( &map.map) == N_VALUES);
+      for( hash = 1; hash <= N_VALUES; hash++)
+         assert( mulle_concurrent_hashmap_lookup( &map.map, hash) == (void *) (hash * 8));
+   }
+   mulle_concurrent_inlinehashmap_done( &map);
+}
+
+
+int   main( void)
+{
+   unsigned int   i;
+
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test();
+   for( i = 0; i < 20; i++)
+      multi_threaded_test( 4);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+
+   return( 0);
+}
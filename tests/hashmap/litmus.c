@@ -0,0 +1,144 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+//
+// Message passing: the writers fill in a payload with plain stores, then
+// insert it. A reader that finds the payload, with lookup or while
+// enumerating, must see it filled in. This is the ordering contract of
+// dox/MEMORY_ORDERING.md, on x86 it's mostly a stress test.
+//
+#define N_WRITERS   2
+#define N_VALUES    50000
+
+
+struct payload
+{
+   intptr_t   a;
+   intptr_t   b;
+};
+
+
+static struct payload                    payloads[ N_VALUES];
+static struct mulle_concurrent_hashmap   map;
+static mulle_atomic_pointer_t            n_writing;
+
+
+static void   check( intptr_t hash, struct payload *p)
+{
+   assert( p == &payloads[ hash - 1]);
+   assert( p->a == hash);
+   assert( p->b == ~hash);
+}
+
+
+static void   writer( void *info)
+{
+   intptr_t   hash;
+
+   mulle_aba_register();
+
+   for( hash = (intptr_t) info; hash <= N_VALUES; hash += N_WRITERS)
+   {
+      payloads[ hash - 1].a = hash;
+      payloads[ hash - 1].b = ~hash;
+      mulle_concurrent_hashmap_insert( &map, hash, &payloads[ hash - 1]);
+   }
+
+   _mulle_atomic_pointer_decrement( &n_writing);
+   mulle_aba_unregister();
+}
+
+
+static void   lookup_reader( void *info)
+{
+   struct payload   *p;
+   intptr_t         hash;
+
+   mulle_aba_register();
+
+   for( hash = 1; hash <= N_VALUES; hash++)
+   {
+      while( (p = mulle_concurrent_hashmap_lookup( &map, hash)) == MULLE_CONCURRENT_NO_POINTER)
+         mulle_thread_yield();
+      check( hash, p);
+   }
+
+   mulle_aba_unregister();
+}
+
+
+static void   enumerate_reader( void *info)
+{
+   struct mulle_concurrent_hashmapenumerator   rover;
+   intptr_t                                    hash;
+   void                                        *value;
+   int                                         more;
+
+   mulle_aba_register();
+
+   do
+   {
+      more  = _mulle_atomic_pointer_read( &n_writing) != NULL;
+      rover = mulle_concurrent_hashmap_enumerate( &map);
+      while( _mulle_concurrent_hashmapenumerator_next( &rover, &hash, &value) == 1)
+         check( hash, value);
+      mulle_concurrent_hashmapenumerator_done( &rover);
+      mulle_thread_yield();
+   }
+   while( more);
+
+   mulle_aba_unregister();
+}
+
+
+static void   test( void)
+{
+   mulle_thread_t   threads[ N_WRITERS + 2];
+   unsigned int     i;
+
+   mulle_concurrent_hashmap_init( &map, 0, NULL);
+   _mulle_atomic_pointer_nonatomic_write( &n_writing, (void *) N_WRITERS);
+
+   if( mulle_thread_create( (void *) lookup_reader, NULL, &threads[ 0]) ||
+       mulle_thread_create( (void *) enumerate_reader, NULL, &threads[ 1]))
+   {
+      perror( "mulle_thread_create");
+      abort();
+   }
+   for( i = 0; i < N_WRITERS; i++)
+      if( mulle_thread_create( (void *) writer, (void *) (uintptr_t) (i + 1), &threads[ 2 + i]))
+      {
+         perror( "mulle_thread_create");
+         abort();
+      }
+
+   for( i = 0; i < N_WRITERS + 2; i++)
+      mulle_thread_join( threads[ i]);
+
+   assert( mulle_concurrent_hashmap_count( &map) == N_VALUES);
+   mulle_concurrent_hashmap_done( &map);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
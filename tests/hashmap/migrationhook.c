@@ -0,0 +1,189 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+
+#define N_VALUES   1000
+#define N_EVENTS   4096
+
+
+static struct mulle_concurrent_migrationevent   events[ N_EVENTS];
+static mulle_atomic_pointer_t                   n_events;
+
+
+static void   record( struct mulle_concurrent_migrationevent *event, void *userinfo)
+{
+   uintptr_t   i;
+
+   assert( userinfo == &n_events);
+
+   // increment doesn't return the new value on all platforms
+   do
+      i = (uintptr_t) _mulle_atomic_pointer_read( &n_events);
+   while( ! _mulle_atomic_pointer_compare_and_swap( &n_events, (void *) (i + 1), (void *) i));
+
+   assert( i < N_EVENTS);
+   events[ i] = *event;
+}
+
+
+static unsigned int   count_events( unsigned int type)
+{
+   uintptr_t      i;
+   uintptr_t      n;
+   unsigned int   count;
+
+   count = 0;
+   n     = (uintptr_t) _mulle_atomic_pointer_read( &n_events);
+   for( i = 0; i < n; i++)
+      if( events[ i].type == type)
+         ++count;
+   return( count);
+}
+
+
+static void   check_single_threaded( void *object, unsigned int container)
+{
+   uintptr_t   i;
+   uintptr_t   n;
+   uintptr_t   size;
+
+   n = (uintptr_t) _mulle_atomic_pointer_read( &n_events);
+   assert( n && n % 3 == 0);
+
+   size = events[ 0].old_size;
+   for( i = 0; i < n; i += 3)
+   {
+      assert( events[ i].type == MULLE_CONCURRENT_MIGRATION_STARTED);
+      assert( events[ i + 1].type == MULLE_CONCURRENT_MIGRATION_COPIED);
+      assert( events[ i + 2].type == MULLE_CONCURRENT_MIGRATION_SWAPPED);
+
+      assert( events[ i].object == object);
+      assert( events[ i].container == container);
+      assert( events[ i].old_size == size);
+      assert( events[ i].new_size == size * 2);
+      assert( events[ i].n_copied == 0);
+      assert( events[ i + 1].n_copied > 0);
+      assert( events[ i + 1].n_copied == events[ i + 2].n_copied);
+
+      assert( events[ i].start <= events[ i].timestamp);
+      assert( events[ i].timestamp <= events[ i + 1].timestamp);
+      assert( events[ i + 1].timestamp <= events[ i + 2].timestamp);
+
+      size *= 2;
+   }
+}
+
+
+static void   test( void)
+{
+   struct mulle_concurrent_hashmap        map;
+   struct mulle_concurrent_pointerarray   array;
+   void                                   *userinfo;
+   intptr_t                               hash;
+
+   assert( ! mulle_concurrent_get_migrationhook( NULL));
+
+   mulle_concurrent_set_migrationhook( record, &n_events);
+   assert( mulle_concurrent_get_migrationhook( &userinfo) == record);
+   assert( userinfo == &n_events);
+
+   mulle_concurrent_hashmap_init( &map, 4, NULL);
+   for( hash = 1; hash <= N_VALUES; hash++)
+      mulle_concurrent_hashmap_insert( &map, hash, (void *) (hash * 8));
+   check_single_threaded( &map, MULLE_CONCURRENT_STATS_HASHMAP);
+   mulle_concurrent_hashmap_done( &map);
+
+   _mulle_atomic_pointer_nonatomic_write( &n_events, NULL);
+
+   mulle_concurrent_pointerarray_init( &array, 4, NULL);
+   for( hash = 1; hash <= N_VALUES; hash++)
+      mulle_concurrent_pointerarray_add( &array, (void *) (hash * 8));
+   check_single_threaded( &array, MULLE_CONCURRENT_STATS_POINTERARRAY);
+   mulle_concurrent_pointerarray_done( &array);
+
+   // off again
+   _mulle_atomic_pointer_nonatomic_write( &n_events, NULL);
+   mulle_concurrent_set_migrationhook( NULL, NULL);
+
+   mulle_concurrent_hashmap_init( &map, 4, NULL);
+   for( hash = 1; hash <= N_VALUES; hash++)
+      mulle_concurrent_hashmap_insert( &map, hash, (void *) (hash * 8));
+   mulle_concurrent_hashmap_done( &map);
+
+   assert( _mulle_atomic_pointer_read( &n_events) == NULL);
+}
+
+
+static void  inserter( struct mulle_concurrent_hashmap *map)
+{
+   intptr_t   hash;
+
+   mulle_aba_register();
+
+   for( hash = 1; hash <= N_VALUES; hash++)
+      mulle_concurrent_hashmap_insert( map, hash, (void *) (hash * 8));
+
+   mulle_aba_unregister();
+}
+
+
+static void   multi_threaded_test( void)
+{
+   struct mulle_concurrent_hashmap   map;
+   mulle_thread_t                    threads[ 4];
+   unsigned int                      i;
+
+   _mulle_atomic_pointer_nonatomic_write( &n_events, NULL);
+   mulle_concurrent_set_migrationhook( record, &n_events);
+
+   mulle_concurrent_hashmap_init( &map, 4, NULL);
+   {
+      for( i = 0; i < 4; i++)
+         if( mulle_thread_create( (void *) inserter, &map, &threads[ i]))
+         {
+            perror( "mulle_thread_create");
+            abort();
+         }
+
+      for( i = 0; i < 4; i++)
+         mulle_thread_join( threads[ i]);
+   }
+   mulle_concurrent_hashmap_done( &map);
+
+   mulle_concurrent_set_migrationhook( NULL, NULL);
+
+   // every migration is started and swapped exactly once
+   assert( count_events( MULLE_CONCURRENT_MIGRATION_STARTED) > 0);
+   assert( count_events( MULLE_CONCURRENT_MIGRATION_STARTED) ==
+           count_events( MULLE_CONCURRENT_MIGRATION_SWAPPED));
+   assert( count_events( MULLE_CONCURRENT_MIGRATION_COPIED) >=
+           count_events( MULLE_CONCURRENT_MIGRATION_STARTED));
+}
+
+
+int   main( void)
+{
+   unsigned int   i;
+
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test();
+   for( i = 0; i < 20; i++)
+      multi_threaded_test();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
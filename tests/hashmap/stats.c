@@ -0,0 +1,116 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+
+#define N_VALUES   1000
+
+
+static void   inserter( struct mulle_concurrent_hashmap *map)
+{
+   intptr_t   hash;
+
+   mulle_aba_register();
+
+   for( hash = 1; hash <= N_VALUES; hash++)
+      mulle_concurrent_hashmap_insert( map, hash, (void *) (hash * 8));
+
+   mulle_aba_unregister();
+}
+
+
+static void   test( void)
+{
+   struct mulle_concurrent_hashmap        map;
+   struct mulle_concurrent_pointerarray   array;
+   struct mulle_concurrent_stats          before;
+   struct mulle_concurrent_stats          after;
+   mulle_thread_t                         threads[ 4];
+   unsigned int                           i;
+   intptr_t                               hash;
+   int                                    rc;
+
+   assert( mulle_concurrent_hashmap_get_stats( NULL) == EINVAL);
+   assert( mulle_concurrent_pointerarray_get_stats( NULL) == EINVAL);
+
+   rc = mulle_concurrent_hashmap_get_stats( &before);
+#ifdef MULLE_CONCURRENT_STATS
+   assert( rc == 0);
+#else
+   assert( rc == ENOSYS);
+#endif
+
+   mulle_concurrent_hashmap_init( &map, 0, NULL);
+   {
+      // the counters of exited threads must not get lost
+      for( i = 0; i < 4; i++)
+         if( mulle_thread_create( (void *) inserter, &map, &threads[ i]))
+         {
+            perror( "mulle_thread_create");
+            abort();
+         }
+
+      for( i = 0; i < 4; i++)
+         mulle_thread_join( threads[ i]);
+
+      for( hash = 1; hash <= N_VALUES; hash++)
+         assert( mulle_concurrent_hashmap_lookup( &map, hash) == (void *) (hash * 8));
+   }
+   mulle_concurrent_hashmap_done( &map);
+
+   mulle_concurrent_hashmap_get_stats( &after);
+#ifdef MULLE_CONCURRENT_STATS
+   assert( after.inserts - before.inserts == 4 * N_VALUES);
+   assert( after.eexists - before.eexists == 3 * N_VALUES);
+   assert( after.lookups - before.lookups == N_VALUES);
+   assert( after.migrations_started > before.migrations_started);
+   assert( after.entries_copied > before.entries_copied);
+#else
+   assert( after.inserts == 0 && after.lookups == 0);
+#endif
+
+   mulle_concurrent_pointerarray_get_stats( &before);
+
+   mulle_concurrent_pointerarray_init( &array, 0, NULL);
+   {
+      for( i = 1; i <= N_VALUES; i++)
+         mulle_concurrent_pointerarray_add( &array, (void *) (uintptr_t) (i * 8));
+      for( i = 0; i < N_VALUES; i++)
+         assert( mulle_concurrent_pointerarray_get( &array, i) == (void *) (uintptr_t) ((i + 1) * 8));
+   }
+   mulle_concurrent_pointerarray_done( &array);
+
+   rc = mulle_concurrent_pointerarray_get_stats( &after);
+#ifdef MULLE_CONCURRENT_STATS
+   assert( rc == 0);
+   assert( after.inserts - before.inserts == N_VALUES);
+   assert( after.lookups - before.lookups == N_VALUES);
+   assert( after.retries - before.retries == after.migrations_started - before.migrations_started);
+   assert( after.eexists == 0);
+#else
+   assert( rc == ENOSYS);
+#endif
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
@@ -0,0 +1,171 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define N_VALUES    1000
+
+
+//
+// integer ids are stored as values without boxing, with
+// MULLE_CONCURRENT_STORE_ZERO the id 0 and hash 0 are fine too
+//
+#ifdef MULLE_CONCURRENT_STORE_ZERO
+# define FIRST   0
+#else
+# define FIRST   1
+#endif
+
+
+static void   test_hashmap( void)
+{
+   struct mulle_concurrent_hashmap             map;
+   struct mulle_concurrent_hashmapenumerator   rover;
+   intptr_t                                    hash;
+   void                                        *value;
+   unsigned int                                n;
+   int                                         rval;
+
+   mulle_concurrent_hashmap_init( &map, 0, NULL);
+
+   // an empty map is not a map, that holds 0
+   assert( mulle_concurrent_hashmap_lookup_any( &map) == MULLE_CONCURRENT_NO_POINTER);
+   rval = mulle_concurrent_hashmap_insert( &map, FIRST, (void *) FIRST);
+   assert( rval == 0);
+   assert( mulle_concurrent_hashmap_lookup_any( &map) == (void *) FIRST);
+   rval = mulle_concurrent_hashmap_remove( &map, FIRST, (void *) FIRST);
+   assert( rval == 0);
+   assert( mulle_concurrent_hashmap_lookup_any( NULL) == MULLE_CONCURRENT_NO_POINTER);
+
+   for( hash = FIRST; hash < N_VALUES; hash++)
+   {
+      rval = mulle_concurrent_hashmap_insert( &map, hash, (void *) hash);
+      assert( rval == 0);
+   }
+   for( hash = FIRST; hash < N_VALUES; hash++)
+      assert( mulle_concurrent_hashmap_lookup( &map, hash) == (void *) hash);
+   assert( mulle_concurrent_hashmap_lookup( &map, N_VALUES) == MULLE_CONCURRENT_NO_POINTER);
+
+   n     = 0;
+   rover = mulle_concurrent_hashmap_enumerate( &map);
+   while( mulle_concurrent_hashmapenumerator_next( &rover, &hash, &value) == 1)
+   {
+      assert( value == (void *) hash);
+      ++n;
+   }
+   mulle_concurrent_hashmapenumerator_done( &rover);
+   assert( n == N_VALUES - FIRST);
+
+   rval = mulle_concurrent_hashmap_remove( &map, FIRST, (void *) FIRST);
+   assert( rval == 0);
+   assert( mulle_concurrent_hashmap_lookup( &map, FIRST) == MULLE_CONCURRENT_NO_POINTER);
+
+   // whatever is reserved, is rejected
+   rval = mulle_concurrent_hashmap_insert( &map, MULLE_CONCURRENT_NO_HASH, (void *) 1);
+   assert( rval == EINVAL);
+   rval = mulle_concurrent_hashmap_insert( &map, 1, MULLE_CONCURRENT_NO_POINTER);
+   assert( rval == EINVAL);
+   rval = mulle_concurrent_hashmap_insert( &map, 1, MULLE_CONCURRENT_INVALID_POINTER);
+   assert( rval == EINVAL);
+   assert( mulle_concurrent_hashmap_lookup( NULL, 1) == MULLE_CONCURRENT_NO_POINTER);
+
+   mulle_concurrent_hashmap_done( &map);
+}
+
+
+static void   test_pointerarray( void)
+{
+   struct mulle_concurrent_pointerarray             array;
+   struct mulle_concurrent_pointerarrayenumerator   rover;
+   intptr_t                                         i;
+   void                                             *value;
+   int                                              rval;
+
+   mulle_concurrent_pointerarray_init_indexed( &array, 0, NULL);
+
+   for( i = FIRST; i < N_VALUES; i++)
+   {
+      rval = mulle_concurrent_pointerarray_add( &array, (void *) i);
+      assert( rval == 0);
+   }
+   assert( mulle_concurrent_pointerarray_find( &array, (void *) FIRST) == 1);
+   assert( mulle_concurrent_pointerarray_index_of( &array, (void *) FIRST) == 0);
+
+   i     = FIRST;
+   rover = mulle_concurrent_pointerarray_enumerate( &array);
+   while( (value = mulle_concurrent_pointerarrayenumerator_next( &rover)) != MULLE_CONCURRENT_NO_POINTER)
+      assert( value == (void *) i++);
+   mulle_concurrent_pointerarrayenumerator_done( &rover);
+   assert( i == N_VALUES);
+
+   rval = mulle_concurrent_pointerarray_remove( &array, (void *) FIRST);
+   assert( rval == 0);
+   assert( mulle_concurrent_pointerarray_get( &array, 0) == MULLE_CONCURRENT_NO_POINTER);
+   assert( mulle_concurrent_pointerarray_get( &array, N_VALUES) == MULLE_CONCURRENT_NO_POINTER);
+
+   rval = mulle_concurrent_pointerarray_add( &array, MULLE_CONCURRENT_NO_POINTER);
+   assert( rval == EINVAL);
+   rval = mulle_concurrent_pointerarray_add( &array, MULLE_CONCURRENT_INVALID_POINTER);
+   assert( rval == EINVAL);
+
+   mulle_concurrent_pointerarray_done( &array);
+}
+
+
+static void   test_others( void)
+{
+   struct mulle_concurrent_hashset      set;
+   struct mulle_concurrent_countermap   counters;
+   struct mulle_concurrent_keymap       map;
+   int                                  rval;
+
+   mulle_concurrent_hashset_init( &set, 0, NULL);
+   rval = mulle_concurrent_hashset_insert( &set, FIRST);
+   assert( rval == 0);
+   assert( mulle_concurrent_hashset_contains( &set, FIRST));
+   rval = mulle_concurrent_hashset_insert( &set, MULLE_CONCURRENT_NO_HASH);
+   assert( rval == EINVAL);
+   mulle_concurrent_hashset_done( &set);
+
+   mulle_concurrent_countermap_init( &counters, 0, NULL);
+   rval = mulle_concurrent_countermap_add( &counters, FIRST, 18);
+   assert( rval == 0);
+   rval = mulle_concurrent_countermap_add( &counters, FIRST, 48);
+   assert( rval == 0);
+   assert( mulle_concurrent_countermap_get( &counters, FIRST) == 66);
+   rval = mulle_concurrent_countermap_add( &counters, MULLE_CONCURRENT_NO_HASH, 1);
+   assert( rval == EINVAL);
+   mulle_concurrent_countermap_done( &counters);
+
+   mulle_concurrent_keymap_init( &map, 0, NULL, NULL);
+   rval = mulle_concurrent_keymap_insert( &map, "zero", (void *) FIRST);
+   assert( rval == 0);
+   assert( mulle_concurrent_keymap_lookup( &map, "zero") == (void *) FIRST);
+   assert( mulle_concurrent_keymap_lookup( &map, "one") == MULLE_CONCURRENT_NO_POINTER);
+   mulle_concurrent_keymap_done( &map);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test_hashmap();
+   test_pointerarray();
+   test_others();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
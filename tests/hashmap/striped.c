@@ -0,0 +1,94 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+
+//
+// larger storages count their hashes in stripes, check that the map still
+// migrates in time and loses nothing, when many threads insert at once
+//
+#define N_THREADS   8
+#define N_VALUES    200000
+
+
+struct info
+{
+   struct mulle_concurrent_hashmap   *map;
+   intptr_t                          first;
+};
+
+
+static void  inserter( struct info *info)
+{
+   intptr_t   hash;
+   intptr_t   i;
+
+   mulle_aba_register();
+
+   // every thread inserts every key, but starts somewhere else
+   for( i = 0; i < N_VALUES; i++)
+   {
+      hash = (info->first + i) % N_VALUES + 1;
+      mulle_concurrent_hashmap_insert( info->map, hash, (void *) (hash * 8));
+   }
+
+   mulle_aba_unregister();
+}
+
+
+static void   multi_threaded_test( uintptr_t size)
+{
+   struct mulle_concurrent_hashmap   map;
+   struct info                       infos[ N_THREADS];
+   mulle_thread_t                    threads[ N_THREADS];
+   unsigned int                      i;
+   intptr_t                          hash;
+
+   mulle_concurrent_hashmap_init( &map, size, NULL);
+   {
+      for( i = 0; i < N_THREADS; i++)
+      {
+         infos[ i].map   = &map;
+         infos[ i].first = i * (N_VALUES / N_THREADS);
+         if( mulle_thread_create( (void *) inserter, &infos[ i], &threads[ i]))
+         {
+            perror( "mulle_thread_create");
+            abort();
+         }
+      }
+
+      for( i = 0; i < N_THREADS; i++)
+         mulle_thread_join( threads[ i]);
+
+      assert( mulle_concurrent_hashmap_count( &map) == N_VALUES);
+      assert( mulle_concurrent_hashmap_get_size( &map) >= N_VALUES * 2);
+      for( hash = 1; hash <= N_VALUES; hash++)
+         assert( mulle_concurrent_hashmap_lookup( &map, hash) == (void *) (hash * 8));
+   }
+   mulle_concurrent_hashmap_done( &map);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   multi_threaded_test( 0);
+   multi_threaded_test( 4096);
+   multi_threaded_test( 1024 * 1024);
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
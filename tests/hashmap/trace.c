@@ -0,0 +1,160 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+
+#define N_VALUES    1000
+#define N_THREADS   4
+
+
+static void   inserter( struct mulle_concurrent_hashmap *map)
+{
+   intptr_t   hash;
+
+   mulle_aba_register();
+
+   for( hash = 1; hash <= N_VALUES; hash++)
+      mulle_concurrent_hashmap_insert( map, hash, (void *) (hash * 8));
+
+   mulle_aba_unregister();
+}
+
+
+#ifdef MULLE_CONCURRENT_TRACE
+
+static void   check_trace( FILE *fp)
+{
+   struct mulle_concurrent_traceheader   header;
+   struct mulle_concurrent_tracerecord   record;
+   uint64_t                              last[ N_THREADS + 1];
+   unsigned long                         counts[ MULLE_CONCURRENT_TRACE_POINTERARRAY_REMOVE + 1];
+   unsigned long                         n;
+
+   rewind( fp);
+   assert( fread( &header, sizeof( header), 1, fp) == 1);
+   assert( ! strcmp( header.magic, MULLE_CONCURRENT_TRACE_MAGIC));
+   assert( header.version == MULLE_CONCURRENT_TRACE_VERSION);
+   assert( header.record_size == sizeof( record));
+
+   memset( last, 0, sizeof( last));
+   memset( counts, 0, sizeof( counts));
+   n = 0;
+   while( fread( &record, sizeof( record), 1, fp) == 1)
+   {
+      // main thread and the inserters
+      assert( record.thread <= N_THREADS);
+      // the map and the array
+      assert( record.object < 2);
+      assert( record.op >= MULLE_CONCURRENT_TRACE_HASHMAP_INSERT);
+      assert( record.op <= MULLE_CONCURRENT_TRACE_POINTERARRAY_REMOVE);
+
+      // in order per thread
+      assert( record.timestamp >= last[ record.thread]);
+      last[ record.thread] = record.timestamp;
+
+      counts[ record.op]++;
+      ++n;
+   }
+
+   assert( counts[ MULLE_CONCURRENT_TRACE_HASHMAP_INSERT] == N_THREADS * N_VALUES);
+   assert( counts[ MULLE_CONCURRENT_TRACE_HASHMAP_LOOKUP] == N_VALUES);
+   assert( counts[ MULLE_CONCURRENT_TRACE_HASHMAP_REMOVE] == 1);
+   assert( counts[ MULLE_CONCURRENT_TRACE_POINTERARRAY_ADD] == N_VALUES);
+   assert( counts[ MULLE_CONCURRENT_TRACE_POINTERARRAY_GET] == 1);
+   assert( counts[ MULLE_CONCURRENT_TRACE_POINTERARRAY_REMOVE] == 1);
+   assert( n == (N_THREADS + 2) * N_VALUES + 3);
+}
+
+#endif
+
+
+static void   test( void)
+{
+   struct mulle_concurrent_hashmap        map;
+   struct mulle_concurrent_pointerarray   array;
+   mulle_thread_t                         threads[ N_THREADS];
+   unsigned int                           i;
+   intptr_t                               hash;
+   FILE                                   *fp;
+   int                                    rc;
+
+   fp = tmpfile();
+   assert( fp);
+
+   rc = mulle_concurrent_trace_start( fp);
+#ifdef MULLE_CONCURRENT_TRACE
+   assert( rc == 0);
+   assert( mulle_concurrent_trace_start( fp) == EBUSY);
+   assert( mulle_concurrent_trace_start( NULL) == EINVAL);
+#else
+   assert( rc == ENOSYS);
+#endif
+
+   mulle_concurrent_hashmap_init( &map, 0, NULL);
+   mulle_concurrent_pointerarray_init( &array, 0, NULL);
+   {
+      // the records of exited threads must not get lost
+      for( i = 0; i < N_THREADS; i++)
+         if( mulle_thread_create( (void *) inserter, &map, &threads[ i]))
+         {
+            perror( "mulle_thread_create");
+            abort();
+         }
+
+      for( i = 0; i < N_THREADS; i++)
+         mulle_thread_join( threads[ i]);
+
+      for( hash = 1; hash <= N_VALUES; hash++)
+         assert( mulle_concurrent_hashmap_lookup( &map, hash) == (void *) (hash * 8));
+      rc = mulle_concurrent_hashmap_remove( &map, 1, (void *) 8);
+      assert( rc == 0);
+
+      for( hash = 1; hash <= N_VALUES; hash++)
+         mulle_concurrent_pointerarray_add( &array, (void *) (hash * 8));
+      assert( mulle_concurrent_pointerarray_get( &array, 0) == (void *) 8);
+      rc = mulle_concurrent_pointerarray_remove( &array, (void *) 8);
+      assert( rc == 0);
+   }
+
+   rc = mulle_concurrent_trace_stop();
+#ifdef MULLE_CONCURRENT_TRACE
+   assert( rc == 0);
+   assert( mulle_concurrent_trace_stop() == EINVAL);
+
+   // not recorded anymore
+   mulle_concurrent_hashmap_lookup( &map, 1848);
+
+   check_trace( fp);
+#else
+   assert( rc == ENOSYS);
+#endif
+
+   mulle_concurrent_pointerarray_done( &array);
+   mulle_concurrent_hashmap_done( &map);
+
+   fclose( fp);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
@@ -0,0 +1,166 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define N_HASHS     20000
+#define N_THREADS   4
+
+
+static struct mulle_concurrent_hashset   set;
+
+static mulle_atomic_pointer_t   n_inserted;
+static mulle_atomic_pointer_t   n_removed;
+
+
+// all threads insert all hashs
+static void   inserter( void)
+{
+   intptr_t   hash;
+   int        rval;
+
+   mulle_aba_register();
+
+   for( hash = 1; hash <= N_HASHS; hash++)
+   {
+      rval = mulle_concurrent_hashset_insert( &set, hash * (intptr_t) 0x10001);
+      if( rval == 0)
+         _mulle_atomic_pointer_increment( &n_inserted);
+      else
+         if( rval != EEXIST)
+         {
+            perror( "mulle_concurrent_hashset_insert");
+            abort();
+         }
+   }
+
+   mulle_aba_unregister();
+}
+
+
+// all threads remove the odd ones
+static void   remover( void)
+{
+   intptr_t   hash;
+   int        rval;
+
+   mulle_aba_register();
+
+   for( hash = 1; hash <= N_HASHS; hash += 2)
+   {
+      rval = mulle_concurrent_hashset_remove( &set, hash * (intptr_t) 0x10001);
+      if( rval == 0)
+         _mulle_atomic_pointer_increment( &n_removed);
+      else
+         if( rval != ENOENT)
+         {
+            perror( "mulle_concurrent_hashset_remove");
+            abort();
+         }
+   }
+
+   mulle_aba_unregister();
+}
+
+
+static void   run( void (*f)( void))
+{
+   mulle_thread_t   threads[ N_THREADS];
+   unsigned int     i;
+
+   for( i = 0; i < N_THREADS; i++)
+      if( mulle_thread_create( (void *) f, NULL, &threads[ i]))
+      {
+         perror( "mulle_thread_create");
+         abort();
+      }
+   for( i = 0; i < N_THREADS; i++)
+      mulle_thread_join( threads[ i]);
+}
+
+
+static void   test( void)
+{
+   struct mulle_concurrent_hashsetenumerator   rover;
+   intptr_t                                    hash;
+   uintptr_t                                   n;
+   int                                         rval;
+
+   mulle_concurrent_hashset_init( &set, 0, NULL);
+   _mulle_atomic_pointer_nonatomic_write( &n_inserted, 0);
+   _mulle_atomic_pointer_nonatomic_write( &n_removed, 0);
+
+   run( inserter);
+   run( remover);
+
+   // each hash got in and out exactly once
+   assert( (uintptr_t) _mulle_atomic_pointer_read( &n_inserted) == N_HASHS);
+   assert( (uintptr_t) _mulle_atomic_pointer_read( &n_removed) == N_HASHS / 2);
+
+   for( hash = 1; hash <= N_HASHS; hash++)
+      assert( mulle_concurrent_hashset_contains( &set, hash * (intptr_t) 0x10001) == ! (hash & 1));
+   assert( mulle_concurrent_hashset_count( &set) == N_HASHS / 2);
+
+   n     = 0;
+   rover = mulle_concurrent_hashset_enumerate( &set);
+   while( mulle_concurrent_hashsetenumerator_next( &rover, &hash) == 1)
+   {
+      assert( ! (hash % 0x10001));
+      assert( ! ((hash / 0x10001) & 1));
+      ++n;
+   }
+   mulle_concurrent_hashsetenumerator_done( &rover);
+   assert( n == N_HASHS / 2);
+
+   // removed hashs can come back
+   rval = mulle_concurrent_hashset_insert( &set, 0x10001);
+   assert( rval == 0);
+   assert( mulle_concurrent_hashset_contains( &set, 0x10001));
+   rval = mulle_concurrent_hashset_insert( &set, 0x10001);
+   assert( rval == EEXIST);
+   rval = mulle_concurrent_hashset_remove( &set, 0x10001);
+   assert( rval == 0);
+   rval = mulle_concurrent_hashset_remove( &set, 0x10001);
+   assert( rval == ENOENT);
+
+   // reserved hashs
+   rval = mulle_concurrent_hashset_insert( &set, MULLE_CONCURRENT_NO_HASH);
+   assert( rval == EINVAL);
+   rval = mulle_concurrent_hashset_insert( &set, MULLE_CONCURRENT_HASHSET_REDIRECT_HASH);
+   assert( rval == EINVAL);
+   rval = mulle_concurrent_hashset_insert( &set, MULLE_CONCURRENT_HASHSET_TOMBSTONE_HASH);
+   assert( rval == EINVAL);
+   assert( ! mulle_concurrent_hashset_contains( &set, MULLE_CONCURRENT_HASHSET_TOMBSTONE_HASH));
+   rval = mulle_concurrent_hashset_insert( NULL, 1);
+   assert( rval == EINVAL);
+
+   // negative hashs are fine
+   rval = mulle_concurrent_hashset_insert( &set, -1);
+   assert( rval == 0);
+   assert( mulle_concurrent_hashset_contains( &set, -1));
+
+   mulle_concurrent_hashset_done( &set);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
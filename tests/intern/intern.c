@@ -0,0 +1,134 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define N_NAMES     5000
+#define N_THREADS   4
+
+
+static struct mulle_concurrent_interntable   table;
+
+static char   *interned[ N_THREADS][ N_NAMES];
+
+
+static void   interner( uintptr_t index)
+{
+   char           buf[ 32];
+   unsigned int   i;
+   unsigned int   j;
+
+   mulle_aba_register();
+
+   // every thread in another order
+   for( j = 0; j < N_NAMES; j++)
+   {
+      i = (j * 7 + (unsigned int) index * 1013) % N_NAMES;
+      sprintf( buf, "selector%u:", i);
+      interned[ index][ i] = mulle_concurrent_intern_cstring( &table, buf);
+      assert( interned[ index][ i]);
+   }
+
+   mulle_aba_unregister();
+}
+
+
+static void   test_threads( void)
+{
+   mulle_thread_t   threads[ N_THREADS];
+   char             buf[ 32];
+   uintptr_t        j;
+   unsigned int     i;
+
+   // small chunks, so that there are many of them
+   mulle_concurrent_interntable_init( &table, 1024, NULL);
+
+   for( j = 0; j < N_THREADS; j++)
+      if( mulle_thread_create( (void *) interner, (void *) j, &threads[ j]))
+      {
+         perror( "mulle_thread_create");
+         abort();
+      }
+   for( j = 0; j < N_THREADS; j++)
+      mulle_thread_join( threads[ j]);
+
+   assert( mulle_concurrent_interntable_count( &table) == N_NAMES);
+
+   for( i = 0; i < N_NAMES; i++)
+   {
+      sprintf( buf, "selector%u:", i);
+      assert( ! strcmp( interned[ 0][ i], buf));
+      assert( mulle_concurrent_interntable_length_of( interned[ 0][ i]) == strlen( buf));
+      assert( mulle_concurrent_interntable_lookup( &table, buf, strlen( buf)) == interned[ 0][ i]);
+      for( j = 1; j < N_THREADS; j++)
+         assert( interned[ j][ i] == interned[ 0][ i]);
+   }
+
+   mulle_concurrent_interntable_done( &table);
+}
+
+
+static void   test_bytes( void)
+{
+   char   *s;
+   char   *t;
+   char   *big;
+   char   *u;
+
+   mulle_concurrent_interntable_init( &table, 0, NULL);
+
+   assert( ! mulle_concurrent_interntable_lookup( &table, "a\0b", 3));
+
+   // embedded NUL and prefixes are different strings
+   s = mulle_concurrent_intern( &table, "a\0b", 3);
+   t = mulle_concurrent_intern( &table, "a", 1);
+   assert( s && t && s != t);
+   assert( mulle_concurrent_interntable_length_of( s) == 3);
+   assert( ! memcmp( s, "a\0b", 4));
+   assert( mulle_concurrent_intern( &table, "a\0b", 3) == s);
+
+   // the empty string is a string too
+   s = mulle_concurrent_intern( &table, NULL, 0);
+   assert( s && ! *s);
+   assert( mulle_concurrent_intern_cstring( &table, "") == s);
+
+   // a string longer than a chunk
+   big = malloc( MULLE_CONCURRENT_INTERNTABLE_CHUNK_SIZE * 2);
+   memset( big, 'x', MULLE_CONCURRENT_INTERNTABLE_CHUNK_SIZE * 2);
+   u = mulle_concurrent_intern( &table, big, MULLE_CONCURRENT_INTERNTABLE_CHUNK_SIZE * 2);
+   assert( u && u != big);
+   assert( mulle_concurrent_intern( &table, big, MULLE_CONCURRENT_INTERNTABLE_CHUNK_SIZE * 2) == u);
+   assert( mulle_concurrent_interntable_length_of( u) == MULLE_CONCURRENT_INTERNTABLE_CHUNK_SIZE * 2);
+   free( big);
+
+   assert( ! mulle_concurrent_intern( NULL, "a", 1));
+   assert( ! mulle_concurrent_intern( &table, NULL, 1));
+
+   assert( mulle_concurrent_interntable_count( &table) == 4);
+
+   mulle_concurrent_interntable_done( &table);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test_threads();
+   test_bytes();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
@@ -0,0 +1,207 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define N_KEYS      2000
+#define N_THREADS   4
+
+
+//
+// every thread has its own copies of the same strings, so that equal keys
+// are different pointers
+//
+static char   names[ N_THREADS][ N_KEYS][ 16];
+
+static mulle_atomic_pointer_t   n_inserted;
+
+
+struct info
+{
+   struct mulle_concurrent_keymap   *map;
+   unsigned int                     index;
+};
+
+
+static void   inserter( struct info *info)
+{
+   unsigned int   i;
+   int            rval;
+
+   mulle_aba_register();
+
+   for( i = 0; i < N_KEYS; i++)
+   {
+      rval = mulle_concurrent_keymap_insert( info->map,
+                                             names[ info->index][ i],
+                                             (void *) (uintptr_t) ((i + 1) * 8));
+      switch( rval)
+      {
+      case 0 :
+         _mulle_atomic_pointer_increment( &n_inserted);
+         break;
+
+      case EEXIST :
+         break;
+
+      default :
+         perror( "mulle_concurrent_keymap_insert");
+         abort();
+      }
+
+      // inserted or not, the key must be there now
+      if( mulle_concurrent_keymap_lookup( info->map, names[ info->index][ i]) != (void *) (uintptr_t) ((i + 1) * 8))
+      {
+         fprintf( stderr, "%s not found after insert\n", names[ info->index][ i]);
+         abort();
+      }
+   }
+
+   mulle_aba_unregister();
+}
+
+
+static void   test_strings( void)
+{
+   struct mulle_concurrent_keymap             map;
+   struct mulle_concurrent_keymapenumerator   rover;
+   struct info                                infos[ N_THREADS];
+   mulle_thread_t                             threads[ N_THREADS];
+   unsigned int                               i;
+   unsigned int                               j;
+   char                                       buf[ 16];
+   void                                       *key;
+   void                                       *value;
+   int                                        rval;
+
+   for( j = 0; j < N_THREADS; j++)
+      for( i = 0; i < N_KEYS; i++)
+         sprintf( names[ j][ i], "key-%u", i);
+
+   mulle_concurrent_keymap_init( &map, 0, NULL, NULL);
+   _mulle_atomic_pointer_nonatomic_write( &n_inserted, 0);
+
+   for( j = 0; j < N_THREADS; j++)
+   {
+      infos[ j].map   = &map;
+      infos[ j].index = j;
+      if( mulle_thread_create( (void *) inserter, &infos[ j], &threads[ j]))
+      {
+         perror( "mulle_thread_create");
+         abort();
+      }
+   }
+   for( j = 0; j < N_THREADS; j++)
+      mulle_thread_join( threads[ j]);
+
+   // each string got in once
+   assert( (uintptr_t) _mulle_atomic_pointer_read( &n_inserted) == N_KEYS);
+   assert( mulle_concurrent_keymap_count( &map) == N_KEYS);
+
+   for( i = 0; i < N_KEYS; i++)
+   {
+      sprintf( buf, "key-%u", i);
+      assert( mulle_concurrent_keymap_lookup( &map, buf) == (void *) (uintptr_t) ((i + 1) * 8));
+   }
+   assert( mulle_concurrent_keymap_lookup( &map, "key") == MULLE_CONCURRENT_NO_POINTER);
+
+   rover = mulle_concurrent_keymap_enumerate( &map);
+   while( mulle_concurrent_keymapenumerator_next( &rover, &key, &value) == 1)
+      assert( value == (void *) (uintptr_t) ((atoi( (char *) key + 4) + 1) * 8));
+   mulle_concurrent_keymapenumerator_done( &rover);
+
+   rval = mulle_concurrent_keymap_remove( &map, "key-0", (void *) 16);
+   assert( rval == ENOENT);
+   rval = mulle_concurrent_keymap_remove( &map, "key-0", (void *) 8);
+   assert( rval == 0);
+   assert( mulle_concurrent_keymap_lookup( &map, "key-0") == MULLE_CONCURRENT_NO_POINTER);
+   rval = mulle_concurrent_keymap_insert( &map, "key-0", (void *) 8);
+   assert( rval == 0);
+   assert( mulle_concurrent_keymap_lookup( &map, "key-0") == (void *) 8);
+
+   rval = mulle_concurrent_keymap_insert( &map, NULL, (void *) 8);
+   assert( rval == EINVAL);
+   rval = mulle_concurrent_keymap_insert( &map, "x", MULLE_CONCURRENT_NO_POINTER);
+   assert( rval == EINVAL);
+
+   mulle_concurrent_keymap_done( &map);
+}
+
+
+//
+// all keys have the same hash, even the one that is used to mark an
+// unwritten hash. They must not collide
+//
+static intptr_t   zero_hash( struct mulle_concurrent_keymapcallback *callback, void *key)
+{
+   return( 0);
+}
+
+
+static int   is_equal_int( struct mulle_concurrent_keymapcallback *callback, void *key, void *other)
+{
+   return( *(int *) key == *(int *) other);
+}
+
+
+static void   test_collisions( void)
+{
+   struct mulle_concurrent_keymapcallback   callback;
+   struct mulle_concurrent_keymap           map;
+   static int                               keys[ 100];
+   int                                      other;
+   unsigned int                             i;
+   int                                      rval;
+
+   callback.hash     = zero_hash;
+   callback.is_equal = is_equal_int;
+   callback.userinfo = NULL;
+
+   mulle_concurrent_keymap_init( &map, 0, &callback, NULL);
+
+   for( i = 0; i < 100; i++)
+   {
+      keys[ i] = i;
+      rval = mulle_concurrent_keymap_insert( &map, &keys[ i], (void *) (uintptr_t) ((i + 1) * 8));
+      assert( rval == 0);
+   }
+
+   for( i = 0; i < 100; i++)
+   {
+      other = i;
+      assert( mulle_concurrent_keymap_lookup( &map, &other) == (void *) (uintptr_t) ((i + 1) * 8));
+      rval = mulle_concurrent_keymap_insert( &map, &other, (void *) 8);
+      assert( rval == EEXIST);
+   }
+
+   other = 100;
+   assert( mulle_concurrent_keymap_lookup( &map, &other) == MULLE_CONCURRENT_NO_POINTER);
+   assert( mulle_concurrent_keymap_count( &map) == 100);
+
+   mulle_concurrent_keymap_done( &map);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test_strings();
+   test_collisions();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
@@ -0,0 +1,172 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+
+#define N_VALUES    10000
+#define N_THREADS   4
+
+
+static unsigned int   n_freed;
+
+
+static void   count_free( void *block)
+{
+   ++n_freed;
+   mulle_allocator_free( &mulle_default_allocator, block);
+}
+
+
+static void   test( void)
+{
+   struct mulle_concurrent_reclaim         reclaim;
+   struct mulle_concurrent_reclaimthread   a;
+   struct mulle_concurrent_reclaimthread   b;
+
+   assert( mulle_concurrent_reclaim_init( NULL, NULL) == EINVAL);
+   mulle_concurrent_reclaim_init( &reclaim, NULL);
+
+   // nobody registered, nobody can see it
+   n_freed = 0;
+   _mulle_concurrent_reclaim_retire( &reclaim, count_free, mulle_allocator_malloc( &mulle_default_allocator, 16));
+   assert( n_freed == 1);
+
+   mulle_concurrent_reclaim_register( &reclaim, &a);
+   mulle_concurrent_reclaim_register( &reclaim, &b);
+
+   _mulle_concurrent_reclaim_retire( &reclaim, count_free, mulle_allocator_malloc( &mulle_default_allocator, 16));
+   assert( n_freed == 1);
+
+   // QSBR: both threads must pass a quiescent state
+   mulle_concurrent_reclaim_quiescent( &reclaim, &a);
+   assert( n_freed == 1);
+   mulle_concurrent_reclaim_quiescent( &reclaim, &b);
+   assert( n_freed == 2);
+
+   // offline threads don't hold anything up
+   mulle_concurrent_reclaim_offline( &reclaim, &b);
+   _mulle_concurrent_reclaim_retire( &reclaim, count_free, mulle_allocator_malloc( &mulle_default_allocator, 16));
+   assert( n_freed == 2);
+   mulle_concurrent_reclaim_quiescent( &reclaim, &a);
+   assert( n_freed == 3);
+
+   // EBR: a thread inside a critical section holds up the block
+   mulle_concurrent_reclaim_enter( &reclaim, &b);
+   _mulle_concurrent_reclaim_retire( &reclaim, count_free, mulle_allocator_malloc( &mulle_default_allocator, 16));
+   mulle_concurrent_reclaim_quiescent( &reclaim, &a);
+   assert( n_freed == 3);
+   mulle_concurrent_reclaim_leave( &reclaim, &b);
+   assert( n_freed == 4);
+
+   // unregistering releases too
+   _mulle_concurrent_reclaim_retire( &reclaim, count_free, mulle_allocator_malloc( &mulle_default_allocator, 16));
+   mulle_concurrent_reclaim_unregister( &reclaim, &a);
+   assert( n_freed == 5);
+
+   mulle_concurrent_reclaim_enter( &reclaim, &b);
+   _mulle_concurrent_reclaim_retire( &reclaim, count_free, mulle_allocator_malloc( &mulle_default_allocator, 16));
+   mulle_concurrent_reclaim_unregister( &reclaim, &b);
+   assert( n_freed == 6);
+
+   mulle_concurrent_reclaim_done( &reclaim);
+}
+
+
+struct info
+{
+   struct mulle_concurrent_reclaim   *reclaim;
+   struct mulle_concurrent_hashmap   *map;
+   int                               ebr;
+};
+
+
+static void  inserter( struct info *info)
+{
+   struct mulle_concurrent_reclaimthread   thread;
+   intptr_t                                hash;
+
+   mulle_concurrent_reclaim_register( info->reclaim, &thread);
+
+   for( hash = 1; hash <= N_VALUES; hash++)
+   {
+      if( info->ebr)
+         mulle_concurrent_reclaim_enter( info->reclaim, &thread);
+
+      mulle_concurrent_hashmap_insert( info->map, hash, (void *) (hash * 8));
+      assert( mulle_concurrent_hashmap_lookup( info->map, hash) == (void *) (hash * 8));
+
+      if( info->ebr)
+         mulle_concurrent_reclaim_leave( info->reclaim, &thread);
+      else
+         if( ! (hash & 63))
+            mulle_concurrent_reclaim_quiescent( info->reclaim, &thread);
+   }
+
+   mulle_concurrent_reclaim_unregister( info->reclaim, &thread);
+}
+
+
+static void   multi_threaded_test( int ebr)
+{
+   struct mulle_concurrent_reclaim   reclaim;
+   struct mulle_allocator            allocator;
+   struct mulle_concurrent_hashmap   map;
+   struct info                       info;
+   mulle_thread_t                    threads[ N_THREADS];
+   unsigned int                      i;
+   intptr_t                          hash;
+
+   mulle_concurrent_reclaim_init( &reclaim, NULL);
+   mulle_concurrent_reclaim_init_allocator( &reclaim, &allocator, NULL);
+
+   mulle_concurrent_hashmap_init( &map, 0, &allocator);
+   {
+      info.reclaim = &reclaim;
+      info.map     = &map;
+      info.ebr     = ebr;
+
+      for( i = 0; i < N_THREADS; i++)
+         if( mulle_thread_create( (void *) inserter, &info, &threads[ i]))
+         {
+            perror( "mulle_thread_create");
+            abort();
+         }
+
+      for( i = 0; i < N_THREADS; i++)
+         mulle_thread_join( threads[ i]);
+
+      assert( mulle_concurrent_hashmap_count( &map) == N_VALUES);
+      for( hash = 1; hash <= N_VALUES; hash++)
+         assert( mulle_concurrent_hashmap_lookup( &map, hash) == (void *) (hash * 8));
+   }
+   mulle_concurrent_hashmap_done( &map);
+
+   mulle_concurrent_reclaim_done( &reclaim);
+}
+
+
+int   main( void)
+{
+   unsigned int   i;
+
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   test();
+
+   // the pool may not keep blocks of the allocators on the stack
+   mulle_concurrent_storagepool_set_capacity( 4);
+   for( i = 0; i < 10; i++)
+   {
+      multi_threaded_test( 0);
+      multi_threaded_test( 1);
+   }
+   mulle_concurrent_storagepool_set_capacity( 0);
+
+   mulle_test_allocator_reset();
+   return( 0);
+}
@@ -0,0 +1,194 @@
+#include <mulle_concurrent/mulle_concurrent.h>
+
+#include <mulle_test_allocator/mulle_test_allocator.h>
+#include <mulle_aba/mulle_aba.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//
+// storages released with abafree only reach the pool, when mulle_aba
+// says so. Going through mulle_aba_done is the simplest way to get there.
+//
+static void   release_pending( void)
+{
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+}
+
+
+static void   check_alignment( void *storage)
+{
+#ifdef MULLE_CONCURRENT_CACHELINE_LAYOUT
+   assert( ! ((uintptr_t) storage & (MULLE_CONCURRENT_CACHELINE_SIZE - 1)));
+#endif
+}
+
+
+static void   test( void)
+{
+   struct mulle_concurrent_hashmap        map;
+   struct mulle_concurrent_pointerarray   array;
+   void                                   *map_storage;
+   void                                   *array_storage;
+   intptr_t                               hash;
+
+   mulle_concurrent_storagepool_set_capacity( 4);
+   assert( mulle_concurrent_storagepool_get_capacity() == 4);
+
+   mulle_concurrent_hashmap_init( &map, 64, NULL);
+   mulle_concurrent_pointerarray_init( &array, 64, NULL);
+
+   map_storage   = map.storage.storage;
+   array_storage = array.storage.storage;
+   check_alignment( map_storage);
+   check_alignment( array_storage);
+
+   for( hash = 1; hash <= 10; hash++)
+   {
+      mulle_concurrent_hashmap_insert( &map, hash, (void *) (hash * 8));
+      mulle_concurrent_pointerarray_add( &array, (void *) (hash * 8));
+   }
+
+   mulle_concurrent_hashmap_done( &map);
+   mulle_concurrent_pointerarray_done( &array);
+
+   release_pending();
+
+   // same sizes come back out of the pool, but empty
+   mulle_concurrent_pointerarray_init( &array, 64, NULL);
+   mulle_concurrent_hashmap_init( &map, 64, NULL);
+
+   assert( map.storage.storage == map_storage);
+   assert( array.storage.storage == array_storage);
+
+   assert( mulle_concurrent_hashmap_count( &map) == 0);
+   assert( mulle_concurrent_pointerarray_get_count( &array) == 0);
+   for( hash = 1; hash <= 10; hash++)
+      assert( mulle_concurrent_hashmap_lookup( &map, hash) == MULLE_CONCURRENT_NO_POINTER);
+
+   // grow both, so the pool sees a few migrations
+   for( hash = 1; hash <= 1000; hash++)
+   {
+      mulle_concurrent_hashmap_insert( &map, hash, (void *) (hash * 8));
+      mulle_concurrent_pointerarray_add( &array, (void *) (hash * 8));
+   }
+   for( hash = 1; hash <= 1000; hash++)
+   {
+      assert( mulle_concurrent_hashmap_lookup( &map, hash) == (void *) (hash * 8));
+      assert( mulle_concurrent_pointerarray_get( &array, (uintptr_t) hash - 1) == (void *) (hash * 8));
+   }
+
+   mulle_concurrent_hashmap_done( &map);
+   mulle_concurrent_pointerarray_done( &array);
+
+   release_pending();
+
+   // turning the pool off frees what it kept, the test allocator checks
+   mulle_concurrent_storagepool_set_capacity( 0);
+   assert( mulle_concurrent_storagepool_get_capacity() == 0);
+}
+
+
+//
+// an allocator, that goes away, takes its blocks out of the pool, but
+// leaves the blocks of other allocators there
+//
+static void   test_drain_allocator( void)
+{
+   struct mulle_concurrent_hashmap   map;
+   struct mulle_concurrent_hashmap   other;
+   struct mulle_allocator            allocator;
+   void                              *map_storage;
+
+   mulle_concurrent_storagepool_set_capacity( 4);
+
+   allocator = mulle_default_allocator;
+
+   mulle_concurrent_hashmap_init( &map, 64, NULL);
+   mulle_concurrent_hashmap_init( &other, 64, &allocator);
+   map_storage = map.storage.storage;
+
+   mulle_concurrent_hashmap_done( &map);
+   mulle_concurrent_hashmap_done( &other);
+
+   release_pending();
+
+   mulle_concurrent_storagepool_drain_allocator( &allocator);
+   memset( &allocator, 0, sizeof( allocator));  // gone
+
+   mulle_concurrent_hashmap_init( &map, 64, NULL);
+   assert( map.storage.storage == map_storage);
+   mulle_concurrent_hashmap_done( &map);
+
+   release_pending();
+
+   // would call through the cleared allocator, if its block was still kept
+   mulle_concurrent_storagepool_set_capacity( 0);
+}
+
+
+//
+// map every storage, they must come out zeroed and work as usual
+//
+static void   test_mmap( void)
+{
+   struct mulle_concurrent_hashmap        map;
+   struct mulle_concurrent_pointerarray   array;
+   intptr_t                               hash;
+   size_t                                 threshold;
+
+   threshold = mulle_concurrent_storagepool_get_mmap_threshold();
+   mulle_concurrent_storagepool_set_mmap_threshold( 1);
+
+   mulle_concurrent_hashmap_init( &map, 4, NULL);
+   mulle_concurrent_pointerarray_init( &array, 4, NULL);
+   check_alignment( map.storage.storage);
+   check_alignment( array.storage.storage);
+
+   for( hash = 1; hash <= 1000; hash++)
+   {
+      assert( mulle_concurrent_hashmap_lookup( &map, hash) == MULLE_CONCURRENT_NO_POINTER);
+      mulle_concurrent_hashmap_insert( &map, hash, (void *) (hash * 8));
+      mulle_concurrent_pointerarray_add( &array, (void *) (hash * 8));
+   }
+   for( hash = 1; hash <= 1000; hash++)
+   {
+      assert( mulle_concurrent_hashmap_lookup( &map, hash) == (void *) (hash * 8));
+      assert( mulle_concurrent_pointerarray_get( &array, (uintptr_t) hash - 1) == (void *) (hash * 8));
+   }
+   assert( mulle_concurrent_pointerarray_get( &array, 1000) == MULLE_CONCURRENT_NO_POINTER);
+
+   mulle_concurrent_hashmap_done( &map);
+   mulle_concurrent_pointerarray_done( &array);
+
+   release_pending();
+
+   mulle_concurrent_storagepool_set_mmap_threshold( threshold);
+}
+
+
+int   main( void)
+{
+   mulle_test_allocator_initialize();
+   mulle_default_allocator = mulle_test_allocator;
+
+   mulle_aba_init( NULL);
+   mulle_aba_register();
+
+   test();
+   test_drain_allocator();
+   test_mmap();
+
+   mulle_aba_unregister();
+   mulle_aba_done();
+
+   mulle_test_allocator_reset();
+
+   return( 0);
+}